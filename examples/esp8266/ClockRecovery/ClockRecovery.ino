@@ -0,0 +1,119 @@
+/*
+ *  DSC Clock Recovery 1.0 (esp8266)
+ *
+ *  Prints the Keybus interrupt rates and the panel commands decoded every 10 seconds, to compare the default
+ *  sampling with an interrupt per clock edge to clockRecovery, which samples the data line with a periodic
+ *  timer locked to the clock period.  Send 'r' through serial to switch between the two modes - the commands
+ *  decoded per second should not change while the clock interrupts per second drop with clockRecovery.
+ *
+ *  clockRecovery is not used with a virtual keypad, as keys are written on clock edges - this sketch does not
+ *  set dscWritePin.
+ *
+ *  Release notes:
+ *    1.0 - Initial release
+ *
+ *  Wiring:
+ *      DSC Aux(+) --- 5v voltage regulator --- esp8266 development board 5v pin (NodeMCU, Wemos)
+ *
+ *      DSC Aux(-) --- esp8266 Ground
+ *
+ *                                         +--- dscClockPin (esp8266: D1, D2, D8)
+ *      DSC Yellow --- 33k ohm resistor ---|
+ *                                         +--- 10k ohm resistor --- Ground
+ *
+ *                                         +--- dscReadPin (esp8266: D1, D2, D8)
+ *      DSC Green ---- 33k ohm resistor ---|
+ *                                         +--- 10k ohm resistor --- Ground
+ *
+ *  Issues and (especially) pull requests are welcome:
+ *  https://github.com/taligentx/dscKeybusInterface
+ *
+ *  This example code is in the public domain.
+ */
+
+#include <dscKeybusInterface.h>
+
+// Configures the Keybus interface with the specified pins
+#define dscClockPin D1  // esp8266: D1, D2, D8 (GPIO 5, 4, 15)
+#define dscReadPin  D2  // esp8266: D1, D2, D8 (GPIO 5, 4, 15)
+
+const unsigned long reportInterval = 10000;  // Time in milliseconds between reports
+
+// Initialize components
+dscKeybusInterface dsc(dscClockPin, dscReadPin);
+unsigned long reportTime, decodedCommands;
+
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println();
+  Serial.println();
+
+  // Optional configuration
+  dsc.processRedundantData = true;  // Counts repeated commands as decoded to compare the modes
+  dsc.clockRecovery = true;         // Samples with a periodic timer locked to the clock period (default: false)
+
+  dsc.begin();
+  Serial.println(F("DSC Keybus Interface is online."));
+  startReport();
+}
+
+
+void loop() {
+
+  // Switches the sampling mode, the interface is restarted to apply it
+  if (Serial.available() > 0 && Serial.read() == 'r') {
+    dsc.stop();
+    dsc.clockRecovery = !dsc.clockRecovery;
+    dsc.begin();
+    startReport();
+  }
+
+  if (dsc.handlePanel()) {
+    if (dsc.bufferOverflow) {
+      Serial.println(F("Keybus buffer overflow"));
+      dsc.bufferOverflow = false;
+    }
+    decodedCommands++;
+  }
+
+  if (millis() - reportTime >= reportInterval) printReport();
+}
+
+
+// Clears the counts at the start of a report interval
+void startReport() {
+  noInterrupts();
+  dsc.clockInterrupts = 0;
+  dsc.dataInterrupts = 0;
+  interrupts();
+  decodedCommands = 0;
+  reportTime = millis();
+  Serial.print(F("Clock recovery: "));
+  Serial.println(dsc.clockRecovery ? F("on") : F("off"));
+}
+
+
+// Prints the interrupts and commands per second since the last report
+void printReport() {
+  noInterrupts();
+  unsigned long clockInterrupts = dsc.clockInterrupts;
+  unsigned long dataInterrupts = dsc.dataInterrupts;
+  dsc.clockInterrupts = 0;
+  dsc.dataInterrupts = 0;
+  interrupts();
+
+  unsigned long elapsedSeconds = (millis() - reportTime) / 1000;
+  Serial.print(F("Clock interrupts/s: "));
+  Serial.print(clockInterrupts / elapsedSeconds);
+  Serial.print(F(", timer interrupts/s: "));
+  Serial.print(dataInterrupts / elapsedSeconds);
+  Serial.print(F(", total: "));
+  Serial.print((clockInterrupts + dataInterrupts) / elapsedSeconds);
+  Serial.print(F(", commands/s: "));
+  Serial.println((float)decodedCommands / elapsedSeconds, 1);
+
+  decodedCommands = 0;
+  reportTime = millis();
+}
@@ -0,0 +1,217 @@
+/*
+ *  DSC Event History 1.1 (esp8266)
+ *
+ *  Records zone, armed, trouble, and power events to flash with the NTP time and lists events from the last
+ *  hours over telnet.  The event log is kept in a file on LittleFS so events are available after a reset and
+ *  writes are spread across the flash.
+ *
+ *  Optionally sends the events as notifications in HTTP POST requests to a server on the local network.  The
+ *  notification outbox combines events that arrive close together, retries while the server is unavailable,
+ *  and keeps unsent events in a file.  Requests are sent in steps from a scheduler task so waiting for the
+ *  server does not delay processing the Keybus data.
+ *
+ *  Usage:
+ *    1. Set the WiFi SSID and password in the sketch.
+ *    2. Upload the sketch.
+ *    3. Connect with telnet to the esp8266 IP address (port 23).
+ *    4. Enter "h <hours>" to list events from the last number of hours, for example: h 24
+ *       Enter "c" for the number of stored events.
+ *    5. Optional: set notifyHost to send notifications, each request body has one line per event.
+ *
+ *  Release notes:
+ *    1.1 - Add notifications with the notification outbox
+ *    1.0 - Initial release
+ *
+ *  Wiring:
+ *      DSC Aux(+) --- 5v voltage regulator --- esp8266 development board 5v pin (NodeMCU, Wemos)
+ *
+ *      DSC Aux(-) --- esp8266 Ground
+ *
+ *                                         +--- dscClockPin (esp8266: D1, D2, D8)
+ *      DSC Yellow --- 33k ohm resistor ---|
+ *                                         +--- 10k ohm resistor --- Ground
+ *
+ *                                         +--- dscReadPin (esp8266: D1, D2, D8)
+ *      DSC Green ---- 33k ohm resistor ---|
+ *                                         +--- 10k ohm resistor --- Ground
+ *
+ *  Issues and (especially) pull requests are welcome:
+ *  https://github.com/taligentx/dscKeybusInterface
+ *
+ *  This example code is in the public domain.
+ */
+
+#include <ESP8266WiFi.h>
+#include <LittleFS.h>
+#include <dscKeybusInterface.h>
+#include <time.h>
+#include <TZ.h>
+
+// Settings
+const char* wifiSSID = "";
+const char* wifiPassword = "";
+#define ntpTimeZone TZ_Etc_UTC           // Set the time zone (includes DST): https://github.com/esp8266/Arduino/blob/master/cores/esp8266/TZ.h
+const char* ntpServer = "pool.ntp.org";  // Set the NTP server
+const unsigned int eventLogSize = 2048;  // Number of events to keep, 8 bytes of flash per event
+const char* notifyHost = "";             // Set the HTTP server for notifications, or leave empty to disable
+const uint16_t notifyPort = 80;
+const char* notifyPath = "/dsc";
+const unsigned int outboxSpillSize = 256;  // Number of unsent notification events to keep, 8 bytes of flash per event
+
+// Configures the Keybus interface with the specified pins.
+#define dscClockPin D1  // esp8266: D1, D2, D8 (GPIO 5, 4, 15)
+#define dscReadPin  D2  // esp8266: D1, D2, D8 (GPIO 5, 4, 15)
+
+// Initialize components
+dscKeybusInterface dsc(dscClockPin, dscReadPin);
+dscFSStateStorage eventStorage(LittleFS, "/events.bin", eventLogSize * dscEventRecordSize);
+dscEventLog eventLog(eventStorage);
+dscFSStateStorage spillStorage(LittleFS, "/outbox.bin", outboxSpillSize * dscEventRecordSize);
+dscEventLog outboxSpill(spillStorage);
+dscOutbox outbox;
+dscScheduler scheduler(dsc);
+WiFiServer telnetServer(23);
+WiFiClient telnetClient;
+WiFiClient notifyClient;
+char command[16];
+byte commandLength;
+
+
+unsigned long ntpTime() {
+  return time(nullptr);
+}
+
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println();
+  Serial.println();
+
+  Serial.print(F("WiFi..."));
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(wifiSSID, wifiPassword);
+  while (WiFi.status() != WL_CONNECTED) {
+    Serial.print(".");
+    delay(500);
+  }
+  Serial.print(F("connected: "));
+  Serial.println(WiFi.localIP());
+
+  Serial.print(F("NTP time..."));
+  configTime(ntpTimeZone, ntpServer);
+  while (time(nullptr) < 1606784461) {
+    Serial.print(".");
+    delay(2000);
+  }
+  Serial.println(F("synchronized."));
+
+  // Opens the event log and finds the most recent event
+  if (!LittleFS.begin() || !eventLog.begin()) {
+    Serial.println(F("Event log unavailable."));
+    while (true) delay(1000);
+  }
+  eventLog.setTimeSource(ntpTime);
+  Serial.print(eventLog.count());
+  Serial.println(F(" events stored."));
+
+  // Sends status changes to the notification outbox, run by the scheduler between Keybus data
+  if (strlen(notifyHost) > 0 && outboxSpill.begin()) {
+    if (outbox.setSpill(outboxSpill)) Serial.println(F("Unsent notifications restored."));
+    outbox.setStepSender(sendNotification, 10000);
+    dsc.setOutbox(outbox);
+    scheduler.addTask(runOutbox, 10, 5);
+  }
+
+  telnetServer.begin();
+  telnetServer.setNoDelay(true);
+
+  // Starts the Keybus interface and logs status changes
+  dsc.setEventLog(eventLog);
+  dsc.begin();
+  Serial.println(F("DSC Keybus Interface is online."));
+}
+
+
+void loop() {
+
+  scheduler.run();
+
+  // Accepts one telnet client at a time
+  if (telnetServer.hasClient()) {
+    if (telnetClient) telnetClient.stop();
+    telnetClient = telnetServer.available();
+    commandLength = 0;
+    telnetClient.println(F("DSC event history - h <hours>: list events, c: event count"));
+  }
+
+  while (telnetClient && telnetClient.available() > 0) {
+    char input = telnetClient.read();
+    if (input == '\r') continue;
+    if (input != '\n') {
+      if (commandLength < sizeof(command) - 1) command[commandLength++] = input;
+      continue;
+    }
+    command[commandLength] = '\0';
+    commandLength = 0;
+    processCommand();
+  }
+}
+
+
+void processCommand() {
+  if (command[0] == 'h') {
+    unsigned long hours = strtoul(command + 1, NULL, 10);
+    if (hours == 0) hours = 1;
+    unsigned long now = time(nullptr);
+    unsigned long fromTime = (hours * 3600 < now) ? now - (hours * 3600) : 0;
+
+    unsigned int printedEvents = eventLog.printEvents(fromTime, now, telnetClient);
+    telnetClient.print(printedEvents);
+    telnetClient.print(F(" events in the last "));
+    telnetClient.print(hours);
+    telnetClient.println(F(" hours"));
+  }
+  else if (command[0] == 'c') {
+    telnetClient.print(eventLog.count());
+    telnetClient.println(F(" events stored"));
+  }
+}
+
+
+void runOutbox() {
+  outbox.run();
+}
+
+
+// Sends a notification in steps called from outbox.run(): the first step connects and sends the request, the
+// next steps check for the response without waiting.  connect() waits up to the client timeout, which is kept
+// short for a server on the local network.
+byte sendNotification(const char* message, bool start) {
+  if (start) {
+    notifyClient.stop();
+    notifyClient.setTimeout(500);
+    if (!notifyClient.connect(notifyHost, notifyPort)) return dscSendFailed;
+    notifyClient.print(F("POST "));
+    notifyClient.print(notifyPath);
+    notifyClient.println(F(" HTTP/1.0"));
+    notifyClient.print(F("Host: "));
+    notifyClient.println(notifyHost);
+    notifyClient.println(F("Content-Type: text/plain"));
+    notifyClient.print(F("Content-Length: "));
+    notifyClient.println(strlen(message));
+    notifyClient.println();
+    notifyClient.print(message);
+    return dscSendPending;
+  }
+
+  if (!notifyClient.available()) return notifyClient.connected() ? dscSendPending : dscSendFailed;
+
+  // Reads the response until the first space - the message was sent if the HTTP status code begins with "2"
+  while (notifyClient.available()) {
+    if (notifyClient.read() == ' ') break;
+  }
+  char statusCode = notifyClient.read();
+  notifyClient.stop();
+  return statusCode == '2' ? dscSendDone : dscSendFailed;
+}
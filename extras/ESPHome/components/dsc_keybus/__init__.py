@@ -0,0 +1,150 @@
+import os
+
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome import automation, pins
+from esphome.const import CONF_ID, CONF_TRIGGER_ID
+
+CODEOWNERS = []
+
+CONF_CLOCK_PIN = "clock_pin"
+CONF_READ_PIN = "read_pin"
+CONF_WRITE_PIN = "write_pin"
+CONF_RAW_BIT_MODE = "raw_bit_mode"
+CONF_PANEL = "panel"
+CONF_KEYS = "keys"
+CONF_ON_SYSTEM_STATUS = "on_system_status"
+CONF_ON_PARTITION_STATUS = "on_partition_status"
+CONF_ON_ZONE_STATUS = "on_zone_status"
+CONF_ON_TROUBLE_STATUS = "on_trouble_status"
+CONF_ON_POWER_STATUS = "on_power_status"
+CONF_ON_DISPLAY = "on_display"
+
+# Panel profiles and the build flag selecting the library dscPanelProfile
+PANEL_PROFILES = {
+    "sigma_mc08": None,
+    "dsc_powerseries": "-DdscPowerSeries",
+}
+
+# The library sources are at the root of this repository
+LIBRARY_PATH = os.path.abspath(
+    os.path.join(os.path.dirname(__file__), "..", "..", "..", "..")
+)
+
+dsc_keybus_ns = cg.esphome_ns.namespace("dsc_keybus")
+DscKeybusComponent = dsc_keybus_ns.class_("DscKeybusComponent", cg.Component)
+SystemStatus = dsc_keybus_ns.enum("SystemStatus", is_class=True)
+PartitionStatus = dsc_keybus_ns.enum("PartitionStatus", is_class=True)
+
+SystemStatusTrigger = dsc_keybus_ns.class_(
+    "SystemStatusTrigger", automation.Trigger.template(SystemStatus)
+)
+PartitionStatusTrigger = dsc_keybus_ns.class_(
+    "PartitionStatusTrigger", automation.Trigger.template(cg.uint8, PartitionStatus)
+)
+ZoneStatusTrigger = dsc_keybus_ns.class_(
+    "ZoneStatusTrigger", automation.Trigger.template(cg.uint8, cg.bool_)
+)
+TroubleStatusTrigger = dsc_keybus_ns.class_(
+    "TroubleStatusTrigger", automation.Trigger.template(cg.bool_)
+)
+PowerStatusTrigger = dsc_keybus_ns.class_(
+    "PowerStatusTrigger", automation.Trigger.template(cg.bool_)
+)
+DisplayTrigger = dsc_keybus_ns.class_(
+    "DisplayTrigger", automation.Trigger.template(cg.const_char_ptr, cg.bool_)
+)
+
+WriteAction = dsc_keybus_ns.class_("WriteAction", automation.Action)
+StopAction = dsc_keybus_ns.class_("StopAction", automation.Action)
+ResumeAction = dsc_keybus_ns.class_("ResumeAction", automation.Action)
+
+# Trigger configuration key, trigger class, and automation arguments
+TRIGGERS = (
+    (CONF_ON_SYSTEM_STATUS, SystemStatusTrigger, [(SystemStatus, "status")]),
+    (
+        CONF_ON_PARTITION_STATUS,
+        PartitionStatusTrigger,
+        [(cg.uint8, "partition"), (PartitionStatus, "status")],
+    ),
+    (CONF_ON_ZONE_STATUS, ZoneStatusTrigger, [(cg.uint8, "zone"), (cg.bool_, "open")]),
+    (CONF_ON_TROUBLE_STATUS, TroubleStatusTrigger, [(cg.bool_, "trouble")]),
+    (CONF_ON_POWER_STATUS, PowerStatusTrigger, [(cg.bool_, "trouble")]),
+    (CONF_ON_DISPLAY, DisplayTrigger, [(cg.const_char_ptr, "text"), (cg.bool_, "blink")]),
+)
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(DscKeybusComponent),
+        cv.Required(CONF_CLOCK_PIN): pins.internal_gpio_input_pin_number,
+        cv.Required(CONF_READ_PIN): pins.internal_gpio_input_pin_number,
+        cv.Optional(CONF_WRITE_PIN): pins.internal_gpio_output_pin_number,
+        cv.Optional(CONF_RAW_BIT_MODE, default=False): cv.boolean,
+        cv.Optional(CONF_PANEL, default="sigma_mc08"): cv.one_of(
+            *PANEL_PROFILES, lower=True
+        ),
+        **{
+            cv.Optional(key): automation.validate_automation(
+                {cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(trigger)}
+            )
+            for key, trigger, _ in TRIGGERS
+        },
+    }
+).extend(cv.COMPONENT_SCHEMA)
+
+
+async def to_code(config):
+    cg.add_library("dscKeybusInterface", None, f"symlink://{LIBRARY_PATH}")
+    if PANEL_PROFILES[config[CONF_PANEL]]:
+        cg.add_build_flag(PANEL_PROFILES[config[CONF_PANEL]])
+
+    var = cg.new_Pvariable(
+        config[CONF_ID],
+        config[CONF_CLOCK_PIN],
+        config[CONF_READ_PIN],
+        config.get(CONF_WRITE_PIN, 255),
+    )
+    await cg.register_component(var, config)
+    cg.add(var.set_raw_bit_mode(config[CONF_RAW_BIT_MODE]))
+
+    for key, _, args in TRIGGERS:
+        for conf in config.get(key, []):
+            trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+            await automation.build_automation(trigger, args, conf)
+
+
+DSC_KEYBUS_ACTION_SCHEMA = automation.maybe_simple_id(
+    {cv.GenerateID(): cv.use_id(DscKeybusComponent)}
+)
+
+
+@automation.register_action(
+    "dsc_keybus.write",
+    WriteAction,
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.use_id(DscKeybusComponent),
+            cv.Required(CONF_KEYS): cv.templatable(cv.string),
+        }
+    ),
+)
+async def dsc_keybus_write_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    keys = await cg.templatable(config[CONF_KEYS], args, cg.std_string)
+    cg.add(var.set_keys(keys))
+    return var
+
+
+@automation.register_action("dsc_keybus.stop", StopAction, DSC_KEYBUS_ACTION_SCHEMA)
+async def dsc_keybus_stop_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
+
+
+@automation.register_action("dsc_keybus.resume", ResumeAction, DSC_KEYBUS_ACTION_SCHEMA)
+async def dsc_keybus_resume_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
@@ -0,0 +1,151 @@
+#include "dsc_keybus.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace dsc_keybus {
+
+static const char *const TAG = "dsc_keybus";
+
+const char *system_status_to_string(SystemStatus status) {
+  switch (status) {
+    case SystemStatus::ONLINE:
+      return "online";
+    case SystemStatus::OFFLINE:
+    default:
+      return "offline";
+  }
+}
+
+const char *partition_status_to_string(PartitionStatus status) {
+  switch (status) {
+    case PartitionStatus::ARMED_HOME:
+      return "armed_home";
+    case PartitionStatus::ARMED_AWAY:
+      return "armed_away";
+    case PartitionStatus::DISARMED:
+    default:
+      return "disarmed";
+  }
+}
+
+void DscKeybusComponent::setup() {
+  this->dsc_ = new dscKeybusInterface(this->clock_pin_, this->read_pin_, this->write_pin_);
+
+  dscKeybusInterface::rawBitMode = this->raw_bit_mode_;
+  this->system_status_callback_.call(SystemStatus::OFFLINE);
+  this->dsc_->begin();
+}
+
+void DscKeybusComponent::dump_config() {
+  ESP_LOGCONFIG(TAG, "DSC Keybus:");
+  ESP_LOGCONFIG(TAG, "  Clock pin: %u", this->clock_pin_);
+  ESP_LOGCONFIG(TAG, "  Read pin: %u", this->read_pin_);
+  if (this->write_pin_ != 255) {
+    ESP_LOGCONFIG(TAG, "  Write pin: %u", this->write_pin_);
+  }
+  ESP_LOGCONFIG(TAG, "  Raw bit mode: %s", YESNO(this->raw_bit_mode_));
+}
+
+void DscKeybusComponent::loop() {
+  if (this->stopped_)
+    return;
+
+  // Processes the buffered panel commands, publishing after each command so brief changes are not merged
+  for (uint16_t i = 0; i < dscBufferSize; i++) {
+    bool panel_data = this->dsc_->handlePanel();
+    if (this->dsc_->statusChanged)
+      this->publish_status_();
+    if (!panel_data)
+      break;
+  }
+}
+
+void DscKeybusComponent::publish_status_() {
+  dscKeybusInterface &dsc = *this->dsc_;
+  dsc.statusChanged = false;
+
+  if (dsc.bufferOverflow) {
+    ESP_LOGW(TAG, "Keybus buffer overflow");
+    dsc.bufferOverflow = false;
+  }
+
+  if (dsc.keybusChanged) {
+    dsc.keybusChanged = false;
+    this->system_status_callback_.call(dsc.keybusConnected ? SystemStatus::ONLINE : SystemStatus::OFFLINE);
+  }
+
+  if (dsc.troubleChanged) {
+    dsc.troubleChanged = false;
+    this->trouble_status_callback_.call(dsc.trouble);
+  }
+
+  if (dsc.powerChanged) {
+    dsc.powerChanged = false;
+    this->power_status_callback_.call(dsc.powerTrouble);
+  }
+
+  for (uint8_t partition = 0; partition < dscPartitions; partition++) {
+    if (!dsc.armedChanged[partition])
+      continue;
+    dsc.armedChanged[partition] = false;
+
+    PartitionStatus status = PartitionStatus::DISARMED;
+    if (dsc.armed[partition])
+      status = dsc.armedStay[partition] ? PartitionStatus::ARMED_HOME : PartitionStatus::ARMED_AWAY;
+    this->partition_status_callback_.call(partition + 1, status);
+  }
+
+  if (dsc.openZonesStatusChanged) {
+    dsc.openZonesStatusChanged = false;
+    for (uint8_t zone_group = 0; zone_group < dscZones; zone_group++) {
+      uint8_t changed = dsc.openZonesChanged[zone_group];
+      dsc.openZonesChanged[zone_group] = 0;
+      for (uint8_t zone_bit = 0; changed != 0; zone_bit++, changed >>= 1) {
+        if (changed & 0x01)
+          this->zone_status_callback_.call(zone_bit + 1 + (zone_group * 8), bitRead(dsc.openZones[zone_group], zone_bit));
+      }
+    }
+  }
+
+  if (dsc.displayChanged) {
+    dsc.displayChanged = false;
+    this->display_callback_.call(dsc.displayText, dsc.displayBlink);
+  }
+}
+
+void DscKeybusComponent::write(const char *keys) {
+  if (this->dsc_ == nullptr || this->stopped_)
+    return;
+  // The library writes from write_buffer_ until all keys are written
+  if (this->dsc_->writePending()) {
+    ESP_LOGW(TAG, "Keys rejected, still writing the previous keys");
+    return;
+  }
+  if (strlen(keys) >= sizeof(this->write_buffer_)) {
+    ESP_LOGW(TAG, "Keys exceed %u characters", (unsigned) sizeof(this->write_buffer_) - 1);
+    return;
+  }
+  strncpy(this->write_buffer_, keys, sizeof(this->write_buffer_));
+  this->dsc_->write(this->write_buffer_);
+}
+
+void DscKeybusComponent::stop() {
+  if (this->dsc_ == nullptr || this->stopped_)
+    return;
+  ESP_LOGI(TAG, "Stopping Keybus interface");
+  this->dsc_->stop();
+  this->stopped_ = true;
+  this->system_status_callback_.call(SystemStatus::OFFLINE);
+}
+
+void DscKeybusComponent::resume() {
+  if (this->dsc_ == nullptr || !this->stopped_)
+    return;
+  ESP_LOGI(TAG, "Resuming Keybus interface");
+  this->stopped_ = false;
+  this->dsc_->begin();
+  this->dsc_->resetStatus();
+}
+
+}  // namespace dsc_keybus
+}  // namespace esphome
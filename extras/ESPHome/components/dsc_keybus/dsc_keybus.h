@@ -0,0 +1,146 @@
+#pragma once
+
+#include "esphome/core/automation.h"
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+
+#include <dscKeybusInterface.h>
+
+namespace esphome {
+namespace dsc_keybus {
+
+enum class SystemStatus : uint8_t {
+  OFFLINE,
+  ONLINE,
+};
+
+enum class PartitionStatus : uint8_t {
+  DISARMED,
+  ARMED_HOME,
+  ARMED_AWAY,
+};
+
+const char *system_status_to_string(SystemStatus status);
+const char *partition_status_to_string(PartitionStatus status);
+
+// Publishes the Keybus status through callbacks with enum and fixed-size arguments - status changes do not
+// allocate memory.  Callbacks are registered once at setup by the triggers.
+class DscKeybusComponent : public Component {
+ public:
+  DscKeybusComponent(uint8_t clock_pin, uint8_t read_pin, uint8_t write_pin)
+      : clock_pin_(clock_pin), read_pin_(read_pin), write_pin_(write_pin) {}
+
+  void setup() override;
+  void loop() override;
+  void dump_config() override;
+  float get_setup_priority() const override { return setup_priority::HARDWARE; }
+
+  void set_raw_bit_mode(bool raw_bit_mode) { this->raw_bit_mode_ = raw_bit_mode; }
+
+  void add_on_system_status_callback(std::function<void(SystemStatus)> &&callback) {
+    this->system_status_callback_.add(std::move(callback));
+  }
+  void add_on_partition_status_callback(std::function<void(uint8_t, PartitionStatus)> &&callback) {
+    this->partition_status_callback_.add(std::move(callback));
+  }
+  void add_on_zone_status_callback(std::function<void(uint8_t, bool)> &&callback) {
+    this->zone_status_callback_.add(std::move(callback));
+  }
+  void add_on_trouble_status_callback(std::function<void(bool)> &&callback) {
+    this->trouble_status_callback_.add(std::move(callback));
+  }
+  void add_on_power_status_callback(std::function<void(bool)> &&callback) {
+    this->power_status_callback_.add(std::move(callback));
+  }
+  void add_on_display_callback(std::function<void(const char *, bool)> &&callback) {
+    this->display_callback_.add(std::move(callback));
+  }
+
+  // Copies the keys to a fixed buffer, keys are written in the background by the library
+  void write(const char *keys);
+
+  // Detaches the Keybus interrupts, for example while updating over the air
+  void stop();
+  void resume();
+  bool is_stopped() const { return this->stopped_; }
+  bool is_connected() const { return this->dsc_ != nullptr && this->dsc_->keybusConnected; }
+
+ protected:
+  void publish_status_();
+
+  uint8_t clock_pin_, read_pin_, write_pin_;
+  bool raw_bit_mode_{false};
+  bool stopped_{false};
+  dscKeybusInterface *dsc_{nullptr};
+  char write_buffer_[33]{};
+
+  CallbackManager<void(SystemStatus)> system_status_callback_;
+  CallbackManager<void(uint8_t, PartitionStatus)> partition_status_callback_;
+  CallbackManager<void(uint8_t, bool)> zone_status_callback_;
+  CallbackManager<void(bool)> trouble_status_callback_;
+  CallbackManager<void(bool)> power_status_callback_;
+  CallbackManager<void(const char *, bool)> display_callback_;
+};
+
+class SystemStatusTrigger : public Trigger<SystemStatus> {
+ public:
+  explicit SystemStatusTrigger(DscKeybusComponent *parent) {
+    parent->add_on_system_status_callback([this](SystemStatus status) { this->trigger(status); });
+  }
+};
+
+class PartitionStatusTrigger : public Trigger<uint8_t, PartitionStatus> {
+ public:
+  explicit PartitionStatusTrigger(DscKeybusComponent *parent) {
+    parent->add_on_partition_status_callback(
+        [this](uint8_t partition, PartitionStatus status) { this->trigger(partition, status); });
+  }
+};
+
+class ZoneStatusTrigger : public Trigger<uint8_t, bool> {
+ public:
+  explicit ZoneStatusTrigger(DscKeybusComponent *parent) {
+    parent->add_on_zone_status_callback([this](uint8_t zone, bool open) { this->trigger(zone, open); });
+  }
+};
+
+class TroubleStatusTrigger : public Trigger<bool> {
+ public:
+  explicit TroubleStatusTrigger(DscKeybusComponent *parent) {
+    parent->add_on_trouble_status_callback([this](bool trouble) { this->trigger(trouble); });
+  }
+};
+
+class PowerStatusTrigger : public Trigger<bool> {
+ public:
+  explicit PowerStatusTrigger(DscKeybusComponent *parent) {
+    parent->add_on_power_status_callback([this](bool trouble) { this->trigger(trouble); });
+  }
+};
+
+class DisplayTrigger : public Trigger<const char *, bool> {
+ public:
+  explicit DisplayTrigger(DscKeybusComponent *parent) {
+    parent->add_on_display_callback([this](const char *text, bool blink) { this->trigger(text, blink); });
+  }
+};
+
+template<typename... Ts> class WriteAction : public Action<Ts...>, public Parented<DscKeybusComponent> {
+ public:
+  TEMPLATABLE_VALUE(std::string, keys)
+
+  void play(Ts... x) override { this->parent_->write(this->keys_.value(x...).c_str()); }
+};
+
+template<typename... Ts> class StopAction : public Action<Ts...>, public Parented<DscKeybusComponent> {
+ public:
+  void play(Ts... x) override { this->parent_->stop(); }
+};
+
+template<typename... Ts> class ResumeAction : public Action<Ts...>, public Parented<DscKeybusComponent> {
+ public:
+  void play(Ts... x) override { this->parent_->resume(); }
+};
+
+}  // namespace dsc_keybus
+}  // namespace esphome
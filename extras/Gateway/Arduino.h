@@ -0,0 +1,17 @@
+
+#ifndef Arduino_h
+#define Arduino_h
+
+// Definitions used by src/dscKeybusPanelProfile.h, the gateway includes the panel profile from the library on
+// Linux without the rest of the Arduino core.
+
+#include <stdint.h>
+
+typedef uint8_t byte;
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+#endif  // Arduino_h
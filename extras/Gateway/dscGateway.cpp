@@ -0,0 +1,562 @@
+
+#include "dscGateway.h"
+#include "../../src/dscKeybusPanelProfile.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+/*
+ *  Gateway
+ *
+ *  Each epoll event carries the socket type in the upper 32 bits and the site or query client number in the
+ *  lower 32 bits.  Sockets are level-triggered and each ready board socket is read once per run() so a busy
+ *  board cannot hold up the other sites.  Lines are assembled in a fixed buffer per site and decoded in place:
+ *  a line is a panel command if the binary after the timestamp is followed by "[0x" and the same command byte,
+ *  module lines and messages are counted as skipped.
+ */
+
+const uint32_t dscEventSite = 1;
+const uint32_t dscEventQueryListen = 2;
+const uint32_t dscEventQueryClient = 3;
+
+const unsigned int dscGatewayReadChunk = 4096;  // Bytes read from a socket for each event
+const int dscGatewayEvents = 256;               // Events returned by each epoll_wait()
+const unsigned long dscGatewayCheckTime = 1000;  // Time in milliseconds between reconnect and idle checks
+
+
+static uint64_t eventData(uint32_t type, uint32_t number) {
+  return ((uint64_t)type << 32) | number;
+}
+
+
+dscGateway::dscGateway() {
+  epollSocket = epoll_create1(EPOLL_CLOEXEC);
+  querySocket = -1;
+  version = 0;
+  nextCheckTime = 0;
+  events = 0;
+  wakeups = 0;
+}
+
+
+dscGateway::~dscGateway() {
+  stop();
+  if (epollSocket >= 0) close(epollSocket);
+}
+
+
+// Site names are returned in JSON without escaping and are limited to letters, digits, '-', '_' and '.'
+int dscGateway::addSite(const char * name, const char * host, unsigned int port) {
+  size_t nameLength = strlen(name);
+  if (nameLength == 0 || nameLength >= dscGatewayNameSize) return -1;
+  for (size_t i = 0; i < nameLength; i++) {
+    char c = name[i];
+    if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.')) return -1;
+  }
+
+  addrinfo hints, *result;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host, NULL, &hints, &result) != 0) return -1;
+
+  dscGatewaySite site;
+  memset(&site, 0, sizeof(site));
+  strcpy(site.status.name, name);
+  site.address = *(sockaddr_in *)result->ai_addr;
+  site.address.sin_port = htons(port);
+  site.socket = -1;
+  site.retryDelay = dscGatewayRetryTime;
+  freeaddrinfo(result);
+
+  sites.push_back(site);
+  nextCheckTime = 0;
+  return sites.size() - 1;
+}
+
+
+bool dscGateway::listenQuery(const char * host, unsigned int port) {
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  if (inet_pton(AF_INET, host, &address.sin_addr) != 1) return false;
+
+  querySocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (querySocket < 0) return false;
+  int enable = 1;
+  setsockopt(querySocket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  if (bind(querySocket, (sockaddr *)&address, sizeof(address)) != 0 || listen(querySocket, 64) != 0) {
+    close(querySocket);
+    querySocket = -1;
+    return false;
+  }
+
+  epoll_event event;
+  event.events = EPOLLIN;
+  event.data.u64 = eventData(dscEventQueryListen, 0);
+  epoll_ctl(epollSocket, EPOLL_CTL_ADD, querySocket, &event);
+  return true;
+}
+
+
+unsigned int dscGateway::queryPort() {
+  sockaddr_in address;
+  socklen_t addressLength = sizeof(address);
+  if (querySocket < 0 || getsockname(querySocket, (sockaddr *)&address, &addressLength) != 0) return 0;
+  return ntohs(address.sin_port);
+}
+
+
+void dscGateway::run(int timeout) {
+  unsigned long long currentTime = currentMillis();
+  if (currentTime >= nextCheckTime) checkSites(currentTime);
+  if (nextCheckTime - currentTime < (unsigned long long)timeout) timeout = nextCheckTime - currentTime;
+
+  epoll_event readyEvents[dscGatewayEvents];
+  int readyCount = epoll_wait(epollSocket, readyEvents, dscGatewayEvents, timeout);
+  if (readyCount <= 0) return;
+  wakeups++;
+  events += readyCount;
+
+  for (int i = 0; i < readyCount; i++) {
+    uint32_t type = readyEvents[i].data.u64 >> 32;
+    uint32_t number = readyEvents[i].data.u64 & 0xFFFFFFFF;
+    uint32_t flags = readyEvents[i].events;
+
+    switch (type) {
+      case dscEventSite: {
+        dscGatewaySite &site = sites[number];
+        if (site.socket < 0) break;
+
+        // Completes a non-blocking connect
+        if (site.connecting) {
+          int error = 0;
+          socklen_t errorLength = sizeof(error);
+          getsockopt(site.socket, SOL_SOCKET, SO_ERROR, &error, &errorLength);
+          if (error != 0 || (flags & (EPOLLERR | EPOLLHUP))) {
+            closeSite(number);
+            break;
+          }
+          site.connecting = false;
+          site.lastDataTime = currentMillis();
+          site.stats.connects++;
+          site.status.connected = true;
+          site.status.version = ++version;
+          site.status.lastChange = time(NULL);
+
+          epoll_event event;
+          event.events = EPOLLIN | EPOLLRDHUP;
+          event.data.u64 = eventData(dscEventSite, number);
+          epoll_ctl(epollSocket, EPOLL_CTL_MOD, site.socket, &event);
+          break;
+        }
+        readSite(number);
+        break;
+      }
+
+      case dscEventQueryListen:
+        acceptQuery();
+        break;
+
+      case dscEventQueryClient:
+        if (clients[number].socket < 0) break;
+        if (flags & EPOLLOUT) writeQuery(number);
+        if (clients[number].socket >= 0 && (flags & (EPOLLIN | EPOLLHUP | EPOLLERR))) readQuery(number);
+        break;
+    }
+  }
+}
+
+
+void dscGateway::stop() {
+  for (unsigned int site = 0; site < sites.size(); site++) {
+    if (sites[site].socket >= 0) closeSite(site);
+  }
+  for (unsigned int client = 0; client < clients.size(); client++) {
+    if (clients[client].socket >= 0) closeQuery(client);
+  }
+  if (querySocket >= 0) {
+    close(querySocket);
+    querySocket = -1;
+  }
+}
+
+
+unsigned int dscGateway::siteCount() {
+  return sites.size();
+}
+
+
+const dscSiteStatus & dscGateway::siteStatus(unsigned int site) {
+  return sites[site].status;
+}
+
+
+const dscSiteStats & dscGateway::siteStats(unsigned int site) {
+  return sites[site].stats;
+}
+
+
+unsigned long dscGateway::statusVersion() {
+  return version;
+}
+
+
+/*
+ *  Boards
+ */
+void dscGateway::connectSite(unsigned int number) {
+  dscGatewaySite &site = sites[number];
+  site.socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (site.socket < 0) return;
+
+  int enable = 1;
+  setsockopt(site.socket, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+  if (connect(site.socket, (sockaddr *)&site.address, sizeof(site.address)) != 0 && errno != EINPROGRESS) {
+    closeSite(number);
+    return;
+  }
+
+  site.connecting = true;
+  site.lineLength = 0;
+  site.lineSkipped = false;
+  site.lastDataTime = currentMillis();
+
+  epoll_event event;
+  event.events = EPOLLOUT;
+  event.data.u64 = eventData(dscEventSite, number);
+  epoll_ctl(epollSocket, EPOLL_CTL_ADD, site.socket, &event);
+}
+
+
+// Closes the board socket and sets the next reconnect time
+void dscGateway::closeSite(unsigned int number) {
+  dscGatewaySite &site = sites[number];
+  if (site.socket >= 0) close(site.socket);
+  site.socket = -1;
+  site.connecting = false;
+
+  if (site.status.connected) {
+    site.status.connected = false;
+    site.status.version = ++version;
+    site.status.lastChange = time(NULL);
+    site.stats.disconnects++;
+  }
+
+  site.retryTime = currentMillis() + site.retryDelay;
+  if (site.retryDelay < dscGatewayMaxRetryTime / 2) site.retryDelay *= 2;
+  else site.retryDelay = dscGatewayMaxRetryTime;
+}
+
+
+void dscGateway::readSite(unsigned int number) {
+  dscGatewaySite &site = sites[number];
+  char data[dscGatewayReadChunk];
+  ssize_t dataLength = read(site.socket, data, sizeof(data));
+  if (dataLength <= 0) {
+    if (dataLength < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    closeSite(number);
+    return;
+  }
+
+  site.stats.bytes += dataLength;
+  site.lastDataTime = currentMillis();
+  site.retryDelay = dscGatewayRetryTime;
+
+  // Copies each line to the line buffer, lines longer than the buffer are skipped
+  char * position = data;
+  char * end = data + dataLength;
+  while (position < end) {
+    char * lineEnd = (char *)memchr(position, '\n', end - position);
+    size_t length = (lineEnd ? lineEnd : end) - position;
+
+    if (site.lineLength + length < dscGatewayLineSize) {
+      memcpy(site.line + site.lineLength, position, length);
+      site.lineLength += length;
+    }
+    else site.lineSkipped = true;
+
+    if (!lineEnd) break;
+    if (site.lineSkipped) site.stats.skippedLines++;
+    else {
+      if (site.lineLength > 0 && site.line[site.lineLength - 1] == '\r') site.lineLength--;
+      site.line[site.lineLength] = '\0';
+      processLine(site, site.line, site.lineLength);
+    }
+    site.lineLength = 0;
+    site.lineSkipped = false;
+    position = lineEnd + 1;
+  }
+}
+
+
+// Decodes the binary printed by printPanelBinary(), with or without spaces: byte 0, the stop bit, then the
+// remaining bytes.
+void dscGateway::processLine(dscGatewaySite &site, char * line, unsigned int) {
+  site.stats.lines++;
+
+  // KeybusReaderIP prints buffer overflows without a line ending
+  static const char overflowMessage[] = "Keybus buffer overflow";
+  if (strncmp(line, overflowMessage, sizeof(overflowMessage) - 1) == 0) site.stats.boardOverflows++;
+
+  char * position = strchr(line, ':');
+  if (!position) {
+    site.stats.skippedLines++;
+    return;
+  }
+  position++;
+
+  byte panelData[dscGatewayReadSize];
+  memset(panelData, 0, sizeof(panelData));
+  unsigned int panelBitCount = 0;
+  for (; *position; position++) {
+    char c = *position;
+    if (c == ' ') continue;
+    if (c != '0' && c != '1') break;
+    if (panelBitCount >= (dscGatewayReadSize - 1) * 8) break;
+
+    byte panelByte, panelBit;
+    if (panelBitCount < 8) {
+      panelByte = 0;
+      panelBit = 7 - panelBitCount;
+    }
+    else if (panelBitCount == 8) {
+      panelByte = 1;
+      panelBit = 0;
+    }
+    else {
+      panelByte = 2 + (panelBitCount - 9) / 8;
+      panelBit = 7 - (panelBitCount - 9) % 8;
+    }
+    if (c == '1') bitSet(panelData[panelByte], panelBit);
+    panelBitCount++;
+  }
+
+  // Panel lines continue with the command bytes in hex, module lines with a message
+  if (panelBitCount < 9 || strncmp(position, "[0x", 3) != 0 || strtoul(position + 3, NULL, 16) != panelData[0]) {
+    site.stats.skippedLines++;
+    return;
+  }
+
+  processPanel(site, panelData, panelBitCount);
+}
+
+
+// Decodes the status with the library panel profile, the version is only updated if the status changes
+void dscGateway::processPanel(dscGatewaySite &site, const byte * panelData, byte panelBitCount) {
+  if (!dscPanelProfile::validCRC(panelData, panelBitCount)) {
+    site.stats.invalidCommands++;
+    return;
+  }
+  site.stats.panelCommands++;
+
+  dscSiteStatus &status = site.status;
+  bool trouble = status.trouble, powerTrouble = status.powerTrouble, armed = status.armed;
+  byte openZones = status.openZones;
+  char display = status.display;
+
+  byte decodeFlags = dscPanelProfile::decodeFlags(panelData, panelBitCount);
+  if (decodeFlags & dscDecodeTrouble) trouble = dscPanelProfile::trouble(panelData);
+  if (decodeFlags & dscDecodePowerTrouble) powerTrouble = dscPanelProfile::powerTrouble(panelData);
+  if (decodeFlags & dscDecodeArmed) armed = dscPanelProfile::armed(panelData, 0);
+  if (decodeFlags & dscDecodeZones) openZones = dscPanelProfile::openZones(panelData);
+  if (dscPanelProfile::segmentDisplay) {
+    char character = dscPanelProfile::displayCharacter(panelData[0]);
+    if (character || panelData[0] == 0) display = character;
+  }
+
+  if (trouble == status.trouble && powerTrouble == status.powerTrouble && armed == status.armed
+      && openZones == status.openZones && display == status.display) return;
+
+  status.trouble = trouble;
+  status.powerTrouble = powerTrouble;
+  status.armed = armed;
+  status.openZones = openZones;
+  status.display = display;
+  status.version = ++version;
+  status.lastChange = time(NULL);
+}
+
+
+// Reconnects sites after the retry delay, and reconnects sites that stopped sending data
+void dscGateway::checkSites(unsigned long long currentTime) {
+  for (unsigned int number = 0; number < sites.size(); number++) {
+    dscGatewaySite &site = sites[number];
+    if (site.socket < 0) {
+      if (currentTime >= site.retryTime) connectSite(number);
+    }
+    else if (currentTime - site.lastDataTime > dscGatewayIdleTime) closeSite(number);
+  }
+  nextCheckTime = currentTime + dscGatewayCheckTime;
+}
+
+
+/*
+ *  Query socket
+ */
+void dscGateway::acceptQuery() {
+  int clientSocket = accept4(querySocket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (clientSocket < 0) return;
+
+  unsigned int number = 0;
+  while (number < clients.size() && clients[number].socket >= 0) number++;
+  if (number == clients.size()) clients.push_back(dscQueryClient());
+
+  dscQueryClient &client = clients[number];
+  client.socket = clientSocket;
+  client.queryLength = 0;
+  client.output.clear();
+  client.outputSent = 0;
+
+  epoll_event event;
+  event.events = EPOLLIN;
+  event.data.u64 = eventData(dscEventQueryClient, number);
+  epoll_ctl(epollSocket, EPOLL_CTL_ADD, clientSocket, &event);
+}
+
+
+void dscGateway::readQuery(unsigned int number) {
+  dscQueryClient &client = clients[number];
+  char data[dscGatewayQuerySize];
+  ssize_t dataLength = read(client.socket, data, sizeof(data));
+  if (dataLength <= 0) {
+    if (dataLength < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    closeQuery(number);
+    return;
+  }
+
+  for (ssize_t i = 0; i < dataLength; i++) {
+    if (data[i] == '\n') {
+      if (client.queryLength > 0 && client.query[client.queryLength - 1] == '\r') client.queryLength--;
+      client.query[client.queryLength] = '\0';
+      processQuery(client, client.query);
+      client.queryLength = 0;
+    }
+    else if (client.queryLength < dscGatewayQuerySize - 1) client.query[client.queryLength++] = data[i];
+  }
+
+  writeQuery(number);
+}
+
+
+// Sends as much of the response as the socket accepts, and waits for EPOLLOUT for the rest
+void dscGateway::writeQuery(unsigned int number) {
+  dscQueryClient &client = clients[number];
+  while (client.outputSent < client.output.size()) {
+    ssize_t sent = write(client.socket, &client.output[client.outputSent], client.output.size() - client.outputSent);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN) {
+        closeQuery(number);
+        return;
+      }
+      break;
+    }
+    client.outputSent += sent;
+  }
+
+  bool pending = client.outputSent < client.output.size();
+  if (!pending) {
+    client.output.clear();
+    client.outputSent = 0;
+  }
+
+  epoll_event event;
+  event.events = pending ? EPOLLIN | EPOLLOUT : EPOLLIN;
+  event.data.u64 = eventData(dscEventQueryClient, number);
+  epoll_ctl(epollSocket, EPOLL_CTL_MOD, client.socket, &event);
+}
+
+
+void dscGateway::closeQuery(unsigned int number) {
+  dscQueryClient &client = clients[number];
+  close(client.socket);
+  client.socket = -1;
+  std::vector<char>().swap(client.output);
+}
+
+
+static void appendText(std::vector<char> &output, const char * text) {
+  output.insert(output.end(), text, text + strlen(text));
+}
+
+
+void dscGateway::processQuery(dscQueryClient &client, const char * query) {
+  if (strcmp(query, "list") == 0) {
+    for (unsigned int site = 0; site < sites.size(); site++) appendSite(client.output, sites[site]);
+  }
+
+  else if (strncmp(query, "site ", 5) == 0) {
+    for (unsigned int site = 0; site < sites.size(); site++) {
+      if (strcmp(sites[site].status.name, query + 5) == 0) appendSite(client.output, sites[site]);
+    }
+  }
+
+  else if (strncmp(query, "changes ", 8) == 0) {
+    unsigned long knownVersion = strtoul(query + 8, NULL, 10);
+    for (unsigned int site = 0; site < sites.size(); site++) {
+      if (sites[site].status.version > knownVersion) appendSite(client.output, sites[site]);
+    }
+    char line[32];
+    snprintf(line, sizeof(line), "{\"version\":%lu}\n", version);
+    appendText(client.output, line);
+  }
+
+  else if (strcmp(query, "stats") == 0) {
+    for (unsigned int site = 0; site < sites.size(); site++) appendStats(client.output, sites[site]);
+  }
+
+  else if (query[0] != '\0') appendText(client.output, "{\"error\":\"Unknown query\"}\n");
+
+  appendText(client.output, "\n");
+}
+
+
+void dscGateway::appendSite(std::vector<char> &output, const dscGatewaySite &site) {
+  const dscSiteStatus &status = site.status;
+  char zones[32] = "";
+  unsigned int zonesLength = 0;
+  for (byte zoneBit = 0; zoneBit < 8; zoneBit++) {
+    if (bitRead(status.openZones, zoneBit)) {
+      zonesLength += snprintf(zones + zonesLength, sizeof(zones) - zonesLength, "%s%d", zonesLength ? "," : "", zoneBit + 1);
+    }
+  }
+
+  char display[2] = {status.display, '\0'};
+  char line[256];
+  snprintf(line, sizeof(line),
+           "{\"site\":\"%s\",\"version\":%lu,\"connected\":%s,\"trouble\":%s,\"powerTrouble\":%s,\"armed\":%s,"
+           "\"openZones\":[%s],\"display\":\"%s\",\"lastChange\":%lld}\n",
+           status.name, status.version, status.connected ? "true" : "false", status.trouble ? "true" : "false",
+           status.powerTrouble ? "true" : "false", status.armed ? "true" : "false", zones, display,
+           (long long)status.lastChange);
+  appendText(output, line);
+}
+
+
+void dscGateway::appendStats(std::vector<char> &output, const dscGatewaySite &site) {
+  const dscSiteStats &stats = site.stats;
+  char line[320];
+  snprintf(line, sizeof(line),
+           "{\"site\":\"%s\",\"bytes\":%llu,\"lines\":%lu,\"panelCommands\":%lu,\"invalidCommands\":%lu,"
+           "\"skippedLines\":%lu,\"boardOverflows\":%lu,\"connects\":%lu,\"disconnects\":%lu}\n",
+           site.status.name, stats.bytes, stats.lines, stats.panelCommands, stats.invalidCommands,
+           stats.skippedLines, stats.boardOverflows, stats.connects, stats.disconnects);
+  appendText(output, line);
+}
+
+
+unsigned long long dscGateway::currentMillis() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
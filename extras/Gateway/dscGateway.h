@@ -0,0 +1,113 @@
+
+#ifndef dscGateway_h
+#define dscGateway_h
+
+#include <stdint.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <vector>
+#include "Arduino.h"
+
+const byte dscGatewayReadSize = 16;            // Maximum panel bytes decoded from a line
+const unsigned int dscGatewayLineSize = 512;   // Longest line read from a board, longer lines are skipped
+const unsigned int dscGatewayNameSize = 32;
+const unsigned long dscGatewayRetryTime = 1000;        // Time in milliseconds before the first reconnect, doubled for each failure
+const unsigned long dscGatewayMaxRetryTime = 30000;    // Longest time between reconnects
+const unsigned long dscGatewayIdleTime = 30000;        // Reconnects if a board sends nothing for this time in milliseconds
+const unsigned int dscGatewayQuerySize = 256;          // Longest query line
+
+
+// Decoded status of one site, updated from each panel line.  version is the gateway change number of the
+// last change so a query can return only the sites changed since a previous query.
+struct dscSiteStatus {
+  char name[dscGatewayNameSize];
+  unsigned long version;
+  bool connected;        // Connected to the board
+  bool trouble, powerTrouble, armed;
+  byte openZones;        // Open zones 1-8
+  char display;          // Keypad display character, 0 if blank, segment display panels only
+  time_t lastChange;     // Time of the last status change
+};
+
+struct dscSiteStats {
+  unsigned long lines, panelCommands, invalidCommands, skippedLines, boardOverflows, connects, disconnects;
+  unsigned long long bytes;
+};
+
+
+// Reads KeybusReaderIP output from many boards and decodes the panel commands with the library panel profile.
+// All sites and query clients are handled on one thread with epoll: boards are connected with non-blocking
+// sockets and reconnected with an increasing delay, the status of all sites is held in one table read by the
+// query socket.
+//
+// Query socket: one query per line, the response is one JSON line per site and ends with an empty line.
+//   list              All sites
+//   site <name>       One site
+//   changes <version> Sites changed after the version, followed by {"version":N} with the current version
+//   stats             Line, command and connection counters per site
+class dscGateway {
+
+  public:
+    dscGateway();
+    ~dscGateway();
+
+    int addSite(const char * name, const char * host, unsigned int port);  // Returns the site number or -1
+    bool listenQuery(const char * host, unsigned int port);                // Opens the query socket, port 0 selects a free port
+    unsigned int queryPort();
+    void run(int timeout);          // Processes sockets ready within the timeout in milliseconds, call repeatedly
+    void stop();                    // Closes all sockets
+
+    unsigned int siteCount();
+    const dscSiteStatus & siteStatus(unsigned int site);
+    const dscSiteStats & siteStats(unsigned int site);
+    unsigned long statusVersion();  // Current change number
+
+    unsigned long events, wakeups;  // epoll events handled and epoll_wait() calls returning events
+
+  private:
+    struct dscGatewaySite {
+      dscSiteStatus status;
+      dscSiteStats stats;
+      sockaddr_in address;
+      int socket;
+      bool connecting;
+      unsigned long retryDelay;
+      unsigned long long retryTime, lastDataTime;
+      char line[dscGatewayLineSize];
+      unsigned int lineLength;
+      bool lineSkipped;
+    };
+
+    struct dscQueryClient {
+      int socket;
+      char query[dscGatewayQuerySize];
+      unsigned int queryLength;
+      std::vector<char> output;
+      size_t outputSent;
+    };
+
+    void connectSite(unsigned int site);
+    void closeSite(unsigned int site);
+    void readSite(unsigned int site);
+    void processLine(dscGatewaySite &site, char * line, unsigned int length);
+    void processPanel(dscGatewaySite &site, const byte * panelData, byte panelBitCount);
+    void checkSites(unsigned long long currentTime);
+
+    void acceptQuery();
+    void readQuery(unsigned int client);
+    void writeQuery(unsigned int client);
+    void closeQuery(unsigned int client);
+    void processQuery(dscQueryClient &client, const char * query);
+    void appendSite(std::vector<char> &output, const dscGatewaySite &site);
+    void appendStats(std::vector<char> &output, const dscGatewaySite &site);
+
+    static unsigned long long currentMillis();
+
+    int epollSocket, querySocket;
+    std::vector<dscGatewaySite> sites;
+    std::vector<dscQueryClient> clients;
+    unsigned long version;
+    unsigned long long nextCheckTime;
+};
+
+#endif  // dscGateway_h
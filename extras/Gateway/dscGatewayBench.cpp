@@ -0,0 +1,326 @@
+/*
+ *  DSC Keybus Gateway benchmark
+ *
+ *  Simulates KeybusReaderIP boards on local sockets: a separate thread listens on one port per board and
+ *  sends panel and keypad lines in the KeybusReaderIP format, with the panel status changing every 32 lines.
+ *  The gateway runs on the main thread and is checked against the last status sent by each board.
+ *
+ *  Usage: dscGatewayBench [boards] [seconds] [lines per second per board, 0 sends as fast as possible]
+ *  Default: 200 boards, 5 seconds, 50 lines per second
+ */
+
+#include "dscGateway.h"
+#include "../../src/dscKeybusPanelProfile.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <string>
+#include <vector>
+
+struct benchBoard {
+  int listenSocket, socket;
+  unsigned int port;
+  unsigned long lines;
+  unsigned long long bytes;
+  std::string pending;
+  size_t pendingSent;
+};
+
+static std::vector<benchBoard> boards;
+static unsigned int benchSeconds = 5, benchRate = 50;
+static volatile bool sendersDone = false;
+
+
+// Panel status of a board for a line number, changes every 32 lines
+static void boardStatus(unsigned int board, unsigned long line, bool &armed, bool &trouble, byte &openZones, byte &digit) {
+  unsigned long step = line / 32 + board;
+  armed = step & 0x01;
+  trouble = (step >> 1) & 0x01;
+  openZones = (step * 7) & 0x7F;
+  digit = step % 10;
+}
+
+
+static void encodePanel(unsigned int board, unsigned long line, byte * panelData, byte &panelByteCount) {
+  bool armed, trouble;
+  byte openZones, digit;
+  boardStatus(board, line, armed, trouble, openZones, digit);
+  memset(panelData, 0, dscGatewayReadSize);
+
+  #if defined(dscPowerSeries)
+  panelData[0] = 0x27;
+  panelData[2] = (armed ? 0x02 : 0x01) | (trouble ? 0x10 : 0);
+  panelData[3] = armed ? 0x04 : 0x01;
+  panelData[6] = openZones;
+  for (byte panelByte = 0; panelByte < 7; panelByte++) {
+    if (panelByte != 1) panelData[7] += panelData[panelByte];
+  }
+  panelByteCount = 8;
+  #else
+  static const byte digits[] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+  panelData[0] = digits[digit];
+  panelData[2] = openZones << 1;
+  panelData[3] = (armed ? 0 : 0x01) | (trouble ? 0x08 : 0);
+  panelByteCount = 4;
+  #endif
+}
+
+
+// Appends a line as printed by KeybusReaderIP: timestamp, printPanelBinary(), printPanelCommand() and a message,
+// with a keypad line after every 16 panel lines
+static void appendLine(std::string &output, unsigned int board, unsigned long line) {
+  char text[256];
+  float timeStamp = benchRate ? (float)line / benchRate : line / 1000.0;
+  int length = snprintf(text, sizeof(text), "%8.2f: ", timeStamp);
+
+  byte panelData[dscGatewayReadSize];
+  byte panelByteCount;
+  encodePanel(board, line, panelData, panelByteCount);
+  for (byte panelByte = 0; panelByte < panelByteCount; panelByte++) {
+    if (panelByte == 1) text[length++] = '0' + panelData[1];
+    else {
+      for (byte mask = 0x80; mask; mask >>= 1) text[length++] = (mask & panelData[panelByte]) ? '1' : '0';
+    }
+    if (panelByte != panelByteCount - 1) text[length++] = ' ';
+  }
+  length += snprintf(text + length, sizeof(text) - length, " [0x%02X, 0x%02X, 0x%02X] Status\r\n",
+                     panelData[0], panelData[2], panelData[3]);
+
+  if (line % 16 == 15) {
+    length += snprintf(text + length, sizeof(text) - length,
+                       "%8.2f: 11111111 1 11111111 11111111 [Keypad] No key\r\n", timeStamp);
+  }
+  output.append(text, length);
+}
+
+
+// Writes pending lines, returns false if the socket is closed
+static bool sendBoard(benchBoard &board) {
+  while (board.pendingSent < board.pending.size()) {
+    ssize_t sent = write(board.socket, board.pending.data() + board.pendingSent, board.pending.size() - board.pendingSent);
+    if (sent < 0) return errno == EAGAIN || errno == EINTR;
+    board.pendingSent += sent;
+    board.bytes += sent;
+  }
+  board.pending.clear();
+  board.pendingSent = 0;
+  return true;
+}
+
+
+static unsigned long long benchMicros() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+// Accepts the gateway connections and sends lines at the rate, or as fast as the sockets accept them
+static void * runBoards(void *) {
+  int epollSocket = epoll_create1(0);
+  for (unsigned int number = 0; number < boards.size(); number++) {
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = number;
+    epoll_ctl(epollSocket, EPOLL_CTL_ADD, boards[number].listenSocket, &event);
+  }
+
+  unsigned long long startTime = 0;
+  unsigned int connected = 0;
+  bool sending = true;
+  while (true) {
+    epoll_event readyEvents[256];
+    int readyCount = epoll_wait(epollSocket, readyEvents, 256, 10);
+    unsigned long long currentTime = benchMicros();
+
+    for (int i = 0; i < readyCount; i++) {
+      benchBoard &board = boards[readyEvents[i].data.u32];
+      if (readyEvents[i].events & EPOLLIN && board.socket < 0) {
+        board.socket = accept4(board.listenSocket, NULL, NULL, SOCK_NONBLOCK);
+        if (board.socket < 0) continue;
+        const char * greeting = "Connected to DSC Keybus Reader\r\n";
+        board.pending.append(greeting);
+        if (!benchRate) {
+          epoll_event event;
+          event.events = EPOLLOUT;
+          event.data.u32 = readyEvents[i].data.u32;
+          epoll_ctl(epollSocket, EPOLL_CTL_ADD, board.socket, &event);
+        }
+        if (++connected == boards.size()) startTime = currentTime;
+      }
+    }
+
+    // Starts sending once all boards are connected
+    if (!startTime) continue;
+    if (currentTime - startTime >= benchSeconds * 1000000ULL) sending = false;
+
+    bool pending = false;
+    unsigned long dueLines = benchRate ? (currentTime - startTime) * benchRate / 1000000 : 0;
+    for (unsigned int number = 0; number < boards.size(); number++) {
+      benchBoard &board = boards[number];
+      if (sending) {
+        if (benchRate) {
+          while (board.lines < dueLines) appendLine(board.pending, number, board.lines++);
+        }
+        else {
+          while (board.pending.size() < 8192) appendLine(board.pending, number, board.lines++);
+        }
+      }
+      if (!sendBoard(board)) {
+        fprintf(stderr, "Board %u disconnected\n", number);
+        exit(1);
+      }
+      if (!board.pending.empty()) pending = true;
+    }
+    if (!sending && !pending) break;
+  }
+
+  close(epollSocket);
+  sendersDone = true;
+  return NULL;
+}
+
+
+static unsigned long long threadCPUTime() {
+  rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return (unsigned long long)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+
+// Sends a query and returns the number of response lines before the empty line
+static unsigned int query(dscGateway &gateway, const char * text, std::string &response) {
+  int querySocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(gateway.queryPort());
+  inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+  connect(querySocket, (sockaddr *)&address, sizeof(address));
+
+  // The gateway runs on this thread, so the query is sent and read between run() calls
+  bool sent = false;
+  response.clear();
+  while (response.size() < 2 || response.compare(response.size() - 2, 2, "\n\n") != 0) {
+    gateway.run(1);
+    if (!sent && write(querySocket, text, strlen(text)) == (ssize_t)strlen(text)) sent = true;
+    char data[4096];
+    ssize_t dataLength = read(querySocket, data, sizeof(data));
+    if (dataLength > 0) response.append(data, dataLength);
+    if (dataLength == 0) break;
+  }
+  close(querySocket);
+
+  unsigned int lines = 0;
+  for (size_t i = 0; i < response.size(); i++) {
+    if (response[i] == '\n') lines++;
+  }
+  return lines > 0 ? lines - 1 : 0;
+}
+
+
+int main(int argc, char * argv[]) {
+  unsigned int boardCount = argc > 1 ? atoi(argv[1]) : 200;
+  if (argc > 2) benchSeconds = atoi(argv[2]);
+  if (argc > 3) benchRate = atoi(argv[3]);
+  signal(SIGPIPE, SIG_IGN);
+
+  dscGateway gateway;
+  if (!gateway.listenQuery("127.0.0.1", 0)) {
+    fprintf(stderr, "Unable to open the query socket\n");
+    return 1;
+  }
+
+  boards.resize(boardCount);
+  for (unsigned int number = 0; number < boardCount; number++) {
+    benchBoard &board = boards[number];
+    board.socket = -1;
+    board.lines = 0;
+    board.bytes = 0;
+    board.pendingSent = 0;
+    board.listenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+
+    sockaddr_in address;
+    socklen_t addressLength = sizeof(address);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (bind(board.listenSocket, (sockaddr *)&address, sizeof(address)) != 0 || listen(board.listenSocket, 1) != 0) {
+      fprintf(stderr, "Unable to open board %u: %s\n", number, strerror(errno));
+      return 1;
+    }
+    getsockname(board.listenSocket, (sockaddr *)&address, &addressLength);
+    board.port = ntohs(address.sin_port);
+
+    char name[dscGatewayNameSize];
+    snprintf(name, sizeof(name), "site-%u", number);
+    gateway.addSite(name, "127.0.0.1", board.port);
+  }
+
+  if (benchRate) printf("Boards: %u, %u seconds, %u lines/s per board\n", boardCount, benchSeconds, benchRate);
+  else printf("Boards: %u, %u seconds, unlimited rate\n", boardCount, benchSeconds);
+
+  pthread_t boardThread;
+  pthread_create(&boardThread, NULL, runBoards, NULL);
+
+  // Runs the gateway until the boards are done and all data is read
+  unsigned long long startTime = benchMicros();
+  unsigned long long startCPUTime = threadCPUTime();
+  while (true) {
+    gateway.run(10);
+    if (!sendersDone) continue;
+    bool complete = true;
+    for (unsigned int number = 0; number < boardCount && complete; number++) {
+      complete = gateway.siteStats(number).bytes == boards[number].bytes;
+    }
+    if (complete) break;
+  }
+  unsigned long long elapsedTime = benchMicros() - startTime;
+  unsigned long long cpuTime = threadCPUTime() - startCPUTime;
+  pthread_join(boardThread, NULL);
+
+  // Checks the status of each site against the last line sent
+  unsigned long lines = 0, panelCommands = 0, skippedLines = 0, mismatches = 0;
+  unsigned long long bytes = 0;
+  for (unsigned int number = 0; number < boardCount; number++) {
+    const dscSiteStats &stats = gateway.siteStats(number);
+    const dscSiteStatus &status = gateway.siteStatus(number);
+    lines += stats.lines;
+    panelCommands += stats.panelCommands;
+    skippedLines += stats.skippedLines;
+    bytes += stats.bytes;
+
+    bool armed, trouble;
+    byte openZones, digit;
+    boardStatus(number, boards[number].lines - 1, armed, trouble, openZones, digit);
+    bool match = stats.panelCommands == boards[number].lines && status.connected && status.armed == armed
+                 && status.trouble == trouble && status.openZones == openZones;
+    if (dscPanelProfile::segmentDisplay) match = match && status.display == '0' + digit;
+    if (!match) mismatches++;
+  }
+
+  printf("Lines: %lu (%lu panel commands, %lu skipped), %.1f MB\n", lines, panelCommands, skippedLines, bytes / 1e6);
+  printf("Gateway thread: %.2f s elapsed, %.2f s CPU (%.1f%% of one core)\n", elapsedTime / 1e6, cpuTime / 1e6, 100.0 * cpuTime / elapsedTime);
+  printf("Throughput: %.0f lines/s, %.2f us CPU per line\n", lines * 1e6 / elapsedTime, (double)cpuTime / lines);
+  printf("epoll: %lu wakeups, %.1f events per wakeup\n", gateway.wakeups, gateway.wakeups ? (double)gateway.events / gateway.wakeups : 0);
+
+  std::string response;
+  unsigned long long queryStart = benchMicros();
+  unsigned int siteLines = query(gateway, "list\n", response);
+  printf("Query list: %u sites, %zu bytes, %.2f ms\n", siteLines, response.size(), (benchMicros() - queryStart) / 1000.0);
+  unsigned int changedLines = query(gateway, "changes 0\n", response);
+
+  printf("Status mismatches: %lu\n", mismatches);
+  gateway.stop();
+  return mismatches == 0 && siteLines == boardCount && changedLines == boardCount + 1 ? 0 : 1;
+}
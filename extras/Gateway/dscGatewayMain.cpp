@@ -0,0 +1,75 @@
+/*
+ *  DSC Keybus Gateway
+ *
+ *  Connects to KeybusReaderIP boards at many sites, decodes the panel commands with the library panel profile
+ *  and serves the status of all sites on a query socket.  All connections are handled on one thread.
+ *
+ *  Usage: dscGateway [-q address:port] name=host[:port] ...
+ *    -q    Query socket address (default: 127.0.0.1:8023)
+ *    name  Site name, letters, digits, '-', '_' and '.'
+ *    port  KeybusReaderIP port (default: 23)
+ *
+ *  Query the status with: printf 'list\n' | nc 127.0.0.1 8023
+ */
+
+#include "dscGateway.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static volatile sig_atomic_t running = 1;
+
+static void stopGateway(int) {
+  running = 0;
+}
+
+
+// Splits "host:port" in place, returns the default port if the port is not specified
+static unsigned int splitPort(char * address, unsigned int defaultPort) {
+  char * separator = strrchr(address, ':');
+  if (!separator) return defaultPort;
+  *separator = '\0';
+  return strtoul(separator + 1, NULL, 10);
+}
+
+
+int main(int argc, char * argv[]) {
+  dscGateway gateway;
+  char queryAddress[64] = "127.0.0.1:8023";
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+      snprintf(queryAddress, sizeof(queryAddress), "%s", argv[++i]);
+      continue;
+    }
+
+    char * host = strchr(argv[i], '=');
+    if (!host) {
+      fprintf(stderr, "Usage: %s [-q address:port] name=host[:port] ...\n", argv[0]);
+      return 1;
+    }
+    *host++ = '\0';
+    unsigned int port = splitPort(host, 23);
+    if (gateway.addSite(argv[i], host, port) < 0) {
+      fprintf(stderr, "Invalid site: %s=%s\n", argv[i], host);
+      return 1;
+    }
+  }
+
+  unsigned int queryPort = splitPort(queryAddress, 8023);
+  if (!gateway.listenQuery(queryAddress, queryPort)) {
+    fprintf(stderr, "Unable to open the query socket: %s:%u\n", queryAddress, queryPort);
+    return 1;
+  }
+  fprintf(stderr, "%u sites, query socket: %s:%u\n", gateway.siteCount(), queryAddress, gateway.queryPort());
+
+  signal(SIGINT, stopGateway);
+  signal(SIGTERM, stopGateway);
+  signal(SIGPIPE, SIG_IGN);
+  while (running) gateway.run(1000);
+
+  gateway.stop();
+  return 0;
+}
@@ -0,0 +1,337 @@
+
+#include "Arduino.h"
+#if defined(ESP8266)
+#include "EEPROM.h"
+#include "FS.h"
+#endif
+
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(ESP8266) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+HardwareSerial Serial;
+
+static byte pinLevels[256];
+static void (*pinInterrupts[256])();
+static bool timeSet = false;
+static unsigned long long setTime;
+
+
+size_t Print::write(const uint8_t * data, size_t dataSize) {
+  size_t written = 0;
+  while (written < dataSize && write(data[written])) written++;
+  return written;
+}
+
+
+size_t Print::print(long value, int base) {
+  if (base == DEC) {
+    char text[24];
+    snprintf(text, sizeof(text), "%ld", value);
+    return write(text);
+  }
+  return print((unsigned long)value, base);
+}
+
+
+size_t Print::print(unsigned long value, int base) {
+  char text[24];
+  snprintf(text, sizeof(text), base == HEX ? "%lX" : "%lu", value);
+  return write(text);
+}
+
+
+size_t Print::print(double value, int digits) {
+  char text[48];
+  snprintf(text, sizeof(text), "%.*f", digits, value);
+  return write(text);
+}
+
+
+size_t HardwareSerial::write(uint8_t character) {
+  return fputc(character, stdout) == EOF ? 0 : 1;
+}
+
+
+size_t HardwareSerial::write(const uint8_t * data, size_t dataSize) {
+  return fwrite(data, 1, dataSize, stdout);
+}
+
+
+int HardwareSerial::available() {
+  fflush(stdout);
+  pollfd input = {STDIN_FILENO, POLLIN, 0};
+  return ::poll(&input, 1, 0) > 0 && (input.revents & POLLIN) ? 1 : 0;
+}
+
+
+int HardwareSerial::read() {
+  if (!available()) return -1;
+  unsigned char character;
+  return ::read(STDIN_FILENO, &character, 1) == 1 ? character : -1;
+}
+
+
+static unsigned long long monotonicMicros() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+unsigned long micros() {
+  return timeSet ? setTime : monotonicMicros();
+}
+
+
+unsigned long millis() {
+  return (timeSet ? setTime : monotonicMicros()) / 1000;
+}
+
+
+void delay(unsigned long milliseconds) {
+  fflush(stdout);
+  usleep(milliseconds * 1000);
+}
+
+
+void yield() {
+  fflush(stdout);
+}
+
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (mode == INPUT_PULLUP) pinLevels[pin] = HIGH;
+}
+
+
+int digitalRead(uint8_t pin) {
+  return pinLevels[pin];
+}
+
+
+// Writes are not sent to the line, the virtual keypad requires writes within microseconds of a clock edge
+void digitalWrite(uint8_t pin, uint8_t level) {
+  pinLevels[pin] = level;
+}
+
+
+#if defined(ESP8266)
+uint32_t dscLinuxGPC[256];
+uint32_t GPIEC;
+
+static void (*timerInterrupt)();
+static bool timerEnabled, timerArmed, timerLoop;
+static unsigned long long timerFireTime, timerPeriod;
+EspClass ESP;
+
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode) {
+  pinInterrupts[interrupt] = handler;
+  GPC(interrupt) = (mode & 0x0F) << GPCI;
+}
+
+
+void detachInterrupt(uint8_t interrupt) {
+  pinInterrupts[interrupt] = NULL;
+  GPC(interrupt) = 0;
+}
+
+
+void timer1_isr_init() {}
+
+
+void timer1_attachInterrupt(void (*handler)()) {
+  timerInterrupt = handler;
+}
+
+
+void timer1_detachInterrupt() {
+  timerInterrupt = NULL;
+  timerArmed = false;
+}
+
+
+void timer1_enable(uint8_t, uint8_t, uint8_t reload) {
+  timerEnabled = true;
+  timerLoop = reload == TIM_LOOP;
+}
+
+
+void timer1_disable() {
+  timerEnabled = false;
+  timerArmed = false;
+}
+
+
+void timer1_write(uint32_t ticks) {
+  timerPeriod = ticks / 5;
+  timerFireTime = micros() + timerPeriod;
+  timerArmed = true;
+}
+
+
+uint32_t EspClass::getCycleCount() {
+  #if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+  #else
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000ULL + now.tv_nsec;
+  #endif
+}
+
+
+bool dscLinuxTimerTime(unsigned long long &fireTime) {
+  if (!timerEnabled || !timerArmed || !timerInterrupt) return false;
+  fireTime = timerFireTime;
+  return true;
+}
+
+
+// A single timer is disarmed before the interrupt, which can write the timer again
+void dscLinuxRunTimer() {
+  if (timerLoop) timerFireTime += timerPeriod;
+  else timerArmed = false;
+  timerInterrupt();
+}
+
+
+static byte flashSector[4096];
+static bool flashErased = false;
+static byte eepromCache[sizeof(flashSector)];
+static size_t eepromSize;
+EEPROMClass EEPROM;
+
+
+void EEPROMClass::begin(size_t size) {
+  if (!flashErased) {
+    memset(flashSector, 0xFF, sizeof(flashSector));
+    flashErased = true;
+  }
+  eepromSize = size < sizeof(flashSector) ? size : sizeof(flashSector);
+  memcpy(eepromCache, flashSector, eepromSize);
+}
+
+
+uint8_t EEPROMClass::read(int address) {
+  return (size_t)address < eepromSize ? eepromCache[address] : 0;
+}
+
+
+void EEPROMClass::write(int address, uint8_t value) {
+  if ((size_t)address < eepromSize) eepromCache[address] = value;
+}
+
+
+bool EEPROMClass::commit() {
+  if (eepromSize == 0) return false;
+  memset(flashSector, 0xFF, sizeof(flashSector));
+  memcpy(flashSector, eepromCache, eepromSize);
+  commits++;
+  return true;
+}
+
+
+namespace fs {
+
+size_t File::write(uint8_t character) {
+  return file && fputc(character, file) != EOF ? 1 : 0;
+}
+
+
+size_t File::write(const uint8_t * data, size_t dataSize) {
+  return file ? fwrite(data, 1, dataSize, file) : 0;
+}
+
+
+size_t File::read(uint8_t * data, size_t dataSize) {
+  return file ? fread(data, 1, dataSize, file) : 0;
+}
+
+
+int File::read() {
+  return file ? fgetc(file) : -1;
+}
+
+
+bool File::seek(uint32_t position, SeekMode mode) {
+  int origin = mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END;
+  return file && fseek(file, position, origin) == 0;
+}
+
+
+size_t File::size() {
+  if (!file) return 0;
+  long position = ftell(file);
+  fseek(file, 0, SEEK_END);
+  long fileSize = ftell(file);
+  fseek(file, position, SEEK_SET);
+  return fileSize;
+}
+
+
+void File::flush() {
+  if (file) fflush(file);
+}
+
+
+void File::close() {
+  if (file) fclose(file);
+  file = NULL;
+}
+
+
+bool FS::exists(const char * path) {
+  char hostPath[256];
+  snprintf(hostPath, sizeof(hostPath), "%s%s", directory, path);
+  return access(hostPath, F_OK) == 0;
+}
+
+
+File FS::open(const char * path, const char * mode) {
+  char hostPath[256];
+  snprintf(hostPath, sizeof(hostPath), "%s%s", directory, path);
+  return File(fopen(hostPath, mode));
+}
+
+}  // namespace fs
+
+#else
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int) {
+  pinInterrupts[interrupt] = handler;
+}
+
+
+void detachInterrupt(uint8_t interrupt) {
+  pinInterrupts[interrupt] = NULL;
+}
+#endif
+
+
+void dscLinuxSetPin(uint8_t pin, bool level) {
+  pinLevels[pin] = level;
+}
+
+
+// On esp8266, the interrupt is disabled while the pin interrupt type is cleared
+void (*dscLinuxInterrupt(uint8_t pin))() {
+  #if defined(ESP8266)
+  if (!GPC(pin)) return NULL;
+  #endif
+  return pinInterrupts[pin];
+}
+
+
+void dscLinuxSetTime(unsigned long long timeMicros) {
+  setTime = timeMicros;
+  timeSet = true;
+}
+
+
+void dscLinuxClearTime() {
+  timeSet = false;
+}
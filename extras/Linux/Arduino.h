@@ -0,0 +1,146 @@
+
+#ifndef Arduino_h
+#define Arduino_h
+
+// Arduino core functions used by the library, for building the library on Linux with dscLinuxCapture.  The
+// interrupts are called by dscLinuxCapture::poll() on the same thread as the sketch loop, so noInterrupts() and
+// interrupts() do nothing.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define DEC 10
+#define HEX 16
+
+#define PROGMEM
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+
+class __FlashStringHelper;
+#define F(string) (reinterpret_cast<const __FlashStringHelper *>(string))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define digitalPinToInterrupt(pin) (pin)
+
+
+class Print {
+
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t character) = 0;
+    virtual size_t write(const uint8_t * data, size_t dataSize);
+    size_t write(const char * text) { return text ? write((const uint8_t *)text, strlen(text)) : 0; }
+
+    size_t print(const __FlashStringHelper * text) { return write((const char *)text); }
+    size_t print(const char * text) { return write(text); }
+    size_t print(char character) { return write((uint8_t)character); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(int value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(T value) { size_t length = print(value); return length + println(); }
+    template <typename T> size_t println(T value, int format) { size_t length = print(value, format); return length + println(); }
+};
+
+
+class Stream : public Print {
+
+  public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+};
+
+
+// Serial prints to stdout and reads from stdin
+class HardwareSerial : public Stream {
+
+  public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t character);
+    size_t write(const uint8_t * data, size_t dataSize);
+    using Print::write;
+    int available();
+    int read();
+};
+
+extern HardwareSerial Serial;
+
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long milliseconds);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode);
+void detachInterrupt(uint8_t interrupt);
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// Used by dscLinuxCapture: pin levels read by digitalRead(), the interrupt handler for a pin, and the time
+// returned by millis() and micros() while events are replayed - the monotonic clock is used if not set.
+void dscLinuxSetPin(uint8_t pin, bool level);
+void (*dscLinuxInterrupt(uint8_t pin))();
+void dscLinuxSetTime(unsigned long long timeMicros);
+void dscLinuxClearTime();
+
+
+#if defined(ESP8266)
+// esp8266 GPIO interrupt registers and timer1 used by the library, to run its esp8266 interrupt paths on the
+// host with dscLinuxSim.  GPC() holds the interrupt type of each pin set by attachInterrupt(), a pin with the type
+// cleared has no interrupt.  timer1 runs at 5 ticks per microsecond with TIM_DIV16 and fires once after each
+// timer1_write() with TIM_SINGLE or repeatedly with TIM_LOOP.
+#define TIM_DIV16 1
+#define TIM_EDGE 0
+#define TIM_SINGLE 0
+#define TIM_LOOP 1
+#define GPCI 7
+#define GPC(pin) dscLinuxGPC[pin]
+extern uint32_t dscLinuxGPC[256];
+extern uint32_t GPIEC;
+
+void timer1_isr_init();
+void timer1_attachInterrupt(void (*handler)());
+void timer1_detachInterrupt();
+void timer1_enable(uint8_t divider, uint8_t interruptType, uint8_t reload);
+void timer1_disable();
+void timer1_write(uint32_t ticks);
+
+class EspClass {
+
+  public:
+    uint32_t getCycleCount();  // rdtsc on x86, nanoseconds elsewhere
+};
+
+extern EspClass ESP;
+
+// Used by dscLinuxSim: the time in microseconds timer1 fires next if it is armed, and calling the timer interrupt
+bool dscLinuxTimerTime(unsigned long long &fireTime);
+void dscLinuxRunTimer();
+#endif
+
+#endif  // Arduino_h
@@ -0,0 +1,21 @@
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <Arduino.h>
+
+// esp8266 EEPROM emulation: begin() copies the flash sector to a RAM cache, and commit() erases the sector and
+// writes the cache back.  The sector is kept for the life of the process, so a test can restart the library with
+// new objects, and sector erases are counted in commits.
+class EEPROMClass {
+
+  public:
+    void begin(size_t size);
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    bool commit();
+    unsigned long commits;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif  // EEPROM_h
@@ -0,0 +1,49 @@
+#ifndef FS_h
+#define FS_h
+
+#include <Arduino.h>
+
+// esp8266 flash filesystem API used by the library, on host files
+namespace fs {
+
+enum SeekMode { SeekSet, SeekCur, SeekEnd };
+
+// Copies share the open file as on esp8266, the file is closed by close()
+class File : public Stream {
+
+  public:
+    File(FILE * setFile = NULL) { file = setFile; }
+    size_t write(uint8_t character);
+    size_t write(const uint8_t * data, size_t dataSize);
+    using Print::write;
+    size_t read(uint8_t * data, size_t dataSize);
+    int read();
+    bool seek(uint32_t position, SeekMode mode);
+    size_t size();
+    void flush();
+    void close();
+    operator bool() const { return file != NULL; }
+
+  private:
+    FILE * file;
+};
+
+
+// Paths are opened in the host directory set by the constructor
+class FS {
+
+  public:
+    FS(const char * setDirectory) { directory = setDirectory; }
+    bool exists(const char * path);
+    File open(const char * path, const char * mode);
+
+  private:
+    const char * directory;
+};
+
+}  // namespace fs
+
+using fs::FS;
+using fs::File;
+
+#endif  // FS_h
@@ -0,0 +1,94 @@
+/*
+ *  DSC Keybus Reader for Linux
+ *
+ *  Decodes the Keybus from GPIO edge events on a Linux board and prints the panel and keypad data as the
+ *  KeybusReader sketch does.  The Keybus clock and data lines are connected to GPIO lines as for the esp8266,
+ *  through the same resistor dividers.
+ *
+ *  Usage: KeybusReaderLinux /dev/gpiochip0
+ *         KeybusReaderLinux -f <event file>
+ */
+
+#include <dscKeybusInterface.h>
+#include "dscKeybusLinux.h"
+
+// Configures the GPIO line offsets on the gpiochip for the clock and data lines
+#define dscClockPin 5
+#define dscReadPin  4
+
+dscKeybusInterface dsc(dscClockPin, dscReadPin);
+dscLinuxCapture capture(dscClockPin, dscReadPin);
+
+void printModule();
+void printTimestamp();
+
+
+int main(int argc, char * argv[]) {
+  bool replay = argc == 3 && strcmp(argv[1], "-f") == 0;
+  if (argc != 2 && !replay) {
+    fprintf(stderr, "Usage: %s /dev/gpiochipN\n", argv[0]);
+    fprintf(stderr, "       %s -f <event file>\n", argv[0]);
+    return 1;
+  }
+  const char * path = argv[replay ? 2 : 1];
+
+  if (!(replay ? capture.openFile(path) : capture.openChip(path))) {
+    fprintf(stderr, "Unable to open %s\n", path);
+    return 1;
+  }
+
+  dsc.processModuleData = true;
+  dsc.begin(Serial);
+  Serial.println(F("DSC Keybus Interface is online."));
+
+  while (capture.poll(100) >= 0) {
+    while (dsc.handlePanel()) {
+      if (dsc.statusChanged) {
+        dsc.statusChanged = false;
+        if (dsc.keybusChanged) {
+          dsc.keybusChanged = false;
+          if (dsc.keybusConnected) Serial.println(F("Keybus connected"));
+          else Serial.println(F("Keybus disconnected"));
+        }
+      }
+
+      if (dsc.bufferOverflow) {
+        Serial.println(F("Keybus buffer overflow"));
+        dsc.bufferOverflow = false;
+      }
+
+      printTimestamp();
+      Serial.print(" ");
+      dsc.printPanelBinary();
+      Serial.print(" [");
+      dsc.printPanelCommand();
+      Serial.print("] ");
+      dsc.printPanelMessage();
+      Serial.println();
+
+      if (dsc.handleModule()) printModule();
+    }
+    if (dsc.handleModule()) printModule();
+  }
+
+  fprintf(stderr, "%llu edges, %llu clock edges, %llu samples, %lu lost events\n", capture.edges, capture.clockEdges, capture.samples, capture.lostEvents);
+  return 0;
+}
+
+
+void printModule() {
+  printTimestamp();
+  Serial.print(" ");
+  dsc.printModuleBinary();
+  Serial.print(" ");
+  dsc.printModuleMessage();
+  Serial.println();
+}
+
+
+// Prints the capture time in seconds
+void printTimestamp() {
+  char timeStamp[16];
+  snprintf(timeStamp, sizeof(timeStamp), "%8.2f:", millis() / 1000.0);
+  Serial.print(timeStamp);
+}
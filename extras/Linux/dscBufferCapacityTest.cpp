@@ -0,0 +1,78 @@
+/*
+ *  Panel buffer capacity test
+ *
+ *  Sends commands of one length on the simulated Keybus without calling handlePanel(), as a sketch that is
+ *  busy, until the panel buffer overflows.  Then reads the buffered commands and checks each against the command
+ *  sent.  Prints the commands buffered, the bytes used per command, and the commands that fit in the 180 bytes
+ *  of dscBufferSize on AVR with the same record size.  Two commands alternate so status commands are not
+ *  counted as repeats.
+ *
+ *  Usage: dscBufferCapacityTest
+ */
+
+#include <dscKeybusInterface.h>
+#include "dscLinuxSim.h"
+
+const byte simClockPin = 5;
+const byte simDataPin = 4;
+
+dscKeybusInterface dsc(simClockPin, simDataPin);  // Global as in the sketches
+dscLinuxSim keybus(simClockPin, simDataPin);
+
+const unsigned int avrBufferSize = 180;
+
+struct capacityTest {
+  const char * description;
+  const char * bits[2];
+  byte dataIndex;    // The byte that differs between the two commands
+  byte data[2];
+};
+
+const capacityTest tests[] = {
+  {"26-bit status",  {"00000101 0 10000001 00000001", "00000101 0 10000001 00000011"}, 3, {0x01, 0x03}},
+  {"34-bit display", {"01110001 0 00000110 00000001 00000000", "01110001 0 00000110 00000001 00000010"}, 4, {0x00, 0x02}},
+  {"42-bit command", {"00100111 0 10000001 00000001 10010001 11000111", "00100111 0 10000001 00000001 10010001 11000101"}, 5, {0xC7, 0xC5}},
+};
+
+static unsigned long failures;
+
+
+static void runTest(const capacityTest &test) {
+  dsc.bufferOverflow = false;
+  dsc.bufferPeak = 0;
+
+  unsigned int sent = 0;
+  while (!dsc.bufferOverflow) keybus.command(test.bits[sent++ % 2]);
+  unsigned int buffered = dsc.bufferedCommands();
+  unsigned int recordSize = buffered ? dsc.bufferPeak / buffered : 0;
+
+  // The command that overflowed is lost, the buffered commands alternate from the first
+  unsigned int read = 0;
+  while (dsc.bufferedCommands()) {
+    if (!dsc.handlePanel()) continue;
+    if (dsc.panelData[test.dataIndex] != test.data[read % 2]) {
+      printf("FAIL %s: command %u byte 0x%02X\n", test.description, read, dsc.panelData[test.dataIndex]);
+      failures++;
+    }
+    read++;
+  }
+  if (read != buffered) failures++;
+
+  printf("%-15s %2u bytes per command: %3u commands in %u bytes, %2u in %u bytes (AVR)\n", test.description, recordSize, buffered,
+         dscBufferSize, recordSize ? avrBufferSize / recordSize : 0, avrBufferSize);
+}
+
+
+int main() {
+  dsc.begin(Serial);
+  keybus.begin();
+
+  // The first command is used to find the start of the Keybus data
+  keybus.command("00000101 0 10000001 00000111");
+  while (dsc.bufferedCommands()) dsc.handlePanel();
+
+  for (const capacityTest &test : tests) runTest(test);
+
+  printf("Capacity: %lu failures\n", failures);
+  return failures ? 1 : 0;
+}
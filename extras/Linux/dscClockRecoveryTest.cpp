@@ -0,0 +1,67 @@
+/*
+ *  Clock recovery test
+ *
+ *  Runs the esp8266 interrupt paths of the library on the simulated Keybus, with the emulated timer1 and GPC()
+ *  interrupt enables of the esp8266 Arduino layer.  Sends 3000 commands of four types with idle gaps of 0-12 ms
+ *  between them, and prints the commands decoded, a checksum of panelData[], the clock and timer interrupts per
+ *  second of simulated time, and the median cost of the clock and data interrupts.  The checksum should match
+ *  between the default sampling and clockRecovery, and across clock periods and edge latencies.
+ *
+ *  Build with -D ESP8266, see README.md.
+ *
+ *  Usage: dscClockRecoveryTest [clock recovery: 0 or 1] [clock half period in us] [edge latency in us]
+ *  Default: 1, 500 us, 0 us
+ */
+
+#include <dscKeybusInterface.h>
+#include "dscLinuxSim.h"
+
+#if !defined(ESP8266)
+#error dscClockRecoveryTest runs the esp8266 interrupt paths, build with -D ESP8266
+#endif
+
+const byte simClockPin = 5;
+const byte simDataPin = 4;
+
+dscKeybusInterface dsc(simClockPin, simDataPin);  // Global as in the sketches
+dscLinuxSim keybus(simClockPin, simDataPin);
+
+const char * commands[] = {"01110001 0 00000110 00000001 00000000", "00111111 0 00000010 00000000 00000000",
+                           "00000101 0 10000001 00000001", "00000101 0 10000001 00000011"};
+
+static unsigned long decoded, decodeChecksum;
+
+
+static void handleCommands() {
+  while (dsc.bufferedCommands()) {
+    if (!dsc.handlePanel()) continue;
+    decoded++;
+    for (byte i = 0; i < dscReadSize; i++) decodeChecksum = decodeChecksum * 31 + dsc.panelData[i];
+  }
+}
+
+
+int main(int argc, char * argv[]) {
+  dsc.clockRecovery = argc > 1 ? atoi(argv[1]) : true;
+  keybus.halfPeriod = argc > 2 ? atoi(argv[2]) : dscSimHalfPeriod;
+  keybus.edgeLatency = argc > 3 ? atoi(argv[3]) : 0;
+  dsc.begin(Serial);
+  keybus.begin();
+
+  unsigned long long startTime = keybus.time;
+  for (unsigned int command = 0; command < 3000; command++) {
+    keybus.command(commands[command % 4]);
+    keybus.wait((command % 5) * 3000);
+    if (command % 4 == 3) handleCommands();
+  }
+  handleCommands();
+
+  double seconds = (keybus.time - startTime) / 1000000.0;
+  unsigned long clockRate = dsc.clockInterrupts / seconds;
+  unsigned long timerRate = dsc.dataInterrupts / seconds;
+  printf("Clock recovery %d, half period %lu us, edge latency %u us\n", (int)dsc.clockRecovery, keybus.halfPeriod, keybus.edgeLatency);
+  printf("Decoded: %lu commands, checksum %08lx\n", decoded, decodeChecksum & 0xFFFFFFFF);
+  printf("Interrupts/s: clock %lu, timer %lu, total %lu\n", clockRate, timerRate, clockRate + timerRate);
+  printf("Interrupt cost, median: clock %lu, data %lu\n", keybus.clockCost(), keybus.dataCost());
+  return 0;
+}
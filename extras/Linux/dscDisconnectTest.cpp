@@ -0,0 +1,73 @@
+/*
+ *  Keybus disconnect test
+ *
+ *  Sends status commands on the simulated Keybus at a fixed interval for 10 seconds with handlePanel() called
+ *  every millisecond, then stops the clock as a cut wire and measures the time until keybusConnected is false.
+ *  Prints the link quality learned by the library before the clock stops and the detection latency, and fails
+ *  if the Keybus was reported disconnected while commands were sent.
+ *
+ *  Usage: dscDisconnectTest [timeout multiple] [command interval in ms]
+ *  Default: 4 (the library default, 0 uses the fixed dscKeybusTimeout), 48
+ */
+
+#include <dscKeybusInterface.h>
+#include "dscLinuxSim.h"
+
+const byte simClockPin = 5;
+const byte simDataPin = 4;
+
+dscKeybusInterface dsc(simClockPin, simDataPin);  // Global as in the sketches
+dscLinuxSim keybus(simClockPin, simDataPin);
+
+const char * commands[] = {"00000101 0 10000001 00000001", "00000101 0 10000001 00000011"};
+const unsigned long sendTime = 10000;  // Milliseconds
+
+static unsigned long disconnects;
+
+
+static void handleCommands() {
+  while (dsc.handlePanel()) {
+    if (dsc.keybusChanged) {
+      dsc.keybusChanged = false;
+      if (!dsc.keybusConnected) disconnects++;
+    }
+  }
+}
+
+
+int main(int argc, char * argv[]) {
+  dsc.keybusTimeoutMultiple = argc > 1 ? atoi(argv[1]) : 4;
+  unsigned long commandInterval = argc > 2 ? atol(argv[2]) : 48;
+  dsc.begin(Serial);
+  keybus.begin();
+
+  // Sends commands at the interval, polling handlePanel() every millisecond between commands
+  unsigned long long startTime = keybus.time;
+  unsigned int command = 0;
+  while (keybus.time - startTime < sendTime * 1000ULL) {
+    unsigned long long commandTime = keybus.time;
+    keybus.command(commands[command++ % 2]);
+    handleCommands();
+    while (keybus.time - commandTime < commandInterval * 1000ULL) {
+      keybus.wait(1000);
+      handleCommands();
+    }
+  }
+  unsigned long sendDisconnects = disconnects;
+  unsigned int framesPerSecond = dsc.framesPerSecond;
+  unsigned long frameInterval = dsc.frameInterval, keybusTimeout = dsc.keybusTimeout;
+
+  // Stops the clock after the last command and waits for the disconnect
+  keybus.command(commands[command % 2]);
+  unsigned long long stopTime = keybus.time;
+  while (disconnects == sendDisconnects && keybus.time - stopTime < 2 * dscKeybusTimeout * 1000ULL) {
+    keybus.wait(1000);
+    handleCommands();
+  }
+  unsigned long latency = (keybus.time - stopTime) / 1000;
+
+  printf("Timeout multiple %u, command interval %lu ms: %u frames/s, frame interval %lu ms, keybusTimeout %lu ms\n",
+         (unsigned int)dsc.keybusTimeoutMultiple, commandInterval, framesPerSecond, frameInterval, keybusTimeout);
+  printf("Disconnect detected after %lu ms, %lu disconnects while sending\n", latency, sendDisconnects);
+  return sendDisconnects || disconnects == sendDisconnects ? 1 : 0;
+}
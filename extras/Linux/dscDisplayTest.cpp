@@ -0,0 +1,93 @@
+/*
+ *  Keypad display test
+ *
+ *  Sends 7-segment display patterns on the simulated Keybus with the timing of keypad readouts and checks the
+ *  display text published by the library: a readout of a repeated character ("11") with a short blank between
+ *  the characters, a flashing character with blanks as long as the character is shown, and a readout of two
+ *  different characters.  Prints each published display with its time.
+ *
+ *  Usage: dscDisplayTest
+ */
+
+#include <dscKeybusInterface.h>
+#include "dscLinuxSim.h"
+
+#include <string>
+
+const byte simClockPin = 5;
+const byte simDataPin = 4;
+
+dscKeybusInterface dsc(simClockPin, simDataPin);  // Global as in the sketches
+dscLinuxSim keybus(simClockPin, simDataPin);
+
+const byte segmentsBlank = 0x00;
+const byte segmentsOne = 0x06;
+const byte segmentsTwo = 0x5B;
+
+static std::string published;
+static unsigned long failures;
+
+
+static void handleCommands() {
+  while (dsc.bufferedCommands()) dsc.handlePanel();
+  dsc.handlePanel();
+  if (!dsc.displayChanged) return;
+  dsc.displayChanged = false;
+
+  printf("%8lu ms: \"%s\"%s\n", millis(), dsc.displayText, dsc.displayBlink ? " blinking" : "");
+  published += std::string("[") + dsc.displayText + (dsc.displayBlink ? "*]" : "]");
+}
+
+
+// Shows the segments for the time in milliseconds, with a command about every 36ms
+static void show(byte segments, unsigned long showTime) {
+  char bits[40];
+  for (byte bit = 0; bit < 8; bit++) bits[bit] = bitRead(segments, 7 - bit) ? '1' : '0';
+  strcpy(bits + 8, " 0 10000001 00000001");
+
+  unsigned long long endTime = keybus.time + showTime * 1000ULL;
+  while (keybus.time < endTime) {
+    keybus.command(bits);
+    handleCommands();
+  }
+}
+
+
+// Checks the displays published since the previous check, "*" marks a blinking display
+static void check(const char * test, const char * expected) {
+  if (published != expected) {
+    printf("FAIL %s: published %s, expected %s\n", test, published.c_str(), expected);
+    failures++;
+  }
+  published.clear();
+}
+
+
+int main() {
+  dsc.begin(Serial);
+  keybus.begin();
+  show(segmentsBlank, 4000);
+  published.clear();
+
+  show(segmentsOne, 600);
+  show(segmentsBlank, 100);
+  show(segmentsOne, 600);
+  show(segmentsBlank, 4000);
+  check("readout 11", "[11][]");
+
+  for (byte flash = 0; flash < 5; flash++) {
+    show(segmentsOne, 500);
+    show(segmentsBlank, 500);
+  }
+  show(segmentsBlank, 4000);
+  check("flashing 1", "[1*][1][]");
+
+  show(segmentsOne, 600);
+  show(segmentsBlank, 100);
+  show(segmentsTwo, 600);
+  show(segmentsBlank, 4000);
+  check("readout 12", "[12][]");
+
+  printf("Display: %lu failures\n", failures);
+  return failures ? 1 : 0;
+}
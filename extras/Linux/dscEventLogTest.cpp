@@ -0,0 +1,188 @@
+/*
+ *  Event log test
+ *
+ *  Appends events to a dscEventLog on a file with dscFileStateStorage, reopens the file as after a restart, and
+ *  checks each stored event and findEvent() for every time in the range against a model of the log.  The sizes
+ *  and event counts cover an empty log, a partly filled log, the ring wrapping at and around the storage size,
+ *  and index steps of 1 to several slots per time index entry.
+ *
+ *  Also checks the default time source across a restart: events after begin() continue from the last stored
+ *  event time after a restart record, and a full dscOutbox spill log keeps its undelivered events.
+ *
+ *  Usage: dscEventLogTest [storage file]
+ *  Default: /tmp/dscEventLog.bin
+ */
+
+#include <dscKeybusInterface.h>
+
+#include <vector>
+
+static const char * path;
+static unsigned long eventTime;
+static unsigned long failures;
+
+static unsigned long testTime() {
+  return eventTime;
+}
+
+
+static bool sendNothing(const char *) {
+  return false;
+}
+
+
+static void fail(const char * test, unsigned int slots, unsigned int events, const char * message, unsigned long value) {
+  printf("FAIL %s: %u slots, %u events: %s %lu\n", test, slots, events, message, value);
+  failures++;
+}
+
+
+// Checks the stored events and findEvent() against the events appended, the log keeps the last slots events
+static void checkLog(const char * test, dscEventLog &log, const std::vector<dscEvent> &appended, unsigned int slots) {
+  unsigned int events = appended.size();
+  unsigned int expectedCount = events < slots ? events : slots;
+  if (log.count() != expectedCount) {
+    fail(test, slots, events, "count", log.count());
+    return;
+  }
+
+  unsigned int first = events - expectedCount;
+  dscEvent event;
+  for (unsigned int position = 0; position < expectedCount; position++) {
+    const dscEvent &expected = appended[first + position];
+    if (!log.readEvent(position, event)) fail(test, slots, events, "readEvent position", position);
+    else if (event.timestamp != expected.timestamp || event.type != expected.type || event.data != expected.data) {
+      fail(test, slots, events, "event at position", position);
+    }
+  }
+  if (log.readEvent(expectedCount, event)) fail(test, slots, events, "readEvent past the newest event", expectedCount);
+
+  // Every time from before the oldest event to after the newest event
+  unsigned long fromTime = expectedCount ? appended[first].timestamp : 0;
+  unsigned long toTime = expectedCount ? appended[events - 1].timestamp : 0;
+  for (unsigned long time = fromTime > 2 ? fromTime - 2 : 0; time <= toTime + 2; time++) {
+    unsigned int expectedPosition = 0;
+    while (expectedPosition < expectedCount && appended[first + expectedPosition].timestamp < time) expectedPosition++;
+    unsigned int position = log.findEvent(time);
+    if (position != expectedPosition) fail(test, slots, events, "findEvent time", time);
+  }
+}
+
+
+// Appends events with a time source, then reopens the log and appends an event, which writes the restart record
+static void testRange(unsigned int slots, unsigned int events) {
+  remove(path);
+  std::vector<dscEvent> appended;
+  eventTime = 1000;
+  {
+    dscFileStateStorage storage(path, slots * dscEventRecordSize);
+    dscEventLog log(storage);
+    if (!log.begin()) {
+      fail("begin", slots, events, "storage", 0);
+      return;
+    }
+    log.setTimeSource(testTime);
+    for (unsigned int i = 0; i < events; i++) {
+      eventTime += random() % 3;  // Events with the same time are kept in order
+      dscEvent event = {eventTime, i % 2 ? dscEventZoneClosed : dscEventZoneOpen, (byte)(i & 0x7F)};
+      if (!log.log(event.type, event.data)) fail("log", slots, events, "event", i);
+      appended.push_back(event);
+    }
+    checkLog("append", log, appended, slots);
+  }
+
+  dscFileStateStorage storage(path, slots * dscEventRecordSize);
+  dscEventLog log(storage);
+  log.begin();
+  checkLog("reopen", log, appended, slots);
+
+  if (events) {
+    dscEvent restart = {appended.back().timestamp, dscEventRestart, 0};
+    appended.push_back(restart);
+  }
+  log.setTimeSource(testTime);
+  eventTime++;
+  dscEvent event = {eventTime, dscEventArmed, 1};
+  log.log(event.type, event.data);
+  appended.push_back(event);
+  checkLog("append after reopen", log, appended, slots);
+}
+
+
+// Without a time source, events after a restart start at the last stored event time instead of being held there
+static void testRestart() {
+  const unsigned int slots = 16;
+  remove(path);
+  {
+    dscFileStateStorage storage(path, slots * dscEventRecordSize);
+    dscEventLog log(storage);
+    dscLinuxSetTime(0);
+    log.begin();
+    dscLinuxSetTime(500 * 1000000ULL);
+    log.log(dscEventZoneOpen, 1);
+    log.log(dscEventZoneClosed, 1);
+  }
+
+  dscFileStateStorage storage(path, slots * dscEventRecordSize);
+  dscEventLog log(storage);
+  dscLinuxSetTime(5 * 1000000ULL);
+  log.begin();
+  dscLinuxSetTime(65 * 1000000ULL);
+  log.log(dscEventZoneOpen, 2);
+  dscLinuxClearTime();
+
+  dscEvent event;
+  if (log.count() != 4) fail("restart", slots, 3, "count", log.count());
+  if (!log.readEvent(2, event) || event.type != dscEventRestart || event.timestamp != 500) fail("restart", slots, 3, "restart record time", event.timestamp);
+  if (!log.readEvent(3, event) || event.timestamp != 560) fail("restart", slots, 3, "event time after restart", event.timestamp);
+}
+
+
+// A full spill log with undelivered events after a restart, then an event spilled after the restart
+static void testSpill() {
+  const unsigned int slots = 4;
+  remove(path);
+  {
+    dscFileStateStorage storage(path, slots * dscEventRecordSize);
+    dscEventLog log(storage);
+    log.begin();
+    for (byte zone = 1; zone <= 4; zone++) log.log(dscEventZoneOpen, zone);
+  }
+
+  dscFileStateStorage storage(path, slots * dscEventRecordSize);
+  dscEventLog log(storage);
+  log.begin();
+  dscOutbox outbox;
+  outbox.setSender(sendNothing);
+  outbox.setSpill(log);
+  if (outbox.queuedEvents() != 4) fail("spill", slots, 4, "queued events", outbox.queuedEvents());
+
+  dscEvent event;
+  outbox.add(dscEventZoneClosed, 1);
+  if (outbox.queuedEvents() != 4 || outbox.droppedEvents != 1) fail("spill", slots, 5, "queued events after a full spill log", outbox.queuedEvents());
+  if (!log.readEvent(0, event) || event.data != 2) fail("spill", slots, 5, "oldest event", event.data);
+  if (!log.readEvent(3, event) || event.type != dscEventZoneClosed) fail("spill", slots, 5, "newest event", event.type);
+}
+
+
+int main(int argc, char * argv[]) {
+  path = argc > 1 ? argv[1] : "/tmp/dscEventLog.bin";
+  srandom(1);
+
+  // Index steps of 1 (up to dscEventIndexSize slots) and several slots, event counts around each wrap
+  const unsigned int slotCounts[] = {1, 2, 8, dscEventIndexSize - 1, dscEventIndexSize, dscEventIndexSize + 1, 37, 100, 257};
+  unsigned int tests = 0;
+  for (unsigned int slots : slotCounts) {
+    const unsigned int eventCounts[] = {0, 1, slots - 1, slots, slots + 1, 2 * slots - 1, 2 * slots + 3, 5 * slots};
+    for (unsigned int events : eventCounts) {
+      testRange(slots, events);
+      tests++;
+    }
+  }
+  testRestart();
+  testSpill();
+  remove(path);
+
+  printf("Event log: %u range tests, %lu failures\n", tests + 2, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+/*
+ *  Clock glitch filter test
+ *
+ *  Sends 20000 commands of three types on the simulated Keybus, optionally with a glitch pulse on the clock
+ *  line after every few clock edges, and checks each decoded command against the command sent.  Prints the
+ *  commands decoded, the decoding errors, a checksum of panelData[], the edges filtered and bits disputed
+ *  by the library, and the median cost of the clock and data interrupts.
+ *
+ *  Usage: dscGlitchTest [clock glitch time in us] [majority vote: 0 or 1] [glitch pulse every n clock edges]
+ *  Default: 100 us (0 disables the filter, the library default), 0, 7 (0 for no glitches)
+ */
+
+#include <dscKeybusInterface.h>
+#include "dscLinuxSim.h"
+
+const byte simClockPin = 5;
+const byte simDataPin = 4;
+
+dscKeybusInterface dsc(simClockPin, simDataPin);  // Global as in the sketches
+dscLinuxSim keybus(simClockPin, simDataPin);
+
+const char * commands[] = {"01110001 0 00000110 00000001 00000000", "00111111 0 00000010 00000000 00000000", "00000101 0 10000001 00000001"};
+
+// Decoded data includes the trailing bit read as the clock is held high for the reset, extra bits would follow
+const byte commandData[][7] = {{0x71, 0, 0x06, 0x01, 0x00, 0x01, 0}, {0x3F, 0, 0x02, 0x00, 0x00, 0x01, 0}, {0x05, 0, 0x81, 0x01, 0x01, 0, 0}};
+
+static unsigned long decoded, errors, decodeChecksum;
+
+
+// Commands are decoded in order, 0x05 is skipped as a repeat after the first
+static void handleCommands() {
+  while (dsc.bufferedCommands()) {
+    if (!dsc.handlePanel()) continue;
+    decoded++;
+    for (byte i = 0; i < dscReadSize; i++) decodeChecksum = decodeChecksum * 31 + dsc.panelData[i];
+
+    byte command = 0;
+    while (command < 3 && dsc.panelData[0] != commandData[command][0]) command++;
+    if (command == 3 || memcmp(dsc.panelData, commandData[command], sizeof(commandData[command]))) errors++;
+  }
+}
+
+
+int main(int argc, char * argv[]) {
+  dsc.clockGlitchTime = argc > 1 ? atoi(argv[1]) : 100;
+  dsc.majorityVote = argc > 2 && atoi(argv[2]);
+  keybus.glitchInterval = argc > 3 ? atoi(argv[3]) : 7;
+  dsc.begin(Serial);
+  keybus.begin();
+
+  for (unsigned int command = 0; command < 20000; command++) {
+    keybus.command(commands[command % 3]);
+    if (command % 4 == 3) handleCommands();
+  }
+  handleCommands();
+
+  printf("Glitch time %u us, majority vote %d, glitch pulse every %u edges: %lu glitch edges\n", (unsigned int)dsc.clockGlitchTime,
+         (int)dsc.majorityVote, keybus.glitchInterval, (unsigned long)keybus.glitchEdges);
+  printf("Decoded: %lu commands, %lu errors, checksum %08lx\n", decoded, errors, decodeChecksum & 0xFFFFFFFF);
+  printf("Filtered: %lu edges, %lu disputed bits\n", (unsigned long)dscKeybusInterface::filteredEdges, (unsigned long)dscKeybusInterface::disputedBits);
+  printf("Interrupt cost, median: clock %lu, data %lu\n", keybus.clockCost(), keybus.dataCost());
+  return errors ? 1 : 0;
+}
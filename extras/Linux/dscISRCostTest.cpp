@@ -0,0 +1,52 @@
+/*
+ *  Data interrupt cost test
+ *
+ *  Sends 20000 commands of three types on the simulated Keybus, decodes them with handlePanel() after each
+ *  command as a sketch loop, and prints the cost of dscDataInterrupt() for the panel bits and for the sample at
+ *  the end of each command at the 50th and 99th percentile, and a checksum of panelData[].  With raw, the
+ *  commands are decoded in rawBitMode - the checksum should match the default mode.
+ *
+ *  The costs are in rdtsc cycles on x86 and nanoseconds elsewhere, and include the Arduino layer of the host, so
+ *  only the ratio between the modes is meaningful.  On the device, dscMeasureISR records the longest call.
+ *
+ *  Usage: dscISRCostTest [raw]
+ */
+
+#include <dscKeybusInterface.h>
+#include "dscLinuxSim.h"
+
+const byte simClockPin = 5;
+const byte simDataPin = 4;
+
+dscKeybusInterface dsc(simClockPin, simDataPin);  // Global as in the sketches
+dscLinuxSim keybus(simClockPin, simDataPin);
+
+const char * commands[] = {"01110001 0 00000110 00000001 00000000", "00111111 0 00000010 00000000 00000000", "00000101 0 10000001 00000001"};
+
+static unsigned long decoded, decodeChecksum;
+
+
+static void handleCommands() {
+  while (dsc.handlePanel()) {
+    decoded++;
+    for (byte i = 0; i < dscReadSize; i++) decodeChecksum = decodeChecksum * 31 + dsc.panelData[i];
+  }
+}
+
+
+int main(int argc, char * argv[]) {
+  dsc.rawBitMode = argc > 1 && strcmp(argv[1], "raw") == 0;
+  dsc.begin(Serial);
+  keybus.begin();
+
+  for (unsigned int command = 0; command < 20000; command++) {
+    keybus.command(commands[command % 3]);
+    handleCommands();
+  }
+
+  printf("%s: %lu commands decoded, checksum %08lx, buffer overflow %d\n", dsc.rawBitMode ? "rawBitMode" : "Default mode", decoded,
+         decodeChecksum & 0xFFFFFFFF, (int)dsc.bufferOverflow);
+  printf("dscDataInterrupt() cost: panel bit p50 %lu / p99 %lu, end of command p50 %lu / p99 %lu\n", keybus.dataCost(), keybus.dataCost(99),
+         keybus.endCost(), keybus.endCost(99));
+  return dsc.bufferOverflow ? 1 : 0;
+}
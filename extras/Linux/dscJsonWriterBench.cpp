@@ -0,0 +1,103 @@
+/*
+ *  JSON writer benchmark
+ *
+ *  Writes a status snapshot with dscJsonWriter to a dscBufferWriter, in full and as a delta from a previous
+ *  snapshot with the partition armed, the exit delay and one zone changed.  Prints each JSON object and the
+ *  bytes, time and bytes per microsecond per write, and counts allocations with operator new while writing.
+ *  Checks that each object is complete and that nothing is written for an unchanged snapshot.
+ *
+ *  The time is measured on the host and only shows the relative cost of full and delta writes.
+ *
+ *  Usage: dscJsonWriterBench [writes]
+ *  Default: 200000
+ */
+
+#include <dscKeybusInterface.h>
+#include <dscKeybusJson.h>
+
+#include <new>
+#include <time.h>
+
+static unsigned long allocations;
+
+void * operator new(size_t size) {
+  allocations++;
+  void * memory = malloc(size ? size : 1);
+  if (!memory) throw std::bad_alloc();
+  return memory;
+}
+
+void operator delete(void * memory) noexcept {
+  free(memory);
+}
+
+void operator delete(void * memory, size_t) noexcept {
+  free(memory);
+}
+
+static unsigned long failures;
+
+
+static double hostTime() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000.0 + now.tv_nsec / 1000.0;
+}
+
+
+static void benchWrite(const char * description, const dscStatus &status, const dscStatus * previous, unsigned long writes) {
+  char buffer[512];
+  size_t length = 0;
+  unsigned long startAllocations = allocations;
+  double startTime = hostTime();
+  for (unsigned long i = 0; i < writes; i++) {
+    dscBufferWriter output(buffer, sizeof(buffer) - 1);
+    dscJsonWriter json(output);
+    length = json.write(status, previous);
+  }
+  double writeTime = (hostTime() - startTime) / writes;
+  unsigned long writeAllocations = allocations - startAllocations;
+
+  printf("%s: %s\n", description, buffer);
+  printf("  %zu bytes, %.2f us, %.0f bytes/us, %lu allocations\n", length, writeTime, length / writeTime, writeAllocations);
+  if (length == 0 || length != strlen(buffer) || buffer[0] != '{' || buffer[length - 1] != '}' || writeAllocations) failures++;
+}
+
+
+int main(int argc, char * argv[]) {
+  unsigned long writes = argc > 1 ? atol(argv[1]) : 200000;
+
+  dscStatus previous;
+  memset(&previous, 0, sizeof(previous));
+  previous.version = 41;
+  previous.keybusConnected = true;
+  previous.ready[0] = true;
+  previous.openZones[0] = 0x01;
+  strncpy(previous.displayText, "1", sizeof(previous.displayText) - 1);
+
+  dscStatus status = previous;
+  status.version = 42;
+  status.ready[0] = false;
+  status.armed[0] = true;
+  status.armedAway[0] = true;
+  status.exitDelay[0] = true;
+  status.openZones[0] = 0x03;
+
+  dscStatus full = status;
+  full.trouble = true;
+  full.batteryTrouble = true;
+  full.alarmZones[0] = 0x80;
+  full.displayBlink = true;
+
+  benchWrite("Full snapshot", full, NULL, writes);
+  benchWrite("Delta (armed, exit delay, one zone)", status, &previous, writes);
+
+  // Nothing is written for an unchanged snapshot
+  char buffer[64];
+  dscBufferWriter output(buffer, sizeof(buffer) - 1);
+  dscJsonWriter json(output);
+  if (json.write(status, &status) != 0 || output.length != 0) failures++;
+
+  printf("JSON writer: %lu failures\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,192 @@
+
+#include "dscKeybusLinux.h"
+#include "dscKeybusInterface.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+/*
+ *  Linux capture
+ *
+ *  Each clock edge event sets the clock pin level and time and calls dscClockInterrupt(), which would start
+ *  the 250us timer on esp8266.  The timer is a pending sample time: the sample is taken before processing the
+ *  first event after the sample time, so the data pin has the level from all data edges up to the sample
+ *  time, and dscDataInterrupt() reads the same level it would read on esp8266.  A clock edge before the
+ *  sample time replaces the pending sample as it would restart the one-shot timer, and edges filtered by the
+ *  clock glitch filter do not change the pending sample.
+ *
+ *  Live captures wait for the pending sample with ppoll() if no later event arrives, for example at the last
+ *  bit before the clock stops.
+ */
+
+static unsigned long long monotonicMicros() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+dscLinuxCapture::dscLinuxCapture(byte setClockLine, byte setDataLine) {
+  clockLine = setClockLine;
+  dataLine = setDataLine;
+  eventFile = -1;
+  replay = false;
+  samplePending = false;
+  sampleTime = 0;
+  lastEventTime = 0;
+  lastSequence = 0;
+  edges = 0;
+  clockEdges = 0;
+  samples = 0;
+  lostEvents = 0;
+}
+
+
+dscLinuxCapture::~dscLinuxCapture() {
+  close();
+}
+
+
+bool dscLinuxCapture::openChip(const char * chipPath) {
+  close();
+  int chipFile = open(chipPath, O_RDONLY | O_CLOEXEC);
+  if (chipFile < 0) return false;
+
+  gpio_v2_line_request request;
+  memset(&request, 0, sizeof(request));
+  request.offsets[0] = clockLine;
+  request.offsets[1] = dataLine;
+  request.num_lines = 2;
+  request.event_buffer_size = 1024;  // Edges queued by the kernel, about 0.5s of Keybus data
+  strcpy(request.consumer, "dscKeybusInterface");
+  request.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+  int result = ioctl(chipFile, GPIO_V2_GET_LINE_IOCTL, &request);
+  ::close(chipFile);
+  if (result < 0) return false;
+
+  eventFile = request.fd;
+  fcntl(eventFile, F_SETFL, fcntl(eventFile, F_GETFL) | O_NONBLOCK);
+  replay = false;
+
+  // Sets the current line levels, later levels are set from the edge events
+  gpio_v2_line_values values;
+  memset(&values, 0, sizeof(values));
+  values.mask = 0x03;
+  if (ioctl(eventFile, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) == 0) {
+    dscLinuxSetPin(clockLine, values.bits & 0x01);
+    dscLinuxSetPin(dataLine, values.bits & 0x02);
+  }
+  return true;
+}
+
+
+// Event files start with the clock and data lines high, the Keybus idle state
+bool dscLinuxCapture::openFile(const char * path) {
+  close();
+  eventFile = open(path, O_RDONLY | O_CLOEXEC);
+  if (eventFile < 0) return false;
+  replay = true;
+  dscLinuxSetPin(clockLine, HIGH);
+  dscLinuxSetPin(dataLine, HIGH);
+  return true;
+}
+
+
+int dscLinuxCapture::poll(int timeout) {
+  if (eventFile < 0) return -1;
+
+  if (!replay) {
+    timespec waitTime;
+    timespec * waitLimit = NULL;
+    long long waitMicros = timeout < 0 ? -1 : (long long)timeout * 1000;
+    if (samplePending) {
+      long long sampleWait = (long long)(sampleTime + dscLinuxSampleSlack) - (long long)monotonicMicros();
+      if (sampleWait < 0) sampleWait = 0;
+      if (waitMicros < 0 || sampleWait < waitMicros) waitMicros = sampleWait;
+    }
+    if (waitMicros >= 0) {
+      waitTime.tv_sec = waitMicros / 1000000;
+      waitTime.tv_nsec = (waitMicros % 1000000) * 1000;
+      waitLimit = &waitTime;
+    }
+    pollfd eventPoll = {eventFile, POLLIN, 0};
+    ppoll(&eventPoll, 1, waitLimit, NULL);
+  }
+
+  gpio_v2_line_event events[dscLinuxEventBatch];
+  ssize_t length = read(eventFile, events, sizeof(events));
+  if (length < 0) {
+    if (errno != EAGAIN && errno != EINTR) return -1;
+    length = 0;
+  }
+  int eventCount = length / sizeof(gpio_v2_line_event);
+  for (int event = 0; event < eventCount; event++) processEvent(events[event]);
+
+  if (replay) {
+    if (length == 0) {
+      if (samplePending) sampleData(sampleTime);
+      return -1;
+    }
+    dscLinuxSetTime(lastEventTime);  // millis() in the sketch loop follows the replayed events
+  }
+
+  else {
+    if (samplePending && monotonicMicros() >= sampleTime + dscLinuxSampleSlack) sampleData(sampleTime);
+    dscLinuxClearTime();
+  }
+
+  return eventCount;
+}
+
+
+void dscLinuxCapture::close() {
+  if (eventFile >= 0) ::close(eventFile);
+  eventFile = -1;
+  samplePending = false;
+  lastSequence = 0;
+  dscLinuxClearTime();
+}
+
+
+void dscLinuxCapture::processEvent(const gpio_v2_line_event &event) {
+  unsigned long long eventTime = event.timestamp_ns / 1000;
+  if (lastSequence && event.seqno > lastSequence + 1) lostEvents += event.seqno - lastSequence - 1;
+  lastSequence = event.seqno;
+  if (samplePending && sampleTime <= eventTime) sampleData(sampleTime);
+
+  edges++;
+  lastEventTime = eventTime;
+  bool level = event.id == GPIO_V2_LINE_EVENT_RISING_EDGE;
+  if (event.offset == dataLine) {
+    dscLinuxSetPin(dataLine, level);
+    return;
+  }
+  if (event.offset != clockLine) return;
+
+  dscLinuxSetPin(clockLine, level);
+  void (*clockInterrupt)() = dscLinuxInterrupt(clockLine);
+  if (!clockInterrupt) return;
+
+  dscLinuxSetTime(eventTime);
+  unsigned long filteredEdges = dscKeybusInterface::filteredEdges;
+  clockInterrupt();
+  clockEdges++;
+
+  // Starts the data sample timer unless the edge was filtered as a glitch
+  if (dscKeybusInterface::filteredEdges == filteredEdges) {
+    samplePending = true;
+    sampleTime = eventTime + dscLinuxSampleDelay;
+  }
+}
+
+
+void dscLinuxCapture::sampleData(unsigned long long time) {
+  samplePending = false;
+  samples++;
+  dscLinuxSetTime(time);
+  dscKeybusInterface::dscDataInterrupt();
+}
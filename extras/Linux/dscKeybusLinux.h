@@ -0,0 +1,46 @@
+
+#ifndef dscKeybusLinux_h
+#define dscKeybusLinux_h
+
+#include <Arduino.h>
+#include <linux/gpio.h>
+
+const unsigned int dscLinuxEventBatch = 256;    // Events read from the kernel or file for each batch
+const unsigned long dscLinuxSampleDelay = 250;  // Time in microseconds from a clock edge to reading the data line, as the esp8266 and AVR timers
+const unsigned long dscLinuxSampleSlack = 2000; // Time in microseconds after a pending sample before it is read without a later event
+
+
+// Captures the Keybus from the timestamped edge events of the Linux GPIO character device (uAPI v2), or from a
+// file of struct gpio_v2_line_event records, and calls the library interrupts as the esp8266 timers would.
+// Events are processed in batches from poll() after the kernel has timestamped them, so the capture has no
+// timing requirements and the sketch loop can run between batches.  Read-only: the virtual keypad is not
+// supported, create dscKeybusInterface without a write pin.
+//
+// The clock and data line offsets are the library pin numbers: dscKeybusInterface dsc(clockLine, dataLine).
+class dscLinuxCapture {
+
+  public:
+    dscLinuxCapture(byte setClockLine, byte setDataLine);
+    ~dscLinuxCapture();
+
+    bool openChip(const char * chipPath);  // Requests edge events for the lines, for example /dev/gpiochip0
+    bool openFile(const char * path);      // Replays an event file, time follows the event timestamps
+    int poll(int timeout);                 // Processes a batch of events, waits up to timeout milliseconds (-1: no limit), returns the number of events, -1 at the end of a file or on error
+    void close();
+
+    unsigned long long edges, clockEdges, samples;  // Events processed, clock edges passed to dscClockInterrupt(), calls to dscDataInterrupt()
+    unsigned long lostEvents;                       // Events dropped by the kernel, from gaps in the sequence numbers
+
+  private:
+    void processEvent(const gpio_v2_line_event &event);
+    void sampleData(unsigned long long sampleTime);
+
+    int eventFile;
+    bool replay;
+    byte clockLine, dataLine;
+    bool samplePending;
+    unsigned long long sampleTime, lastEventTime;
+    unsigned long long lastSequence;
+};
+
+#endif  // dscKeybusLinux_h
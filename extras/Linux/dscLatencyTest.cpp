@@ -0,0 +1,83 @@
+/*
+ *  Latency tracing test
+ *
+ *  Sends 2000 commands on the simulated Keybus about every 40ms, status command 0x05 interleaved with display
+ *  commands and the zones changing every 10 status commands.  The sketch loop runs between the clock levels of
+ *  the simulated Keybus: it calls handlePanel(), then is busy for the sketch time.  A status change is published
+ *  after the publish time, as a network client, and tracePublished() is called.
+ *
+ *  Prints the latency histograms with printLatency() in simulated time: the decode stage runs in no simulated
+ *  time, the queue stage follows the sketch time and the total adds the publish time.  Percentiles are the upper
+ *  bound of the power of two bucket, or the maximum if lower.
+ *
+ *  Requires dscLatencyTrace set to true in src/dscKeybusInterface.h, as a sketch enables it.
+ *
+ *  Usage: dscLatencyTest [sketch time in ms] [publish time in ms]
+ *  Default: 5, 20
+ */
+
+#include <dscKeybusInterface.h>
+#include "dscLinuxSim.h"
+
+const byte simClockPin = 5;
+const byte simDataPin = 4;
+
+dscKeybusInterface dsc(simClockPin, simDataPin);  // Global as in the sketches
+dscLinuxSim keybus(simClockPin, simDataPin);
+
+const char * statusCommands[] = {"00000101 0 10000001 00000001", "00000101 0 10000001 00000011"};
+const char * displayCommand = "01110001 0 00000110 00000001 00000000";
+const unsigned int commandCount = 2000;
+const unsigned long commandInterval = 40;  // Milliseconds
+
+static unsigned long sketchTime, publishTime;
+static unsigned long long sketchBusy, publishDue;
+static bool publishPending;
+static unsigned long published;
+
+
+// Sketch loop called by the simulated Keybus: handles the buffered commands, then is busy for the sketch time
+static void sketchLoop() {
+  if (keybus.time < sketchBusy) return;
+
+  while (dsc.handlePanel()) {
+    if (!dsc.statusChanged) continue;
+    dsc.statusChanged = false;
+    if (!publishPending) {
+      publishPending = true;
+      publishDue = keybus.time + publishTime * 1000;
+    }
+  }
+
+  if (publishPending && keybus.time >= publishDue) {
+    publishPending = false;
+    dsc.tracePublished();
+    published++;
+  }
+  sketchBusy = keybus.time + sketchTime * 1000;
+}
+
+
+int main(int argc, char * argv[]) {
+  if (!dscLatencyTrace) {
+    printf("Set dscLatencyTrace to true in src/dscKeybusInterface.h to build this test.\n");
+    return 1;
+  }
+  sketchTime = argc > 1 ? atol(argv[1]) : 5;
+  publishTime = argc > 2 ? atol(argv[2]) : 20;
+  dsc.begin(Serial);
+  keybus.loopFunction = sketchLoop;
+  keybus.begin();
+
+  for (unsigned int command = 0; command < commandCount; command++) {
+    unsigned long long commandTime = keybus.time;
+    if (command % 2) keybus.command(displayCommand);
+    else keybus.command(statusCommands[(command / 20) % 2]);
+    while (keybus.time - commandTime < commandInterval * 1000) keybus.wait(500);
+  }
+  for (unsigned long idleTime = 0; idleTime < publishTime + sketchTime + 1; idleTime++) keybus.wait(1000);
+
+  printf("Sketch time %lu ms, publish time %lu ms: %lu changes published\n", sketchTime, publishTime, published);
+  dsc.printLatency();
+  return dsc.latencyCount(dscLatencyTotal) ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+/*
+ *  Linux capture benchmark
+ *
+ *  Writes an event file of synthetic Keybus commands with the timing of a Sigma MC-08 panel: a 1ms clock
+ *  period, data changing 20-60us after each clock edge, clock edge jitter, and optional ringing after clock
+ *  edges.  The file is replayed with dscLinuxCapture and each decoded command is checked against the commands
+ *  written.  The event file can also be replayed with KeybusReaderLinux -f <file>.
+ *
+ *  With a sketch time per command, handlePanel() is called only after the sketch time has passed since the last
+ *  command, in replay time, to compare the latency of the buffer priority classes with the buffer overloaded.
+ *
+ *  Usage: dscLinuxBench [commands] [ringing per 1000 clock edges] [sketch time per command in ms] [event file]
+ *  Default: 100000 commands, 20 per 1000 edges, 0 ms, /tmp/dscKeybusEvents.bin
+ */
+
+#include <dscKeybusInterface.h>
+#include "dscKeybusLinux.h"
+
+#include <time.h>
+#include <vector>
+
+const byte benchClockLine = 5;
+const byte benchDataLine = 4;
+
+static std::vector<gpio_v2_line_event> events;
+static unsigned long long eventTime = 1000000;  // Nanoseconds
+static bool dataLevel = true;
+
+dscKeybusInterface dsc(benchClockLine, benchDataLine);  // Global as in the sketches
+dscLinuxCapture capture(benchClockLine, benchDataLine);
+
+
+static void addEvent(unsigned long long time, byte line, bool level) {
+  gpio_v2_line_event event;
+  memset(&event, 0, sizeof(event));
+  event.timestamp_ns = time;
+  event.id = level ? GPIO_V2_LINE_EVENT_RISING_EDGE : GPIO_V2_LINE_EVENT_FALLING_EDGE;
+  event.offset = line;
+  event.seqno = events.size() + 1;
+  events.push_back(event);
+}
+
+
+static unsigned long jitter(unsigned long range) {
+  return random() % (range + 1);
+}
+
+
+// Clock edge with optional ringing - edges within clockGlitchTime are filtered by the library
+static void addClockEdge(bool level, unsigned int ringing) {
+  addEvent(eventTime, benchClockLine, level);
+  if (ringing && (unsigned int)(random() % 1000) < ringing) {
+    addEvent(eventTime + 5000, benchClockLine, !level);
+    addEvent(eventTime + 12000, benchClockLine, level);
+  }
+}
+
+
+static void setData(unsigned long long time, bool level) {
+  if (level == dataLevel) return;
+  addEvent(time, benchDataLine, level);
+  dataLevel = level;
+}
+
+
+// Panel bits are written after the clock rises, the line idles high while the clock is low
+static void addCommand(const byte * panelData, byte panelByteCount, unsigned int ringing) {
+  for (byte panelByte = 0; panelByte < panelByteCount; panelByte++) {
+    byte bitCount = panelByte == 1 ? 1 : 8;
+    for (byte bit = 0; bit < bitCount; bit++) {
+      bool dataBit = panelByte == 1 ? panelData[1] : bitRead(panelData[panelByte], 7 - bit);
+      addClockEdge(true, ringing);
+      setData(eventTime + 20000 + jitter(40000), dataBit);
+      eventTime += 500000 + jitter(20000) - 10000;
+
+      addClockEdge(false, ringing);
+      setData(eventTime + 20000 + jitter(40000), true);
+      eventTime += 500000 + jitter(20000) - 10000;
+    }
+  }
+
+  // The clock is held high between commands, the falling edge ends the command
+  addClockEdge(true, 0);
+  eventTime += 2000000 + jitter(200000);
+  addClockEdge(false, 0);
+  eventTime += 500000;
+}
+
+
+// Latency from the end of each command in the event file to handlePanel() per priority class, in replay time
+struct benchLatency {
+  unsigned long commands, decoded;
+  unsigned long long totalTime, maxTime;
+};
+
+
+int main(int argc, char * argv[]) {
+  unsigned long commandCount = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+  unsigned int ringing = argc > 2 ? atoi(argv[2]) : 20;
+  unsigned long sketchDelay = argc > 3 ? strtoul(argv[3], NULL, 10) * 1000 : 0;
+  const char * path = argc > 4 ? argv[4] : "/tmp/dscKeybusEvents.bin";
+
+  // Sigma MC-08 commands: display segments, stop bit, zones, status.  The zones and status change in 1 of 50
+  // commands, these are the high priority commands.  Consecutive commands differ and skip the commands counted
+  // as repeats or skipped as redundant by the library.
+  srandom(1);
+  std::vector<byte> commands;
+  std::vector<unsigned long long> commandTimes;
+  std::vector<byte> commandPriority;
+  byte panelData[4] = {0, 0, 0, 0};
+  for (unsigned long command = 0; command < commandCount; command++) {
+    byte previous = panelData[0];
+    do panelData[0] = random();
+    while (panelData[0] == previous || panelData[0] == 0x05 || panelData[0] == 0x0A || panelData[0] == 0x1B || panelData[0] == 0xE6);
+    bool statusChange = command == 0 || random() % 50 == 0;
+    if (statusChange) {
+      byte previousStatus[2] = {panelData[2], panelData[3]};
+      do {
+        panelData[2] = random();
+        panelData[3] = random();
+      } while (panelData[2] == previousStatus[0] && panelData[3] == previousStatus[1]);
+    }
+    commands.insert(commands.end(), panelData, panelData + 4);
+    commandPriority.push_back(statusChange ? dscPriorityHigh : dscPriorityLow);
+    addCommand(panelData, 4, ringing);
+    commandTimes.push_back(eventTime / 1000);
+  }
+
+  FILE * eventFile = fopen(path, "wb");
+  if (!eventFile || fwrite(events.data(), sizeof(gpio_v2_line_event), events.size(), eventFile) != events.size()) {
+    fprintf(stderr, "Unable to write %s\n", path);
+    return 1;
+  }
+  fclose(eventFile);
+  printf("Event file: %s, %lu commands, %zu events, %.1f s of Keybus data\n", path, commandCount, events.size(), eventTime / 1e9);
+
+  if (!capture.openFile(path)) return 1;
+  dsc.clockGlitchTime = 100;  // Filters the ringing
+  dsc.begin(Serial);
+
+  // Decoded commands are matched to the next command written with the same data in either priority class, commands
+  // can be skipped if the simulated sketch takes sketchDelay per command and the buffer is full.  Each class is read
+  // in capture order, and with dscPriorityLanes low priority commands can be read after later status changes.
+  timespec startTime, endTime;
+  clock_gettime(CLOCK_MONOTONIC, &startTime);
+  benchLatency latency[dscPriorityClasses];
+  memset(latency, 0, sizeof(latency));
+  for (unsigned long command = 0; command < commandCount; command++) latency[commandPriority[command]].commands++;
+  unsigned long decoded = 0, mismatches = 0;
+  unsigned long nextCommand[dscPriorityClasses] = {0, 0};
+  unsigned long long sketchReady = 0;
+  while (capture.poll(0) >= 0) {
+    while (dsc.bufferedCommands() && micros() >= sketchReady) {
+      if (!dsc.handlePanel()) continue;
+      decoded++;
+      unsigned long command = commandCount;
+      for (byte priority = 0; priority < dscPriorityClasses; priority++) {
+        unsigned long match = nextCommand[priority];
+        while (match < command && (commandPriority[match] != priority || commands[match * 4] != dsc.panelData[0]
+               || commands[match * 4 + 2] != dsc.panelData[2] || commands[match * 4 + 3] != dsc.panelData[3])) match++;
+        command = match;
+      }
+      if (command >= commandCount) {
+        mismatches++;
+        continue;
+      }
+      nextCommand[commandPriority[command]] = command + 1;
+
+      benchLatency &commandLatency = latency[commandPriority[command]];
+      unsigned long long commandTime = micros() > commandTimes[command] ? micros() - commandTimes[command] : 0;
+      commandLatency.decoded++;
+      commandLatency.totalTime += commandTime;
+      if (commandTime > commandLatency.maxTime) commandLatency.maxTime = commandTime;
+      if (sketchDelay) sketchReady = micros() + sketchDelay;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &endTime);
+  double elapsed = (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_nsec - startTime.tv_nsec) / 1e9;
+
+  printf("Decoded: %lu commands, %lu mismatches, %lu buffer overflows\n", decoded, mismatches, (unsigned long)dsc.bufferOverflow);
+  printf("Edges: %llu (%llu clock edges, %lu filtered), %llu samples, %lu lost events\n", capture.edges, capture.clockEdges,
+         (unsigned long)dscKeybusInterface::filteredEdges, capture.samples, capture.lostEvents);
+  printf("Replay: %.3f s, %.2f M edges/s, %.0fx real time\n", elapsed, capture.edges / elapsed / 1e6, eventTime / 1e9 / elapsed);
+  for (byte priority = 0; priority < dscPriorityClasses; priority++) {
+    benchLatency &classLatency = latency[priority];
+    printf("%s priority: %lu/%lu decoded, %lu dropped, latency avg %.1f ms, max %.1f ms\n", priority == dscPriorityHigh ? "High" : "Low",
+           classLatency.decoded, classLatency.commands, (unsigned long)dsc.droppedCommands[priority],
+           classLatency.decoded ? classLatency.totalTime / 1000.0 / classLatency.decoded : 0, classLatency.maxTime / 1000.0);
+  }
+  printf("Superseded: %lu low priority commands\n", dsc.supersededCommands);
+
+  // The last command is stored by the library at the next clock edge after the command ends
+  if (mismatches) return 1;
+  // Without dscPriorityLanes, status changes are dropped with the other commands when the buffer is overloaded
+  if (sketchDelay) return !dscPriorityLanes || latency[dscPriorityHigh].decoded + 1 >= latency[dscPriorityHigh].commands ? 0 : 1;
+  return decoded + 1 >= commandCount ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+#include "dscLinuxSim.h"
+#include "dscKeybusLinux.h"
+#include "dscKeybusInterface.h"
+
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ *  Simulated Keybus
+ *
+ *  Each panel bit is a rising clock edge with the data level set by the panel, then a falling edge with the
+ *  data line released high.  The command ends with the clock held high for dscSimResetTime and a falling edge,
+ *  as the panel resets the clock between commands.  Glitch pulses are a pair of clock edges dscSimGlitchTime
+ *  apart right after a clock edge, as ringing on a long cable.  With writePin set, the data line is pulled low
+ *  after a falling clock edge while the library sets the pin high, as a virtual keypad writing a key.  It is
+ *  also pulled low after the bits in moduleBits, as another keypad writing at the same time.  With loopFunction
+ *  set, the sketch loop is called after each clock level, as the sketch runs between interrupts.
+ *
+ *  The cost of each interrupt call is counted in a histogram, in rdtsc cycles on x86 and in nanoseconds
+ *  elsewhere, with the data sample at the end of each command counted apart from the panel bits.  The figures
+ *  include the Arduino layer on the host and are only comparable between runs.
+ */
+
+dscLinuxSim::dscLinuxSim(byte setClockPin, byte setDataPin) {
+  clockPin = setClockPin;
+  dataPin = setDataPin;
+  halfPeriod = dscSimHalfPeriod;
+  glitchInterval = 0;
+  edgeLatency = 0;
+  writePin = 255;
+  writtenBits = 0;
+  moduleBits = 0;
+  loopFunction = nullptr;
+  commandBits = 0;
+  time = 1000000;
+  clockEdges = 0;
+  glitchEdges = 0;
+  samplePending = false;
+  endPending = false;
+  loopRunning = false;
+  sampleTime = 0;
+  memset(clockCostBins, 0, sizeof(clockCostBins));
+  memset(dataCostBins, 0, sizeof(dataCostBins));
+  memset(endCostBins, 0, sizeof(endCostBins));
+}
+
+
+void dscLinuxSim::begin() {
+  dscLinuxSetPin(clockPin, LOW);
+  dscLinuxSetPin(dataPin, HIGH);
+  dscLinuxSetTime(time);
+}
+
+
+void dscLinuxSim::command(const char * bits) {
+  writtenBits = 0;
+  commandBits = 0;
+  for (const char * bit = bits; *bit; bit++) {
+    if (*bit != '0' && *bit != '1') continue;
+    commandBits++;
+    levelEdge(HIGH, *bit == '1', halfPeriod);
+    levelEdge(LOW, HIGH, halfPeriod);
+  }
+
+  moduleBits = 0;
+
+  levelEdge(HIGH, HIGH, dscSimResetTime);
+  endPending = true;
+  levelEdge(LOW, HIGH, halfPeriod);
+}
+
+
+// Takes the pending data sample if it is due within the wait, or runs the esp8266 timer1 interrupts due
+void dscLinuxSim::wait(unsigned long waitTime) {
+  unsigned long long endTime = time + waitTime;
+
+  #if defined(ESP8266)
+  unsigned long long fireTime;
+  while (dscLinuxTimerTime(fireTime) && fireTime <= endTime) {
+    time = fireTime;
+    dscLinuxSetTime(time);
+    dataInterrupt();
+  }
+  #else
+  if (samplePending && sampleTime <= endTime) {
+    samplePending = false;
+    dscLinuxSetTime(sampleTime);
+    dataInterrupt();
+  }
+  #endif
+
+  time = endTime;
+  dscLinuxSetTime(time);
+
+  // The sketch loop runs in no simulated time, a busy sketch skips the calls until its work is done
+  if (loopFunction && !loopRunning) {
+    loopRunning = true;
+    loopFunction();
+    loopRunning = false;
+  }
+}
+
+
+// The edge latency is taken from the level time so the clock period is unchanged
+void dscLinuxSim::levelEdge(bool level, bool dataLevel, unsigned long levelTime) {
+  unsigned long latency = edgeLatency ? random() % (edgeLatency + 1) : 0;
+  if (latency) wait(latency);
+  clockEdge(level, dataLevel);
+  wait(levelTime - latency);
+}
+
+
+void dscLinuxSim::clockEdge(bool level, bool dataLevel) {
+  dscLinuxSetPin(dataPin, dataLevel);
+  clockInterrupt(level);
+  clockEdges++;
+
+  if (writePin != 255 && level == LOW && digitalRead(writePin) == HIGH) {
+    dscLinuxSetPin(dataPin, LOW);
+    if (commandBits < 64) writtenBits |= 1ULL << commandBits;
+  }
+  if (level == LOW && commandBits < 64 && (moduleBits & (1ULL << commandBits))) dscLinuxSetPin(dataPin, LOW);
+
+  if (glitchInterval && clockEdges % glitchInterval == 0) {
+    unsigned long long edgeTime = time;
+    time = edgeTime + dscSimGlitchTime;
+    clockInterrupt(!level);
+    time = edgeTime + dscSimGlitchTime * 2;
+    clockInterrupt(level);
+    time = edgeTime;
+    dscLinuxSetTime(time);
+    glitchEdges += 2;
+  }
+}
+
+
+// Starts the data sample timer unless the edge was filtered as a glitch, as dscLinuxCapture
+void dscLinuxSim::clockInterrupt(bool level) {
+  dscLinuxSetPin(clockPin, level);
+  dscLinuxSetTime(time);
+  void (*interrupt)() = dscLinuxInterrupt(clockPin);
+  if (!interrupt) return;
+
+  unsigned long filteredEdges = dscKeybusInterface::filteredEdges;
+  unsigned long long startTime = costTime();
+  interrupt();
+  addCost(clockCostBins, startTime);
+  #if !defined(ESP8266)
+  if (dscKeybusInterface::filteredEdges == filteredEdges) {
+    samplePending = true;
+    sampleTime = time + dscLinuxSampleDelay;
+  }
+  #else
+  (void)filteredEdges;
+  #endif
+}
+
+
+// The first sample with the clock low after the reset between commands is the end of the command
+void dscLinuxSim::dataInterrupt() {
+  bool commandEnd = endPending && digitalRead(clockPin) == LOW;
+  if (commandEnd) endPending = false;
+
+  unsigned long long startTime = costTime();
+  #if defined(ESP8266)
+  dscLinuxRunTimer();
+  #else
+  dscKeybusInterface::dscDataInterrupt();
+  #endif
+  addCost(commandEnd ? endCostBins : dataCostBins, startTime);
+}
+
+
+unsigned long dscLinuxSim::clockCost(byte percentile) {
+  return percentileCost(clockCostBins, percentile);
+}
+
+
+unsigned long dscLinuxSim::dataCost(byte percentile) {
+  return percentileCost(dataCostBins, percentile);
+}
+
+
+unsigned long dscLinuxSim::endCost(byte percentile) {
+  return percentileCost(endCostBins, percentile);
+}
+
+
+unsigned long long dscLinuxSim::costTime() {
+  #if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+  #else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000ULL + now.tv_nsec;
+  #endif
+}
+
+
+// Costs past the last bin are counted in the last bin, as a preempted call
+void dscLinuxSim::addCost(unsigned long * costBins, unsigned long long startTime) {
+  unsigned long long cost = costTime() - startTime;
+  costBins[cost < dscSimCostBins ? cost : dscSimCostBins - 1]++;
+}
+
+
+unsigned long dscLinuxSim::percentileCost(const unsigned long * costBins, byte percentile) {
+  unsigned long long calls = 0, counted = 0;
+  for (unsigned int bin = 0; bin < dscSimCostBins; bin++) calls += costBins[bin];
+  for (unsigned int bin = 0; bin < dscSimCostBins; bin++) {
+    counted += costBins[bin];
+    if (counted * 100 >= calls * percentile && calls) return bin;
+  }
+  return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef dscLinuxSim_h
+#define dscLinuxSim_h
+
+#include <Arduino.h>
+
+const unsigned long dscSimHalfPeriod = 500;   // Time in microseconds per clock level, as a Sigma MC-08 panel
+const unsigned long dscSimResetTime = 2000;   // Time in microseconds the clock is held high between commands
+const unsigned long dscSimGlitchTime = 3;     // Time in microseconds between the edges of a clock glitch
+const unsigned int dscSimCostBins = 1024;     // Histogram bins of the interrupt cost, in cycles (x86) or nanoseconds
+
+
+// Simulated Keybus for host tests: sends panel commands as bit strings by calling the library interrupts
+// directly, with the time for millis() and micros() following the simulated clock.  As with dscLinuxCapture,
+// dscDataInterrupt() is called dscLinuxSampleDelay after each clock edge accepted by the glitch filter.  Built
+// with -D ESP8266, the library runs its esp8266 interrupt paths: the clock interrupt is called while enabled in
+// GPC() and dscDataInterrupt() is called by the emulated timer1 set by the library.
+//
+// Create dscKeybusInterface with the same clock and data pins and call begin() after dsc.begin().
+class dscLinuxSim {
+
+  public:
+    dscLinuxSim(byte setClockPin, byte setDataPin);
+
+    void begin();                      // Sets the lines high and starts the simulated time
+    void command(const char * bits);   // Sends '0' and '1' panel bits, spaces are ignored, then the reset between commands
+    void wait(unsigned long waitTime);  // Advances the simulated time in microseconds with the clock low
+    unsigned long long time;           // Simulated time in microseconds
+
+    unsigned long halfPeriod;          // Time in microseconds per clock level (default: dscSimHalfPeriod)
+    unsigned int glitchInterval;       // Adds a glitch pulse on the clock line after every glitchInterval clock edges, 0 disables (default: 0)
+    unsigned int edgeLatency;          // Delays each clock edge by a random 0-edgeLatency microseconds within its level time, as interrupt latency (default: 0)
+    byte writePin;                     // Pulls the data line low while this pin is high after a falling clock edge, as the virtual keypad transistor, 255 disables (default: 255)
+    unsigned long long writtenBits;    // Panel bits of the last command followed by a write, bit n for the clock low after panel bit n
+    unsigned long long moduleBits;     // Panel bits of the next command followed by another keypad or module pulling the data line low, as writtenBits, cleared after the command
+    void (*loopFunction)();            // Called as the sketch loop at the end of each wait, between clock levels and interrupts, nullptr disables (default: nullptr)
+    unsigned long long clockEdges, glitchEdges;
+    unsigned long clockCost(byte percentile = 50);  // Cost per call of dscClockInterrupt() at the percentile, median by default
+    unsigned long dataCost(byte percentile = 50);   // Cost per call of dscDataInterrupt() for the panel bits
+    unsigned long endCost(byte percentile = 50);    // Cost per call of dscDataInterrupt() for the sample at the end of each command
+
+  private:
+    void levelEdge(bool level, bool dataLevel, unsigned long levelTime);
+    void clockEdge(bool level, bool dataLevel);
+    void clockInterrupt(bool level);
+    void dataInterrupt();
+    static unsigned long long costTime();
+    static void addCost(unsigned long * costBins, unsigned long long startTime);
+    static unsigned long percentileCost(const unsigned long * costBins, byte percentile);
+
+    byte clockPin, dataPin;
+    byte commandBits;
+    bool samplePending, endPending, loopRunning;
+    unsigned long long sampleTime;
+    unsigned long clockCostBins[dscSimCostBins], dataCostBins[dscSimCostBins], endCostBins[dscSimCostBins];
+};
+
+#endif  // dscLinuxSim_h
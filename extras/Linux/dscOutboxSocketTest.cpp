@@ -0,0 +1,236 @@
+/*
+ *  Notification outbox socket test
+ *
+ *  Sends dscOutbox messages as HTTP POST requests to a server on a local TCP socket, in real time.  The server
+ *  is down for the first second, then answers each request after 50 ms, and does not answer the first request
+ *  after 2 s so the send times out.  Zone events are added every 100 ms for 3 s, fewer than the memory queue
+ *  holds without a spill log, and the outbox runs about every millisecond.
+ *
+ *  Checks that each event is received by the server once and in order, and prints the messages sent, failed and
+ *  timed out, and the longest run() time.  By default, the outbox uses a step sender with a non-blocking socket
+ *  and a send timeout of 500 ms.  With blocking, it uses a sender that waits for the response in run(), as the
+ *  sketches did.
+ *
+ *  Usage: dscOutboxSocketTest [blocking]
+ */
+
+#include <dscKeybusInterface.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+const unsigned int eventCount = 30;
+const unsigned long eventInterval = 100;  // Milliseconds
+const unsigned long serverUpTime = 1000;
+const unsigned long serverStallTime = 2000;
+const unsigned long responseTime = 50;
+const unsigned long sendTimeout = 500;
+
+static int listenSocket = -1;
+static sockaddr_in serverAddress;
+static std::atomic<bool> serverUp(false), serverStall(false), serverStop(false);
+static std::mutex receivedLock;
+static std::vector<unsigned int> receivedEvents;  // Zone numbers in the order received
+
+
+// Reads an HTTP request, returns false if the client closed the connection
+static bool readRequest(int client, std::string &body) {
+  std::string request;
+  char buffer[256];
+  size_t headerEnd = std::string::npos;
+  size_t contentLength = 0;
+  while (headerEnd == std::string::npos || request.size() < headerEnd + 4 + contentLength) {
+    ssize_t length = recv(client, buffer, sizeof(buffer), 0);
+    if (length <= 0) return false;
+    request.append(buffer, length);
+    if (headerEnd == std::string::npos && (headerEnd = request.find("\r\n\r\n")) != std::string::npos) {
+      size_t lengthHeader = request.find("Content-Length: ");
+      if (lengthHeader < headerEnd) contentLength = strtoul(request.c_str() + lengthHeader + 16, NULL, 10);
+    }
+  }
+  body = request.substr(headerEnd + 4, contentLength);
+  return true;
+}
+
+
+// Accepts one connection at a time, each line of the body is "Zone open: n" or "Zone closed: n"
+static void runServer() {
+  while (!serverUp) usleep(1000);
+  listen(listenSocket, 4);
+
+  while (!serverStop) {
+    pollfd listenPoll = {listenSocket, POLLIN, 0};
+    if (poll(&listenPoll, 1, 10) <= 0) continue;
+    int client = accept(listenSocket, NULL, NULL);
+    if (client < 0) continue;
+
+    std::string body;
+    if (readRequest(client, body)) {
+
+      // Stalls until the client gives up and closes the connection
+      if (serverStall.exchange(false)) {
+        char buffer[64];
+        while (recv(client, buffer, sizeof(buffer), 0) > 0) {}
+        close(client);
+        continue;
+      }
+
+      usleep(responseTime * 1000);
+      {
+        std::lock_guard<std::mutex> lock(receivedLock);
+        for (size_t line = 0; line != std::string::npos; line = body.find('\n', line + 1)) {
+          size_t zone = body.find(':', line);
+          if (zone != std::string::npos) receivedEvents.push_back(atoi(body.c_str() + zone + 1));
+        }
+      }
+      const char * response = "HTTP/1.0 200 OK\r\nContent-Length: 0\r\n\r\n";
+      send(client, response, strlen(response), MSG_NOSIGNAL);
+    }
+    close(client);
+  }
+}
+
+
+static std::string buildRequest(const char * message) {
+  std::string request = "POST /dsc HTTP/1.0\r\nContent-Type: text/plain\r\nContent-Length: ";
+  request += std::to_string(strlen(message)) + "\r\n\r\n" + message;
+  return request;
+}
+
+
+// Returns true for an HTTP 2xx status
+static bool readStatus(int client) {
+  char response[64];
+  ssize_t length = recv(client, response, sizeof(response) - 1, 0);
+  if (length <= 0) return false;
+  response[length] = '\0';
+  const char * status = strchr(response, ' ');
+  return status && status[1] == '2';
+}
+
+
+static int stepSocket = -1;
+static bool requestSent;
+
+
+// Step sender: connects without blocking, then sends the request once the socket is connected and reads the
+// status once the response arrives.  A new message closes the connection of a message that timed out.
+static byte sendStep(const char * message, bool start) {
+  if (start) {
+    if (stepSocket >= 0) close(stepSocket);
+    stepSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    requestSent = false;
+    if (connect(stepSocket, (sockaddr *)&serverAddress, sizeof(serverAddress)) == 0 || errno == EINPROGRESS) return dscSendPending;
+  }
+  else {
+    pollfd stepPoll = {stepSocket, (short)(requestSent ? POLLIN : POLLOUT), 0};
+    if (poll(&stepPoll, 1, 0) == 0) return dscSendPending;
+
+    if (!requestSent) {
+      int error = 0;
+      socklen_t errorSize = sizeof(error);
+      getsockopt(stepSocket, SOL_SOCKET, SO_ERROR, &error, &errorSize);
+      std::string request = buildRequest(message);
+      if (error == 0 && send(stepSocket, request.c_str(), request.size(), MSG_NOSIGNAL) == (ssize_t)request.size()) {
+        requestSent = true;
+        return dscSendPending;
+      }
+    }
+    else if (readStatus(stepSocket)) {
+      close(stepSocket);
+      stepSocket = -1;
+      return dscSendDone;
+    }
+  }
+
+  close(stepSocket);
+  stepSocket = -1;
+  return dscSendFailed;
+}
+
+
+// Blocking sender: waits in run() for the connection and the response, up to the send timeout
+static bool sendBlocking(const char * message) {
+  int client = socket(AF_INET, SOCK_STREAM, 0);
+  timeval timeout = {0, (suseconds_t)sendTimeout * 1000};
+  setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  bool sent = false;
+  if (connect(client, (sockaddr *)&serverAddress, sizeof(serverAddress)) == 0) {
+    std::string request = buildRequest(message);
+    sent = send(client, request.c_str(), request.size(), MSG_NOSIGNAL) == (ssize_t)request.size() && readStatus(client);
+  }
+  close(client);
+  return sent;
+}
+
+
+int main(int argc, char * argv[]) {
+  bool blocking = argc > 1 && strcmp(argv[1], "blocking") == 0;
+
+  // The socket is bound to a free port before the server is up so connections are refused until listen()
+  listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+  serverAddress.sin_family = AF_INET;
+  serverAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  serverAddress.sin_port = 0;
+  socklen_t addressSize = sizeof(serverAddress);
+  if (bind(listenSocket, (sockaddr *)&serverAddress, addressSize) != 0 || getsockname(listenSocket, (sockaddr *)&serverAddress, &addressSize) != 0) {
+    printf("Server socket unavailable: %s\n", strerror(errno));
+    return 1;
+  }
+  std::thread server(runServer);
+
+  dscOutbox outbox;
+  outbox.setCoalesceTime(100, 500);
+  if (blocking) outbox.setSender(sendBlocking);
+  else outbox.setStepSender(sendStep, sendTimeout);
+
+  unsigned long startTime = millis();
+  unsigned long longestRun = 0;
+  unsigned int addedEvents = 0;
+  bool stallSet = false;
+  while (outbox.queuedEvents() || addedEvents < eventCount) {
+    unsigned long runTime = millis() - startTime;
+    if (runTime > 20000) break;
+    if (runTime >= serverUpTime) serverUp = true;
+    if (runTime >= serverStallTime && !stallSet) {
+      serverStall = true;
+      stallSet = true;
+    }
+    if (addedEvents < eventCount && runTime >= addedEvents * eventInterval) {
+      addedEvents++;
+      outbox.add(addedEvents % 2 ? dscEventZoneOpen : dscEventZoneClosed, addedEvents);
+    }
+
+    unsigned long runStart = micros();
+    outbox.run();
+    unsigned long runDuration = micros() - runStart;
+    if (runDuration > longestRun) longestRun = runDuration;
+    usleep(1000);
+  }
+  serverUp = true;
+  serverStop = true;
+  server.join();
+
+  unsigned int errors = 0;
+  for (unsigned int event = 0; event < receivedEvents.size(); event++) {
+    if (receivedEvents[event] != event + 1) errors++;
+  }
+  if (receivedEvents.size() != eventCount || outbox.queuedEvents()) errors++;
+
+  printf("%s sender: %zu/%u events received in %lu messages, %lu failed sends, %lu timed out, %u errors\n",
+         blocking ? "Blocking" : "Step", receivedEvents.size(), eventCount, outbox.sentMessages, outbox.failedSends,
+         outbox.timedOutSends, errors);
+  printf("Longest run(): %.1f ms\n", longestRun / 1000.0);
+  return errors ? 1 : 0;
+}
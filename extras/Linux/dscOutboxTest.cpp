@@ -0,0 +1,122 @@
+/*
+ *  Notification outbox test
+ *
+ *  Adds 100 zone events to a dscOutbox over 10 s of simulated time with the network down, with a spill log
+ *  of 64 events on a file with dscFileStateStorage.  The network is then restored and the events are sent by
+ *  a sender that takes 50 ms per message, in place of a request to a server.  With restart, the outbox and
+ *  spill log are created again before the network is restored, as after a reset, and only the spilled events
+ *  are sent.
+ *
+ *  Checks that each event is sent once and in order, and prints the events queued, spilled, dropped and sent.
+ *
+ *  Usage: dscOutboxTest [restart] [spill file]
+ *  Default: /tmp/dscOutboxSpill.bin
+ */
+
+#include <dscKeybusInterface.h>
+
+#include <vector>
+
+const unsigned int spillSlots = 64;
+const unsigned int eventCount = 100;
+const unsigned long sendTime = 50000;  // Microseconds per message
+
+static unsigned long long simTime = 1000000;
+static bool networkUp;
+static unsigned long messages;
+static std::vector<unsigned int> sentEvents;  // Zone numbers in the order sent
+
+
+static void advanceTime(unsigned long long time) {
+  simTime += time;
+  dscLinuxSetTime(simTime);
+}
+
+
+// Each line of the message is "Zone open: n" or "Zone closed: n"
+static bool sendMessage(const char * message) {
+  if (!networkUp) return false;
+  advanceTime(sendTime);
+  messages++;
+  for (const char * line = message; line; line = strchr(line, '\n')) {
+    if (*line == '\n') line++;
+    const char * zone = strchr(line, ':');
+    if (zone) sentEvents.push_back(atoi(zone + 1));
+  }
+  return true;
+}
+
+
+// Runs the outbox every 10 ms until the time has passed
+static void runOutbox(dscOutbox &outbox, unsigned long long runTime) {
+  unsigned long long endTime = simTime + runTime;
+  while (simTime < endTime) {
+    outbox.run();
+    advanceTime(10000);
+  }
+}
+
+
+static void addEvents(dscOutbox &outbox) {
+  for (unsigned int event = 1; event <= eventCount; event++) {
+    outbox.add(event % 2 ? dscEventZoneOpen : dscEventZoneClosed, event);
+    runOutbox(outbox, 100000);
+  }
+}
+
+
+// Sends until the outbox is empty, the retry delay after the network outage can be up to dscOutboxMaxRetryTime
+static void deliverEvents(dscOutbox &outbox) {
+  networkUp = true;
+  unsigned long long startTime = simTime;
+  while (outbox.queuedEvents() && simTime - startTime < 2ULL * dscOutboxMaxRetryTime * 1000) runOutbox(outbox, 10000);
+}
+
+
+int main(int argc, char * argv[]) {
+  bool restart = argc > 1 && strcmp(argv[1], "restart") == 0;
+  const char * path = argc > 2 ? argv[2] : "/tmp/dscOutboxSpill.bin";
+  remove(path);
+  dscLinuxSetTime(simTime);
+
+  dscFileStateStorage storage(path, spillSlots * dscEventRecordSize);
+  dscEventLog spill(storage);
+  dscOutbox outbox;
+  spill.begin();
+  outbox.setSpill(spill);
+  outbox.setSender(sendMessage);
+  addEvents(outbox);
+  printf("Network down: %u events added, %u queued, %u in the spill log, %lu dropped, %lu failed sends\n", eventCount,
+         outbox.queuedEvents(), spill.count(), outbox.droppedEvents, outbox.failedSends);
+
+  // The memory queue is lost on a restart, the spill log is replayed from the file
+  dscFileStateStorage restartStorage(path, spillSlots * dscEventRecordSize);
+  dscEventLog restartSpill(restartStorage);
+  dscOutbox restartOutbox;
+  if (restart) {
+    restartSpill.begin();
+    restartOutbox.setSpill(restartSpill);
+    restartOutbox.setSender(sendMessage);
+    printf("Restart: %u queued\n", restartOutbox.queuedEvents());
+  }
+
+  // Events are sent in order from the first queued event, except the oldest spilled events that were dropped
+  dscOutbox &sendOutbox = restart ? restartOutbox : outbox;
+  unsigned int queued = sendOutbox.queuedEvents();
+  deliverEvents(sendOutbox);
+
+  unsigned int errors = 0;
+  unsigned int firstSpilled = eventCount - spillSlots + 1;
+  unsigned int expected = restart ? firstSpilled : 1;
+  for (unsigned int event = 0; event < sentEvents.size(); event++) {
+    if (expected == dscOutboxSize + 1 && !restart) expected = firstSpilled;
+    if (sentEvents[event] != expected) errors++;
+    expected++;
+  }
+  if (sentEvents.size() != queued || sendOutbox.queuedEvents()) errors++;
+
+  printf("Network restored: %zu events sent in %lu messages, %.0f events/s while sending, %u errors\n",
+         sentEvents.size(), messages, messages ? sentEvents.size() * 1e6 / (messages * sendTime) : 0, errors);
+  remove(path);
+  return errors ? 1 : 0;
+}
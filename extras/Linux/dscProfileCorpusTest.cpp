@@ -0,0 +1,177 @@
+/*
+ *  Panel profile corpus test
+ *
+ *  Sends a corpus of recorded Sigma MC-08 and DSC PowerSeries frames on the simulated Keybus and checks the
+ *  profile functions on the decoded panel data against the expected results for the profile built: validCRC(),
+ *  decodeFlags() and statusChange().  Also checks keyCode() and the bits written by the virtual keypad for a
+ *  key, which must be the zero bits of the key code in the write window from writeStartBit.
+ *
+ *  Build once with the default profile and once with -D dscPowerSeries, see README.md - both builds use the
+ *  same corpus.
+ *
+ *  Usage: dscProfileCorpusTest
+ */
+
+#include <dscKeybusInterface.h>
+#include "dscLinuxSim.h"
+
+const byte simClockPin = 5;
+const byte simDataPin = 4;
+const byte simWritePin = 6;
+
+dscKeybusInterface dsc(simClockPin, simDataPin, simWritePin);  // Global as in the sketches
+dscLinuxSim keybus(simClockPin, simDataPin);
+
+#if defined(dscPowerSeries)
+const byte profile = 1;
+const char * profileName = "DSC PowerSeries";
+#else
+const byte profile = 0;
+const char * profileName = "Sigma MC-08";
+#endif
+
+// Frames with the expected results for Sigma MC-08 and DSC PowerSeries, in order as statusChange() depends on
+// the previous frames.  Sigma MC-08 has no checksum and decodes the status of every command of 24 bits or more.
+// PowerSeries command 0x05 has no checksum and command 0x27 ends with the sum of its bytes.  Identical consecutive
+// frames are skipped by the library, so frames with unchanged status differ in the other bytes.
+struct corpusFrame {
+  const char * description;
+  const char * bits;
+  bool validCRC[2];
+  byte decodeFlags[2];
+  bool statusChange[2];
+};
+
+const byte sigmaFlags = dscDecodeTrouble | dscDecodePowerTrouble | dscDecodeArmed | dscDecodeZones;
+const byte status05Flags = dscDecodeTrouble | dscDecodeArmed | dscDecodeLights;
+const byte status27Flags = dscDecodeTrouble | dscDecodeArmed | dscDecodeLights | dscDecodeZones;
+
+const corpusFrame corpus[] = {
+  {"Sigma status",            "00000101 0 10000001 00000001",                                           {true, true},   {sigmaFlags, status05Flags}, {true, true}},
+  {"Sigma status unchanged",  "00000101 0 10000001 00000001 10010001",                                  {true, true},   {sigmaFlags, status05Flags}, {false, false}},
+  {"Sigma status changed",    "00000101 0 10000001 00000011",                                           {true, true},   {sigmaFlags, status05Flags}, {true, true}},
+  {"Sigma display F",         "01110001 0 00000110 00000001 00000000",                                  {true, false},  {sigmaFlags, 0},             {true, false}},
+  {"Sigma display 0",         "00111111 0 00000010 00000000 00000000",                                  {true, false},  {sigmaFlags, 0},             {true, false}},
+  {"Incomplete display",      "01110001 0 000001",                                                      {false, false}, {0, 0},                      {false, false}},
+  {"PowerSeries 0x05",        "00000101 0 10000001 00000001 10010001 11000111",                         {true, true},   {sigmaFlags, status05Flags}, {true, true}},
+  {"PowerSeries 0x27",        "00100111 0 10000001 00000001 10010001 11000111 00000010 00000011",       {true, true},   {sigmaFlags, status27Flags}, {false, true}},
+  {"PowerSeries 0x27 same",   "00100111 0 10000001 00000001 10010011 11000111 00000010 00000101",       {true, true},   {sigmaFlags, status27Flags}, {false, false}},
+  {"PowerSeries 0x27 bad sum","00100111 0 10000001 00000001 10010001 11000111 00000100 00000100",       {true, false},  {sigmaFlags, 0},             {false, false}},
+  {"PowerSeries 0x27 zones",  "00100111 0 10000001 00000001 10010001 11000111 00000100 00000101",       {true, true},   {sigmaFlags, status27Flags}, {false, true}},
+};
+const byte corpusSize = sizeof(corpus) / sizeof(corpus[0]);
+
+// Key codes, 0 if the key is not available
+struct corpusKey {
+  char key;
+  byte code[2];
+};
+
+const corpusKey keys[] = {{'1', {0xDD, 0x05}}, {'0', {0xCF, 0x00}}, {'#', {0xEF, 0x2D}}, {'*', {0, 0x28}}, {'R', {0xAF, 0}}, {'F', {0, 0xBB}}, {'x', {0, 0}}};
+
+static unsigned long failures;
+static byte handledBitCount;
+
+
+// Sketch command handler for the corpus commands, the number of bits read is passed to handlers
+static void handleCommand(const byte *, byte panelBitCount) {
+  handledBitCount = panelBitCount;
+}
+
+
+static void fail(const char * test, const char * message, unsigned long value) {
+  printf("FAIL %s: %s %lu\n", test, message, value);
+  failures++;
+}
+
+
+static void checkFrames() {
+  byte previousStatus[dscPanelProfile::priorityStatusSize];
+  memset(previousStatus, 0, sizeof(previousStatus));
+
+  for (byte frame = 0; frame < corpusSize; frame++) {
+    const corpusFrame &expected = corpus[frame];
+    keybus.command(expected.bits);
+
+    handledBitCount = 0;
+    while (dsc.bufferedCommands()) dsc.handlePanel();
+    if (!handledBitCount) {
+      fail(expected.description, "not decoded", frame);
+      continue;
+    }
+
+    bool validCRC = dscPanelProfile::validCRC(dsc.panelData, handledBitCount);
+    byte decodeFlags = dscPanelProfile::decodeFlags(dsc.panelData, handledBitCount);
+    bool statusChange = dscPanelProfile::statusChange(dsc.panelData, handledBitCount, previousStatus);
+    printf("%-24s %2u bits: validCRC %d, decodeFlags 0x%02X, statusChange %d\n", expected.description, handledBitCount, validCRC, decodeFlags, statusChange);
+
+    if (validCRC != expected.validCRC[profile]) fail(expected.description, "validCRC", validCRC);
+    if (decodeFlags != expected.decodeFlags[profile]) fail(expected.description, "decodeFlags", decodeFlags);
+    if (statusChange != expected.statusChange[profile]) fail(expected.description, "statusChange", statusChange);
+  }
+}
+
+
+static void checkKeys() {
+  for (const corpusKey &expected : keys) {
+    byte code = 0;
+    bool available = dscPanelProfile::keyCode(expected.key, code);
+    if (available != (expected.code[profile] != 0 || expected.key == '0') || (available && code != expected.code[profile])) {
+      fail("keyCode", "key", expected.key);
+    }
+  }
+}
+
+
+// Writes a key and checks that the data line is pulled low for the zero bits of the key code from writeStartBit,
+// PowerSeries keys are only written in command 0x05
+static void checkWrite() {
+  const char * writeFrame = corpus[0].bits;
+  byte code;
+  dscPanelProfile::keyCode('1', code);
+  unsigned long long expectedBits = 0;
+  for (byte bit = 0; bit < 8; bit++) {
+    if (!bitRead(code, 7 - bit)) expectedBits |= 1ULL << (dscPanelProfile::writeStartBit + bit);
+  }
+
+  while (!dsc.writeReady) {
+    keybus.command(writeFrame);
+    while (dsc.bufferedCommands()) dsc.handlePanel();
+  }
+  dsc.write('1');
+
+  keybus.command(corpus[7].bits);
+  unsigned long long otherBits = keybus.writtenBits;
+  while (dsc.bufferedCommands()) dsc.handlePanel();
+  keybus.command(writeFrame);
+  unsigned long long writtenBits = keybus.writtenBits;
+  while (dsc.bufferedCommands()) dsc.handlePanel();
+
+  printf("Key '1' 0x%02X, write window bits %u-%u: written in 0x27 0x%llX, in 0x05 0x%llX\n", code, dscPanelProfile::writeStartBit,
+         dscPanelProfile::writeEndBit, otherBits, writtenBits);
+  if (profile == 1 && otherBits != 0) fail("write", "bits written in 0x27", (unsigned long)otherBits);
+  unsigned long long firstBits = profile == 1 ? writtenBits : otherBits;
+  if (firstBits != expectedBits) fail("write", "bits written", (unsigned long)firstBits);
+}
+
+
+int main() {
+  const byte commands[] = {0x05, 0x27, 0x3F, 0x71};
+  for (byte command : commands) dsc.setCommandHandler(command, handleCommand);
+  dsc.begin(Serial);
+  keybus.writePin = simWritePin;
+  keybus.begin();
+
+  // The first command is used to find the start of the Keybus data, and differs from the first corpus frame as
+  // identical status commands are counted as repeats
+  keybus.command("00000101 0 10000001 00000111");
+  while (dsc.bufferedCommands()) dsc.handlePanel();
+
+  printf("Profile: %s\n", profileName);
+  checkFrames();
+  checkKeys();
+  checkWrite();
+
+  printf("Corpus: %u frames, %lu failures\n", corpusSize, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,61 @@
+/*
+ *  Repeated command test
+ *
+ *  Sends 900 commands on the simulated Keybus: status command 0x05 in every other command, with the status
+ *  changing for commands 300-309, interleaved with Sigma MC-08 display commands.  Prints each run of repeated
+ *  commands reported by handlePanel(), the commands decoded and the panel buffer peak.
+ *
+ *  Usage: dscRepeatTest [raw]
+ *  With raw, the commands are decoded in rawBitMode, the runs should match the default mode with the times of
+ *  the first and last repeat at decoding instead of capture.
+ */
+
+#include <dscKeybusInterface.h>
+#include "dscLinuxSim.h"
+
+const byte simClockPin = 5;
+const byte simDataPin = 4;
+
+dscKeybusInterface dsc(simClockPin, simDataPin);  // Global as in the sketches
+dscLinuxSim keybus(simClockPin, simDataPin);
+
+const char * statusCommand = "00000101 0 10000001 00000001";
+const char * statusChangedCommand = "00000101 0 10000001 00000011";
+const char * displayCommands[] = {"01110001 0 00000110 00000001 00000000", "00111111 0 00000010 00000000 00000000"};
+
+
+// In rawBitMode, handlePanel() decodes the samples before the commands are buffered
+static unsigned int handleCommands() {
+  unsigned int decoded = 0;
+  while (true) {
+    bool handled = dsc.handlePanel();
+    if (handled) decoded++;
+    if (dsc.repeatChanged) {
+      dsc.repeatChanged = false;
+      Serial.print(millis());
+      Serial.print(" ");
+      dsc.printPanelRepeat();
+      Serial.println();
+    }
+    if (!handled && !dsc.bufferedCommands()) break;
+  }
+  return decoded;
+}
+
+
+int main(int argc, char * argv[]) {
+  dsc.rawBitMode = argc > 1 && strcmp(argv[1], "raw") == 0;
+  dsc.begin(Serial);
+  keybus.begin();
+
+  unsigned int decoded = 0;
+  for (unsigned int command = 0; command < 900; command++) {
+    if (command % 2) keybus.command(displayCommands[(command / 2) % 2]);
+    else keybus.command(command >= 300 && command < 310 ? statusChangedCommand : statusCommand);
+    keybus.wait(20000);
+    if (command % 8 == 7) decoded += handleCommands();
+  }
+  decoded += handleCommands();
+  printf("%u commands decoded, buffer peak %u bytes, overflow %d\n", decoded, dsc.bufferPeak, (int)dsc.bufferOverflow);
+  return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ *  Scheduler test
+ *
+ *  Runs a dscScheduler with a slow task that blocks for 1.6 s in four 400 ms steps, as a network request
+ *  would, and a fast task, while the simulated Keybus sends a command about every 38 ms.  The Keybus
+ *  interrupts keep buffering commands while a task blocks.  With service, the slow task calls
+ *  serviceKeybus() between its steps.  Prints the task statistics, including the panel buffer peak while
+ *  each task ran.
+ *
+ *  Usage: dscSchedulerTest [service]
+ */
+
+#include <dscKeybusInterface.h>
+#include "dscLinuxSim.h"
+
+const byte simClockPin = 5;
+const byte simDataPin = 4;
+
+dscKeybusInterface dsc(simClockPin, simDataPin);  // Global as in the sketches
+dscScheduler scheduler(dsc);
+dscLinuxSim keybus(simClockPin, simDataPin);
+
+const char * commands[] = {"01110001 0 00000000 00000001", "01110001 0 00000110 00000001"};  // Zones change in each command
+
+static bool serviceSteps;
+static unsigned long commandCount, statusChanges;
+
+
+// The Keybus sends commands while the sketch is blocked
+static void blockFor(unsigned long blockTime, bool service) {
+  unsigned long endTime = millis() + blockTime;
+  while (millis() < endTime) {
+    keybus.command(commands[commandCount++ % 2]);
+    keybus.wait(10000);
+    if (service) scheduler.serviceKeybus();
+  }
+}
+
+
+static void keybusTask() {
+  if (dsc.statusChanged) {
+    dsc.statusChanged = false;
+    statusChanges++;
+  }
+}
+
+
+static void slowTask() {
+  for (byte step = 0; step < 4; step++) blockFor(400, serviceSteps);
+}
+
+
+static void fastTask() {
+  blockFor(5, false);
+}
+
+
+int main(int argc, char * argv[]) {
+  serviceSteps = argc > 1 && strcmp(argv[1], "service") == 0;
+  dsc.begin(Serial);
+  keybus.begin();
+  scheduler.setKeybusTask(keybusTask);
+  scheduler.addTask(slowTask, 5000, 2000);
+  scheduler.addTask(fastTask, 100, 10);
+
+  for (unsigned int loop = 0; loop < 400; loop++) {
+    blockFor(20, false);
+    scheduler.run();
+  }
+
+  printf("%lu commands, %lu status changes, overflow %d\n", commandCount, statusChanges, (int)dsc.bufferOverflow);
+  scheduler.printStats(Serial);
+  return 0;
+}
@@ -0,0 +1,212 @@
+/*
+ *  State storage test
+ *
+ *  Writes saved state slots to a dscStateStorage and checks the status restored by begin(): the slot with the
+ *  highest sequence number is chosen, slots with a bad marker or CRC are skipped, and sequence numbers are
+ *  compared across the 32-bit wraparound.  Status changes are then sent on the simulated Keybus to check that
+ *  saves go to the slot after the restored slot with the next sequence number, and are limited to once per
+ *  save interval.
+ *
+ *  Built for the host, the storage is a file with dscFileStateStorage.  Built with -D ESP8266, the storage is
+ *  dscEEPROMStateStorage on the EEPROM emulation and the test also checks that the flash sector is committed at
+ *  most once per dscEEPROMSaveInterval.
+ *
+ *  Usage: dscStateStorageTest [storage file]
+ *  Default: /tmp/dscStateStorage.bin
+ */
+
+#include <dscKeybusInterface.h>
+#include "dscLinuxSim.h"
+
+#if defined(ESP8266)
+#include <EEPROM.h>
+#endif
+
+const byte simClockPin = 5;
+const byte simDataPin = 4;
+const unsigned int slotSize = dscStateSize + 6;  // Marker, sequence, state, CRC
+const unsigned int slotCount = 4;
+const byte erasedZones = 0xFF;
+
+dscLinuxSim keybus(simClockPin, simDataPin);
+static unsigned long failures;
+
+
+static void fail(const char * test, const char * message, unsigned long value) {
+  printf("FAIL %s: %s %lu\n", test, message, value);
+  failures++;
+}
+
+
+// CRC-8 with polynomial 0x07 as the library
+static byte slotCRC(const byte * data, byte length) {
+  byte crc = 0;
+  for (byte i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (byte bit = 0; bit < 8; bit++) crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+  }
+  return crc;
+}
+
+
+static void eraseStorage(dscStateStorage &storage) {
+  byte erased[slotSize];
+  memset(erased, 0xFF, sizeof(erased));
+  storage.begin();
+  for (unsigned int slot = 0; slot < slotCount; slot++) storage.write(slot * slotSize, erased, slotSize);
+}
+
+
+// Writes a slot with openZones[0] set to zones to identify the slot restored
+static void writeSlot(dscStateStorage &storage, unsigned int slot, unsigned long sequence, byte zones, byte marker = 0xD5, bool validCRC = true) {
+  byte slotData[slotSize];
+  memset(slotData, 0, sizeof(slotData));
+  slotData[0] = marker;
+  for (byte i = 0; i < 4; i++) slotData[1 + i] = sequence >> (i * 8);
+  slotData[5 + 1 + dscPartitions] = zones;
+  slotData[slotSize - 1] = slotCRC(slotData, slotSize - 1) ^ (validCRC ? 0 : 0x5A);
+  storage.write(slot * slotSize, slotData, slotSize);
+}
+
+
+// Returns the zones of a valid slot, or erasedZones
+static byte readSlot(dscStateStorage &storage, unsigned int slot, unsigned long &sequence) {
+  byte slotData[slotSize];
+  if (!storage.read(slot * slotSize, slotData, slotSize) || slotData[0] != 0xD5) return erasedZones;
+  if (slotCRC(slotData, slotSize - 1) != slotData[slotSize - 1]) return erasedZones;
+  sequence = (unsigned long)slotData[1] | ((unsigned long)slotData[2] << 8) | ((unsigned long)slotData[3] << 16) | ((unsigned long)slotData[4] << 24);
+  return slotData[5 + 1 + dscPartitions];
+}
+
+
+// Sends status commands with open zones 1-7 set by zones, disarmed and without trouble
+static void sendZones(dscKeybusInterface &dsc, byte zones) {
+  char bits[40];
+  byte zoneByte = (zones << 1) | 1;
+  strcpy(bits, "00000101 0 ");
+  for (byte bit = 0; bit < 8; bit++) bits[11 + bit] = bitRead(zoneByte, 7 - bit) ? '1' : '0';
+  strcpy(bits + 19, " 00000001");
+  for (byte command = 0; command < 2; command++) {
+    keybus.command(bits);
+    while (dsc.bufferedCommands()) dsc.handlePanel();
+  }
+  dsc.handlePanel();
+}
+
+
+// Restarts the interface on the storage and checks the zones restored, 0 if no status is restored
+static void checkRestore(const char * test, dscStateStorage &storage, byte expectedZones) {
+  dscKeybusInterface dsc(simClockPin, simDataPin);
+  dsc.setStateStorage(storage, 0);
+  dsc.begin(Serial);
+  if (dsc.stateRestored != (expectedZones != 0)) fail(test, "stateRestored", dsc.stateRestored);
+  if (dsc.stateRestored && dsc.openZones[0] != expectedZones) fail(test, "restored zones", dsc.openZones[0]);
+  dsc.stop();
+}
+
+
+// Restarts the interface on the storage, sends a status change and checks the slot saved
+static void checkSave(const char * test, dscStateStorage &storage, unsigned int expectedSlot, unsigned long expectedSequence) {
+  dscKeybusInterface dsc(simClockPin, simDataPin);
+  dsc.setStateStorage(storage, 0);
+  dsc.begin(Serial);
+  byte zones = dsc.openZones[0] ^ 0x15;
+  sendZones(dsc, zones);
+  dsc.stop();
+
+  unsigned long sequence = 0;
+  if (readSlot(storage, expectedSlot, sequence) != zones) fail(test, "zones saved in slot", expectedSlot);
+  else if (sequence != expectedSequence) fail(test, "sequence saved", sequence);
+  checkRestore(test, storage, zones);
+}
+
+
+static void testSlots(dscStateStorage &storage) {
+  eraseStorage(storage);
+  checkRestore("erased storage", storage, 0);
+  checkSave("first save", storage, 0, 1);
+
+  eraseStorage(storage);
+  writeSlot(storage, 0, 5, 0x01);
+  writeSlot(storage, 1, 7, 0x02);
+  writeSlot(storage, 2, 6, 0x04);
+  checkRestore("highest sequence", storage, 0x02);
+  checkSave("save after the restored slot", storage, 2, 8);
+
+  eraseStorage(storage);
+  writeSlot(storage, 0, 5, 0x01);
+  writeSlot(storage, 1, 7, 0x02, 0xD5, false);
+  writeSlot(storage, 2, 6, 0x04);
+  checkRestore("bad CRC", storage, 0x04);
+  writeSlot(storage, 2, 6, 0x04, 0x55);
+  checkRestore("bad marker", storage, 0x01);
+  writeSlot(storage, 0, 5, 0x01, 0xD5, false);
+  checkRestore("no valid slot", storage, 0);
+
+  eraseStorage(storage);
+  writeSlot(storage, 0, 0xFFFFFFFE, 0x01);
+  writeSlot(storage, 1, 0xFFFFFFFF, 0x02);
+  writeSlot(storage, 2, 0, 0x04);
+  writeSlot(storage, 3, 1, 0x08);
+  checkRestore("sequence wraparound", storage, 0x08);
+  checkSave("save after the last slot", storage, 0, 2);
+
+  eraseStorage(storage);
+  writeSlot(storage, 0, 0xFFFFFFFE, 0x01);
+  writeSlot(storage, 1, 0xFFFFFFFF, 0x02);
+  checkRestore("sequence before wraparound", storage, 0x02);
+  checkSave("save across wraparound", storage, 2, 0);
+}
+
+
+// Sends a status change every minute for 3 hours, the first change is saved immediately
+static void testInterval(dscStateStorage &storage, unsigned long saveInterval) {
+  eraseStorage(storage);
+  #if defined(ESP8266)
+  EEPROM.commits = 0;
+  #endif
+
+  dscKeybusInterface dsc(simClockPin, simDataPin);
+  dsc.setStateStorage(storage, saveInterval);
+  dsc.begin(Serial);
+  const unsigned int changes = 180;
+  for (unsigned int change = 1; change <= changes; change++) {
+    sendZones(dsc, change & 0x7F);
+    keybus.wait(60000000UL);
+  }
+  dsc.stop();
+
+  unsigned long sequence = 0, lastSequence = 0;
+  for (unsigned int slot = 0; slot < slotCount; slot++) {
+    if (readSlot(storage, slot, sequence) != erasedZones && sequence > lastSequence) lastSequence = sequence;
+  }
+
+  unsigned long effectiveInterval = saveInterval < storage.minimumSaveInterval() ? storage.minimumSaveInterval() : saveInterval;
+  unsigned long maximumSaves = effectiveInterval ? 1 + changes * 60000 / effectiveInterval : changes;
+  printf("Save interval %lu ms (storage minimum %lu ms): %lu saves for %u changes", saveInterval, storage.minimumSaveInterval(), lastSequence, changes);
+  #if defined(ESP8266)
+  printf(", %lu EEPROM commits", EEPROM.commits);
+  if (EEPROM.commits != lastSequence) fail("save interval", "EEPROM commits", EEPROM.commits);
+  #endif
+  printf("\n");
+  if (lastSequence == 0 || lastSequence > maximumSaves) fail("save interval", "saves", lastSequence);
+}
+
+
+int main(int argc, char * argv[]) {
+  #if defined(ESP8266)
+  (void)argv;
+  dscEEPROMStateStorage storage(0, slotCount * slotSize);
+  #else
+  dscFileStateStorage storage(argc > 1 ? argv[1] : "/tmp/dscStateStorage.bin", slotCount * slotSize);
+  #endif
+  (void)argc;
+
+  keybus.begin();
+  testSlots(storage);
+  testInterval(storage, 0);
+  testInterval(storage, 600000);
+
+  printf("State storage: %lu failures\n", failures);
+  return failures ? 1 : 0;
+}
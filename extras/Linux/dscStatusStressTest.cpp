@@ -0,0 +1,118 @@
+/*
+ *  Status snapshot stress test
+ *
+ *  The main thread sets the status fields to a pattern that is consistent across the fields and publishes each
+ *  pattern with handlePanel(), while reader threads copy the status with getStatus() and check that each copy
+ *  is consistent and the versions only increase.  A further thread reads the public status fields directly for
+ *  comparison, these reads can be torn by a publish between the fields.
+ *
+ *  Usage: dscStatusStressTest [publishes] [reader threads]
+ *  Default: 1000000 publishes, 3 reader threads
+ */
+
+#include <dscKeybusInterface.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+dscKeybusInterface dsc(5, 4);  // Global as in the sketches
+
+static std::atomic<bool> done(false);
+static std::atomic<unsigned long> reads(0), tornReads(0), unchangedReads(0), directReads(0), tornDirectReads(0);
+
+
+// Each field is derived from the pattern number
+static void setPattern(unsigned long pattern) {
+  byte value = pattern;
+  dsc.trouble = value & 0x01;
+  dsc.powerTrouble = value & 0x02;
+  for (byte partitionIndex = 0; partitionIndex < dscPartitions; partitionIndex++) {
+    dsc.armed[partitionIndex] = value & 0x04;
+    dsc.ready[partitionIndex] = !(value & 0x04);
+  }
+  for (byte zoneGroup = 0; zoneGroup < dscZones; zoneGroup++) {
+    dsc.openZones[zoneGroup] = value + zoneGroup;
+    dsc.alarmZones[zoneGroup] = ~value;
+  }
+  dsc.statusChanged = true;
+}
+
+
+static bool consistent(const dscStatus &status) {
+  byte value = status.openZones[0];
+  if (status.trouble != (bool)(value & 0x01) || status.powerTrouble != (bool)(value & 0x02)) return false;
+  for (byte partitionIndex = 0; partitionIndex < dscPartitions; partitionIndex++) {
+    if (status.armed[partitionIndex] != (bool)(value & 0x04) || status.ready[partitionIndex] == status.armed[partitionIndex]) return false;
+  }
+  for (byte zoneGroup = 0; zoneGroup < dscZones; zoneGroup++) {
+    if (status.openZones[zoneGroup] != (byte)(value + zoneGroup) || status.alarmZones[zoneGroup] != (byte)~value) return false;
+  }
+  return true;
+}
+
+
+static void readSnapshots() {
+  dscStatus status;
+  unsigned long knownVersion = 0xFFFFFFFF, previousVersion = 0;
+  while (!done) {
+    if (!dsc.getStatus(status, knownVersion)) {
+      unchangedReads++;
+      std::this_thread::yield();
+      continue;
+    }
+    reads++;
+    knownVersion = status.version;
+    if (status.version == 0) continue;  // Not yet published
+    if (!consistent(status) || status.version < previousVersion) tornReads++;
+    previousVersion = status.version;
+  }
+}
+
+
+static void readFields() {
+  dscStatus status;
+  while (!done) {
+    status.trouble = dsc.trouble;
+    status.powerTrouble = dsc.powerTrouble;
+    for (byte partitionIndex = 0; partitionIndex < dscPartitions; partitionIndex++) {
+      status.armed[partitionIndex] = dsc.armed[partitionIndex];
+      status.ready[partitionIndex] = dsc.ready[partitionIndex];
+    }
+    for (byte zoneGroup = 0; zoneGroup < dscZones; zoneGroup++) {
+      status.openZones[zoneGroup] = dsc.openZones[zoneGroup];
+      status.alarmZones[zoneGroup] = dsc.alarmZones[zoneGroup];
+    }
+    directReads++;
+    if (!consistent(status)) tornDirectReads++;
+  }
+}
+
+
+int main(int argc, char * argv[]) {
+  unsigned long publishCount = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  unsigned int readerCount = argc > 2 ? atoi(argv[2]) : 3;
+
+  // The Keybus is not connected, handlePanel() only publishes the status
+  dsc.begin(Serial);
+  setPattern(0);
+  dsc.handlePanel();
+
+  std::vector<std::thread> readers;
+  for (unsigned int reader = 0; reader < readerCount; reader++) readers.push_back(std::thread(readSnapshots));
+  std::thread fieldReader(readFields);
+
+  for (unsigned long pattern = 1; pattern <= publishCount; pattern++) {
+    setPattern(pattern);
+    dsc.handlePanel();
+    if ((pattern & 63) == 0) std::this_thread::yield();
+  }
+  done = true;
+  for (unsigned int reader = 0; reader < readerCount; reader++) readers[reader].join();
+  fieldReader.join();
+
+  printf("Published: %lu, version %lu\n", publishCount, dsc.statusVersion());
+  printf("getStatus(): %lu reads, %lu torn, %lu unchanged\n", (unsigned long)reads, (unsigned long)tornReads, (unsigned long)unchangedReads);
+  printf("Status fields: %lu reads, %lu torn\n", (unsigned long)directReads, (unsigned long)tornDirectReads);
+  return tornReads ? 1 : 0;
+}
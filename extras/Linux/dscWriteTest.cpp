@@ -0,0 +1,93 @@
+/*
+ *  Virtual keypad write test
+ *
+ *  Writes "1234#" with write() on the simulated Keybus, with status and display commands at a fixed interval
+ *  and the sketch loop calling handlePanel() between the clock levels.  Checks the bits written for each key in
+ *  the write window from writeStartBit against the key code, and prints writeLatency for each key, from write()
+ *  to the key read back from the Keybus, and the time until the library is ready after the last key.
+ *
+ *  Optionally, another keypad writes at the same time as the virtual keypad on one command: the key is read back
+ *  with a mismatch and written again on the next command.
+ *
+ *  Usage: dscWriteTest [command interval in ms] [command number of a collision, 0 for none]
+ *  Default: 80, 0
+ */
+
+#include <dscKeybusInterface.h>
+#include "dscLinuxSim.h"
+
+const byte simClockPin = 5;
+const byte simDataPin = 4;
+const byte simWritePin = 6;
+
+dscKeybusInterface dsc(simClockPin, simDataPin, simWritePin);  // Global as in the sketches
+dscLinuxSim keybus(simClockPin, simDataPin);
+
+const char * commands[] = {"00000101 0 10000001 00000001", "01110001 0 00000110 00000001 00000000"};
+const char * keys = "1234#";
+const byte keyCount = 5;
+
+static byte keysWritten;
+static unsigned long failures;
+
+
+static void sketchLoop() {
+  while (dsc.handlePanel()) {}
+}
+
+
+// Compares the bits written in the write window to the zero bits of the key code
+static void checkKey(unsigned long long writtenBits) {
+  byte code = 0;
+  dscPanelProfile::keyCode(keys[keysWritten], code);
+  unsigned long long expectedBits = 0;
+  for (byte bit = 0; bit < 8; bit++) {
+    if (!bitRead(code, 7 - bit)) expectedBits |= 1ULL << (dscPanelProfile::writeStartBit + bit);
+  }
+  if (writtenBits != expectedBits) {
+    printf("FAIL key '%c': written 0x%llX, expected 0x%llX\n", keys[keysWritten], writtenBits, expectedBits);
+    failures++;
+  }
+}
+
+
+int main(int argc, char * argv[]) {
+  unsigned long commandInterval = argc > 1 ? atol(argv[1]) : 80;
+  unsigned int collisionCommand = argc > 2 ? atoi(argv[2]) : 0;
+  dsc.begin(Serial);
+  keybus.writePin = simWritePin;
+  keybus.loopFunction = sketchLoop;
+  keybus.begin();
+
+  // Starts writing after a few commands, the first command is used to find the start of the Keybus data
+  for (byte command = 0; command < 4; command++) {
+    unsigned long long commandTime = keybus.time;
+    keybus.command(commands[command % 2]);
+    while (keybus.time - commandTime < commandInterval * 1000) keybus.wait(500);
+  }
+  dsc.write(keys);
+  unsigned long long writeTime = keybus.time;
+
+  // Command keys are flagged at writeEndBit on the command before the key.  A key written on the command with a
+  // collision is written again on the next command.
+  unsigned int command = 1;
+  for (; command < 1000 && (keysWritten < keyCount || !dsc.writeReady); command++) {
+    unsigned long long commandTime = keybus.time;
+    if (command == collisionCommand) keybus.moduleBits = 0xFFULL << dscPanelProfile::writeStartBit;
+    keybus.command(commands[command % 2]);
+
+    unsigned long long keyBits = keybus.writtenBits & ~(1ULL << dscPanelProfile::writeEndBit);
+    if (keyBits && command != collisionCommand && keysWritten < keyCount) {
+      checkKey(keyBits);
+      printf("Key '%c': command %u, read back after %lu ms\n", keys[keysWritten], command, (unsigned long)dsc.writeLatency);
+      keysWritten++;
+    }
+    while (keybus.time - commandTime < commandInterval * 1000) keybus.wait(500);
+  }
+
+  printf("Command interval %lu ms: %u keys ready after %lu ms (%u commands), %u retries, %u failures\n", commandInterval, keysWritten,
+         (unsigned long)((keybus.time - writeTime) / 1000), command - 1, (unsigned int)dsc.writeRetries, (unsigned int)dsc.writeFailures);
+  if (keysWritten != keyCount || dsc.writeFailures || (collisionCommand && dsc.writeRetries != 1)) failures++;
+  printf("Write: %lu failures\n", failures);
+  return failures ? 1 : 0;
+}
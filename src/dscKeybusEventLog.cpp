@@ -0,0 +1,250 @@
+
+#include "dscKeybusInterface.h"
+
+/*
+ *  Event log
+ *
+ *  Record format:
+ *    Byte 0-3: Timestamp
+ *    Byte 4-5: Sequence number, incremented for each event to find the most recent event at begin()
+ *    Byte 6: Event type, 0x00 and 0xFF are empty records
+ *    Byte 7: Event data
+ */
+
+dscEventLog::dscEventLog(dscStateStorage &setStorage) {
+  storage = &setStorage;
+  timeSource = NULL;
+  restartRecord = true;
+  restartPending = false;
+}
+
+
+void dscEventLog::setTimeSource(unsigned long (*setTimeSource)()) {
+  timeSource = setTimeSource;
+}
+
+
+void dscEventLog::setRestartRecord(bool enabled) {
+  restartRecord = enabled;
+}
+
+
+bool dscEventLog::readSlot(unsigned int slot, dscEvent &event, unsigned int &sequence) {
+  byte record[dscEventRecordSize];
+  if (!storage->read(slot * dscEventRecordSize, record, dscEventRecordSize)) return false;
+  if (record[6] == 0x00 || record[6] == 0xFF) return false;
+
+  event.timestamp = (unsigned long)record[0] | ((unsigned long)record[1] << 8) | ((unsigned long)record[2] << 16) | ((unsigned long)record[3] << 24);
+  sequence = record[4] | (record[5] << 8);
+  event.type = record[6];
+  event.data = record[7];
+  return true;
+}
+
+
+// Scans the storage once to find the most recent event and build the time index.  Events are written to
+// consecutive slots with consecutive sequence numbers, the most recent event is the one that is not followed
+// by the next sequence number.
+bool dscEventLog::begin() {
+  if (!storage->begin()) return false;
+
+  slotCount = storage->size() / dscEventRecordSize;
+  if (slotCount > 0x7FFF) slotCount = 0x7FFF;  // Limits the ring to half the sequence number range
+  if (slotCount == 0) return false;
+
+  indexStep = (slotCount + dscEventIndexSize - 1) / dscEventIndexSize;
+  indexCount = (slotCount + indexStep - 1) / indexStep;
+
+  eventCount = 0;
+  headSlot = slotCount - 1;
+  headSequence = 0xFFFF;
+  lastTimestamp = 0;
+
+  dscEvent event;
+  unsigned int sequence = 0, firstSequence = 0, previousSequence = 0;
+  unsigned long previousTimestamp = 0;
+  bool firstValid = false, previousValid = false;
+  for (unsigned int slot = 0; slot < slotCount; slot++) {
+    bool valid = readSlot(slot, event, sequence);
+    if (slot == 0) {
+      firstValid = valid;
+      firstSequence = sequence;
+    }
+
+    if (slot % indexStep == 0) timeIndex[slot / indexStep] = valid ? event.timestamp : 0;
+
+    if (previousValid && (!valid || sequence != ((previousSequence + 1) & 0xFFFF))) {
+      headSlot = slot - 1;
+      headSequence = previousSequence;
+      lastTimestamp = previousTimestamp;
+    }
+
+    if (valid) eventCount++;
+    previousValid = valid;
+    previousSequence = sequence;
+    previousTimestamp = event.timestamp;
+  }
+
+  // Checks the last slot against the first slot
+  if (previousValid && (!firstValid || firstSequence != ((previousSequence + 1) & 0xFFFF))) {
+    headSlot = slotCount - 1;
+    headSequence = previousSequence;
+    lastTimestamp = previousTimestamp;
+  }
+
+  // Without a time source, events after a restart continue from the last stored event time instead of being
+  // held at that time until the uptime passes it.  The restart record marks the time lost while restarting, and
+  // is written with the next event so begin() does not overwrite the oldest event of a full log.
+  beginTimestamp = lastTimestamp;
+  beginTime = millis() / 1000;
+  restartPending = eventCount > 0;
+
+  return true;
+}
+
+
+bool dscEventLog::log(byte type, byte data) {
+  if (slotCount == 0) return false;
+
+  unsigned long timestamp;
+  if (timeSource) timestamp = timeSource();
+  else timestamp = beginTimestamp + (millis() / 1000 - beginTime);
+  if (timestamp < lastTimestamp) timestamp = lastTimestamp;  // Keeps events ordered by time if the clock is set back
+
+  if (restartPending && restartRecord && !writeEvent(lastTimestamp, dscEventRestart, 0)) return false;
+  restartPending = false;
+  return writeEvent(timestamp, type, data);
+}
+
+
+bool dscEventLog::writeEvent(unsigned long timestamp, byte type, byte data) {
+  unsigned int slot = headSlot + 1;
+  if (slot >= slotCount) slot = 0;
+  unsigned int sequence = (headSequence + 1) & 0xFFFF;
+
+  byte record[dscEventRecordSize];
+  record[0] = timestamp;
+  record[1] = timestamp >> 8;
+  record[2] = timestamp >> 16;
+  record[3] = timestamp >> 24;
+  record[4] = sequence;
+  record[5] = sequence >> 8;
+  record[6] = type;
+  record[7] = data;
+  if (!storage->write(slot * dscEventRecordSize, record, dscEventRecordSize)) return false;
+
+  headSlot = slot;
+  headSequence = sequence;
+  lastTimestamp = timestamp;
+  if (eventCount < slotCount) eventCount++;
+  if (slot % indexStep == 0) timeIndex[slot / indexStep] = timestamp;
+  return true;
+}
+
+
+unsigned int dscEventLog::count() {
+  return eventCount;
+}
+
+
+// Slot of the oldest event
+unsigned int dscEventLog::firstSlot() {
+  if (eventCount < slotCount) return 0;
+  if (headSlot + 1 >= slotCount) return 0;
+  return headSlot + 1;
+}
+
+
+bool dscEventLog::readEvent(unsigned int position, dscEvent &event) {
+  if (position >= eventCount) return false;
+  unsigned int slot = firstSlot() + position;
+  if (slot >= slotCount) slot -= slotCount;
+  unsigned int sequence;
+  return readSlot(slot, event, sequence);
+}
+
+
+// Binary searches the time index for the last indexed event before fromTime, then reads forward from that
+// event - at most indexStep reads before reaching the first event at or after fromTime.  Returns count() if
+// there are no events at or after fromTime.
+unsigned int dscEventLog::findEvent(unsigned long fromTime) {
+  if (eventCount == 0) return 0;
+
+  // Index entries in event order start at the first indexed slot at or after the oldest event
+  unsigned int first = firstSlot();
+  unsigned int firstIndex = ((first + indexStep - 1) / indexStep) % indexCount;
+
+  unsigned int low = 0, high = indexCount;
+  while (low < high) {
+    unsigned int middle = (low + high) / 2;
+    unsigned int index = (firstIndex + middle) % indexCount;
+    unsigned int position = (index * indexStep + slotCount - first) % slotCount;
+    if (position < eventCount && timeIndex[index] < fromTime) low = middle + 1;
+    else high = middle;
+  }
+
+  unsigned int position = 0;
+  if (low > 0) {
+    unsigned int index = (firstIndex + low - 1) % indexCount;
+    position = (index * indexStep + slotCount - first) % slotCount;
+  }
+
+  dscEvent event;
+  while (readEvent(position, event) && event.timestamp < fromTime) position++;
+  if (position > eventCount) position = eventCount;
+  return position;
+}
+
+
+unsigned int dscEventLog::printEvents(unsigned long fromTime, unsigned long toTime, Stream &output) {
+  unsigned int printedEvents = 0;
+  dscEvent event;
+  for (unsigned int position = findEvent(fromTime); readEvent(position, event) && event.timestamp <= toTime; position++) {
+    printEvent(event, output);
+    output.println();
+    printedEvents++;
+  }
+  return printedEvents;
+}
+
+
+void dscEventLog::printEvent(const dscEvent &event, Print &output) {
+  output.print(event.timestamp);
+  output.print(F(" "));
+  printEventMessage(event, output);
+}
+
+
+void dscEventLog::printEventMessage(const dscEvent &event, Print &output) {
+  switch (event.type) {
+    case dscEventZoneOpen: output.print(F("Zone open: ")); output.print(event.data); break;
+    case dscEventZoneClosed: output.print(F("Zone closed: ")); output.print(event.data); break;
+    case dscEventArmed: output.print(F("Armed: partition ")); output.print(event.data); break;
+    case dscEventDisarmed: output.print(F("Disarmed: partition ")); output.print(event.data); break;
+    case dscEventTrouble: output.print(F("Trouble")); break;
+    case dscEventTroubleRestored: output.print(F("Trouble restored")); break;
+    case dscEventPowerTrouble: output.print(F("Power trouble")); break;
+    case dscEventPowerRestored: output.print(F("Power restored")); break;
+    case dscEventRestart: output.print(F("Restart")); break;
+    default:
+      output.print(F("Unknown event: 0x"));
+      output.print(event.type, HEX);
+      break;
+  }
+}
+
+
+void dscKeybusInterface::setEventLog(dscEventLog &log) {
+  eventLog = &log;
+}
+
+
+void dscKeybusInterface::setOutbox(dscOutbox &setOutbox) {
+  outbox = &setOutbox;
+}
+
+
+void dscKeybusInterface::logEvent(byte type, byte data) {
+  if (eventLog) eventLog->log(type, data);
+  if (outbox) outbox->add(type, data);
+}
@@ -0,0 +1,69 @@
+
+#ifndef dscKeybusEventLog_h
+#define dscKeybusEventLog_h
+
+#include <Arduino.h>
+#include "dscKeybusStateStorage.h"
+
+#if defined(__AVR__)
+const byte dscEventIndexSize = 8;   // Number of time index entries - requires 4 bytes of memory per entry
+#else
+const byte dscEventIndexSize = 32;
+#endif
+
+const byte dscEventRecordSize = 8;  // Storage used per event
+
+// Event types - the event data is the zone number for zone events and the partition number for armed events
+const byte dscEventZoneOpen = 0x01;
+const byte dscEventZoneClosed = 0x02;
+const byte dscEventArmed = 0x03;
+const byte dscEventDisarmed = 0x04;
+const byte dscEventTrouble = 0x05;
+const byte dscEventTroubleRestored = 0x06;
+const byte dscEventPowerTrouble = 0x07;
+const byte dscEventPowerRestored = 0x08;
+const byte dscEventRestart = 0x7E;    // Written before the first event after begin() if the log has events, the timestamp is the last event time before the restart
+const byte dscEventDelivered = 0x7F;  // Written by dscOutbox to a spill log, the event data is the number of events delivered
+
+struct dscEvent {
+  unsigned long timestamp;
+  byte type;
+  byte data;
+};
+
+
+// Append-only event history stored in a ring of fixed-size records, the oldest events are overwritten when
+// the storage is full.  A sparse index of timestamps sampled every few records is kept in memory to find
+// events by time with a binary search, followed by reading the requested events in order.
+class dscEventLog {
+
+  public:
+    dscEventLog(dscStateStorage &setStorage);
+
+    bool begin();                                       // Finds the most recent event in storage, returns false if the storage is unavailable
+    void setTimeSource(unsigned long (*setTimeSource)());  // Sets the event timestamp source, defaults to seconds since begin() added to the last stored event time
+    void setRestartRecord(bool enabled);                // Logs dscEventRestart before the first event after begin() (default: true)
+    bool log(byte type, byte data);                     // Appends an event, returns false if the storage write failed
+    unsigned int count();                               // Number of stored events
+    unsigned int findEvent(unsigned long fromTime);     // Returns the position of the first event at or after fromTime
+    bool readEvent(unsigned int position, dscEvent &event);  // Reads an event by position, 0 is the oldest event
+    unsigned int printEvents(unsigned long fromTime, unsigned long toTime, Stream &output);  // Prints events in a time range, returns the number of events
+    static void printEvent(const dscEvent &event, Print &output);         // Prints the timestamp and event message
+    static void printEventMessage(const dscEvent &event, Print &output);  // Prints the event message
+
+  private:
+    bool readSlot(unsigned int slot, dscEvent &event, unsigned int &sequence);
+    bool writeEvent(unsigned long timestamp, byte type, byte data);
+    unsigned int firstSlot();
+
+    dscStateStorage* storage;
+    unsigned long (*timeSource)();
+    unsigned int slotCount, eventCount, headSlot, headSequence;
+    unsigned int indexStep, indexCount;
+    unsigned long lastTimestamp;
+    unsigned long beginTimestamp, beginTime;  // Last stored event time and seconds since boot at begin()
+    bool restartRecord, restartPending;
+    unsigned long timeIndex[dscEventIndexSize];  // Timestamp of the event in every indexStep slot
+};
+
+#endif  // dscKeybusEventLog_h
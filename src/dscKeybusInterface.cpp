@@ -24,12 +24,50 @@ char dscKeybusInterface::writeKey;
 byte dscKeybusInterface::writePartition;
 byte dscKeybusInterface::writeByte;
 byte dscKeybusInterface::writeBit;
+bool dscKeybusInterface::rawBitMode;
+unsigned int dscKeybusInterface::clockGlitchTime;
+bool dscKeybusInterface::majorityVote;
+volatile unsigned long dscKeybusInterface::filteredEdges;
+volatile unsigned long dscKeybusInterface::disputedBits;
+volatile bool dscKeybusInterface::isrClockHigh;
+bool dscKeybusInterface::clockRecovery;
+volatile unsigned long dscKeybusInterface::clockInterrupts;
+volatile unsigned long dscKeybusInterface::dataInterrupts;
+volatile unsigned long dscKeybusInterface::clockRiseTime;
+volatile byte dscKeybusInterface::recoveryEdges;
+volatile unsigned long dscKeybusInterface::recoveryStartTime;
+volatile unsigned long dscKeybusInterface::recoveryPeriod;
+volatile bool dscKeybusInterface::recoveryLocked;
+volatile bool dscKeybusInterface::recoveryStarted;
+volatile bool dscKeybusInterface::recoveryExpectHigh;
+volatile dscTraceRecord dscKeybusInterface::traceRing[dscTraceRecordSize];
+volatile unsigned long dscKeybusInterface::traceCount;
+volatile bool dscKeybusInterface::traceHold;
+volatile unsigned long dscKeybusInterface::isrMaxTime;
+volatile unsigned long dscKeybusInterface::rawBuffer[dscRawBufferSize];
+volatile byte dscKeybusInterface::rawBufferHead;
+volatile byte dscKeybusInterface::rawBufferTail;
+volatile bool dscKeybusInterface::rawBufferGap;
+volatile unsigned long dscKeybusInterface::isrRawWord;
+volatile byte dscKeybusInterface::isrRawShift;
+volatile byte dscKeybusInterface::isrRawBitTotal;
+volatile byte dscKeybusInterface::isrRawCommand;
 bool dscKeybusInterface::virtualKeypad;
 bool dscKeybusInterface::processModuleData;
 byte dscKeybusInterface::panelData[dscReadSize];
 byte dscKeybusInterface::panelByteCount;
 byte dscKeybusInterface::panelBitCount;
 volatile bool dscKeybusInterface::writeReady;
+volatile unsigned long dscKeybusInterface::writeLatency;
+volatile unsigned int dscKeybusInterface::writeRetries;
+volatile unsigned int dscKeybusInterface::writeFailures;
+volatile bool dscKeybusInterface::writeVerify;
+volatile bool dscKeybusInterface::writeRelease;
+volatile bool dscKeybusInterface::writeRepeat;
+volatile bool dscKeybusInterface::writeKeyCommand;
+volatile byte dscKeybusInterface::isrWriteEcho;
+volatile byte dscKeybusInterface::writeRetryCount;
+volatile unsigned long dscKeybusInterface::writeStartTime;
 volatile byte dscKeybusInterface::moduleData[dscReadSize];
 volatile bool dscKeybusInterface::moduleDataCaptured;
 volatile byte dscKeybusInterface::moduleByteCount;
@@ -39,10 +77,15 @@ volatile bool dscKeybusInterface::writeCmd;
 volatile bool dscKeybusInterface::writeAsterisk;
 volatile bool dscKeybusInterface::wroteAsterisk;
 volatile bool dscKeybusInterface::bufferOverflow;
-volatile byte dscKeybusInterface::panelBufferLength;
-volatile byte dscKeybusInterface::panelBuffer[dscBufferSize][dscReadSize];
-volatile byte dscKeybusInterface::panelBufferBitCount[dscBufferSize];
-volatile byte dscKeybusInterface::panelBufferByteCount[dscBufferSize];
+volatile unsigned int dscKeybusInterface::bufferPeak;
+volatile unsigned long dscKeybusInterface::droppedCommands[dscPriorityClasses];
+volatile byte dscKeybusInterface::panelBufferLength[dscPriorityClasses];
+volatile byte dscKeybusInterface::panelBuffer[dscPanelBufferSize];
+volatile unsigned int dscKeybusInterface::panelBufferHead[dscPriorityClasses];
+volatile unsigned int dscKeybusInterface::panelBufferTail[dscPriorityClasses];
+volatile unsigned int dscKeybusInterface::panelBufferUsed[dscPriorityClasses];
+volatile bool dscKeybusInterface::panelBufferReading;
+volatile byte dscKeybusInterface::isrPrioritySequence;
 volatile byte dscKeybusInterface::isrPanelData[dscReadSize];
 volatile byte dscKeybusInterface::isrPanelByteCount;
 volatile byte dscKeybusInterface::isrPanelBitCount;
@@ -55,6 +98,17 @@ volatile byte dscKeybusInterface::currentCmd;
 volatile byte dscKeybusInterface::statusCmd;
 volatile unsigned long dscKeybusInterface::clockHighTime;
 volatile unsigned long dscKeybusInterface::keybusTime;
+volatile unsigned long dscKeybusInterface::isrFrameInterval;
+volatile unsigned int dscKeybusInterface::isrFrameCount;
+volatile unsigned int dscKeybusInterface::isrIncompleteCount;
+
+// Panel buffer record: bit count, byte count, priority sequence if dscPriorityLanes is enabled, capture time in
+// micros() if dscLatencyTrace is enabled, data.  The low priority lane starts at 0 and the high priority lane at
+// dscBufferSize, heads and tails are offsets in the lane.
+const byte dscRecordHeaderSize = 2 + (dscPriorityLanes ? 1 : 0) + (dscLatencyTrace ? 4 : 0);
+
+// dscClockInterrupt() writes the key bits from writeStartBit, and completes the write at writeEndBit after the key
+static_assert(dscPanelProfile::writeEndBit > dscPanelProfile::writeStartBit + 7, "writeEndBit must follow the 8 key bits");
 
 
 dscKeybusInterface::dscKeybusInterface(byte setClockPin, byte setReadPin, byte setWritePin) {
@@ -66,7 +120,150 @@ dscKeybusInterface::dscKeybusInterface(byte setClockPin, byte setReadPin, byte s
   processRedundantData = true;
   displayTrailingBits = true;
   processModuleData = true;
+  hideKeypadDigits = false;
   writePartition = 1;
+  keybusTimeoutMultiple = 4;
+  clockGlitchTime = 0;
+
+  // All status and tracking starts cleared, so instances do not need to be global to be zero-initialized
+  stream = NULL;
+  writeKeysArray = NULL;
+  writeKeysPending = false;
+  memset(writeArm, 0, sizeof(writeArm));
+  armStayCommand = false;
+  queryResponse = false;
+
+  // Status and the previous status used to detect changes
+  statusChanged = false;
+  keybusConnected = false;
+  keybusChanged = false;
+  previousKeybus = false;
+  accessCodePrompt = false;
+  trouble = false;
+  troubleChanged = false;
+  previousTrouble = false;
+  powerTrouble = false;
+  previousPowerTrouble = false;
+  powerChanged = false;
+  batteryTrouble = false;
+  batteryChanged = false;
+  keypadFireAlarm = false;
+  keypadAuxAlarm = false;
+  keypadPanicAlarm = false;
+  previousHomeKey = false;
+  for (byte partitionIndex = 0; partitionIndex < dscPartitions; partitionIndex++) {
+    ready[partitionIndex] = false;
+    readyChanged[partitionIndex] = false;
+    previousReady[partitionIndex] = false;
+    armed[partitionIndex] = false;
+    armedAway[partitionIndex] = false;
+    armedStay[partitionIndex] = false;
+    noEntryDelay[partitionIndex] = false;
+    armedChanged[partitionIndex] = false;
+    previousArmed[partitionIndex] = false;
+    alarm[partitionIndex] = false;
+    alarmChanged[partitionIndex] = false;
+    previousAlarm[partitionIndex] = false;
+    exitDelay[partitionIndex] = false;
+    exitDelayChanged[partitionIndex] = false;
+    previousExitDelay[partitionIndex] = false;
+    entryDelay[partitionIndex] = false;
+    entryDelayChanged[partitionIndex] = false;
+    previousEntryDelay[partitionIndex] = false;
+    fire[partitionIndex] = false;
+    fireChanged[partitionIndex] = false;
+    previousFire[partitionIndex] = false;
+    previousLights[partitionIndex] = 0;
+    previousStatus[partitionIndex] = 0;
+    #if defined(dscPowerSeries)
+    lights[partitionIndex] = 0;
+    status[partitionIndex] = 0;
+    #endif
+  }
+  openZonesStatusChanged = false;
+  alarmZonesStatusChanged = false;
+  for (byte zoneGroup = 0; zoneGroup < dscZones; zoneGroup++) {
+    openZones[zoneGroup] = 0;
+    openZonesChanged[zoneGroup] = 0;
+    previousOpenZones[zoneGroup] = 0;
+    alarmZones[zoneGroup] = 0;
+    alarmZonesChanged[zoneGroup] = 0;
+    previousAlarmZones[zoneGroup] = 0;
+  }
+
+  // Keypad display
+  memset(displayText, 0, sizeof(displayText));
+  displayBlink = false;
+  displayChanged = false;
+  displayTime = 0;
+  previousDisplay = 0;
+  memset(displaySequence, 0, sizeof(displaySequence));
+  displaySequenceLength = 0;
+  displayBlank = false;
+  displayPaused = false;
+  displayFlashing = false;
+  displaySegmentsTime = 0;
+  displayCharacterTime = 0;
+
+  // Storage, event log and outbox are set by the sketch
+  stateStorage = NULL;
+  stateSaveInterval = 0;
+  previousStateSave = 0;
+  stateSequence = 0;
+  stateSlot = 0;
+  stateSlotCount = 0;
+  memset(savedState, 0, sizeof(savedState));
+  stateDecoded = false;
+  stateRestored = false;
+  eventLog = NULL;
+  outbox = NULL;
+
+  // Command table and sketch command handlers
+  for (unsigned int command = 0; command < dscCommandTableSize; command++) commandTable[command] = dscCommandStatus;
+  tableCommands[0] = 0;
+  tableCommandCount = 0;
+  for (byte i = 0; i < dscCommandHandlerSize; i++) commandHandlers[i] = NULL;
+
+  // Debounce is disabled for each signal except trouble
+  memset(debounceSettle, 0, sizeof(debounceSettle));
+  memset(debounceHold, 0, sizeof(debounceHold));
+  memset(debounceStart, 0, sizeof(debounceStart));
+  memset(debounceChange, 0, sizeof(debounceChange));
+  memset(debouncePending, 0, sizeof(debouncePending));
+  debounceHold[dscSignalTrouble] = 3000;
+  suppressedChanges = 0;
+
+  // Link quality
+  framesPerSecond = 0;
+  incompletePercent = 0;
+  errorPercent = 0;
+  frameInterval = 0;
+  keybusTimeout = dscKeybusTimeout;
+  linkQualityTime = 0;
+  linkErrorCount = 0;
+  linkConnected = false;
+  ageCommandCount = 0;
+  memset(ageCommands, 0, sizeof(ageCommands));
+  memset(ageTimes, 0, sizeof(ageTimes));
+
+  // Buffered commands, repeats and snapshots
+  supersededCommands = 0;
+  prioritySequence = 0;
+  memset(&panelRepeat, 0, sizeof(panelRepeat));
+  memset(repeatRuns, 0, sizeof(repeatRuns));
+  repeatChanged = false;
+  statusSnapshotVersion = 0;
+  memset(statusSnapshots, 0, sizeof(statusSnapshots));
+  memset(zoneActivities, 0, sizeof(zoneActivities));
+  activityWindowStart = 0;
+  latencyFrameTime = 0;
+  latencyDequeueTime = 0;
+  latencyChangeFrameTime = 0;
+  latencyChangeTime = 0;
+  latencyChangePending = false;
+  memset(latencyHistogram, 0, sizeof(latencyHistogram));
+  memset(latencyCounts, 0, sizeof(latencyCounts));
+  memset(latencyMaxTimes, 0, sizeof(latencyMaxTimes));
 }
 
 
@@ -76,6 +273,13 @@ void dscKeybusInterface::begin(Stream &_stream) {
   if (virtualKeypad) pinMode(dscWritePin, OUTPUT);
   stream = &_stream;
 
+  // Restores the status saved before a reset, skipped when restarting after stop()
+  if (stateStorage && !stateDecoded) restoreState();
+  publishStatus();
+
+  // Zone activity is counted from the first begin(), restarting after stop() continues the window
+  if (dscZoneAnalytics && activityWindowStart == 0) activityWindowStart = millis();
+
   // Platform-specific timers trigger a read of the data line 250us after the Keybus clock changes
 
   // Arduino Timer1 calls ISR(TIMER1_OVF_vect) from dscClockInterrupt() and is disabled in the ISR for a one-shot timer
@@ -91,86 +295,248 @@ void dscKeybusInterface::begin(Stream &_stream) {
   timer1_enable(TIM_DIV16, TIM_EDGE, TIM_SINGLE);
   #endif
 
+  // Clock recovery requires a periodic timer and is not used with a virtual keypad, as keys are written on clock edges
+  #if !defined(ESP8266)
+  clockRecovery = false;
+  #endif
+  if (virtualKeypad) clockRecovery = false;
+
   // Generates an interrupt when the Keybus clock rises or falls - requires a hardware interrupt pin on Arduino
   attachInterrupt(digitalPinToInterrupt(dscClockPin), dscClockInterrupt, CHANGE);
 }
 
 
+// Disables the Keybus interrupts and clears the captured data, begin() restarts the interface
+void dscKeybusInterface::stop() {
+
+  // Disables the clock interrupt and the timer used to read the data line
+  detachInterrupt(digitalPinToInterrupt(dscClockPin));
+  #if defined(__AVR__)
+  TCCR1B = 0;
+  TIMSK1 &= ~(1 << TOIE1);
+  #elif defined(ESP8266)
+  timer1_disable();
+  timer1_detachInterrupt();
+  #endif
+
+  // Releases the data line if a virtual keypad write was in progress
+  if (virtualKeypad) digitalWrite(dscWritePin, LOW);
+
+  // Resets the capture data and buffers
+  for (byte i = 0; i < dscReadSize; i++) {
+    isrPanelData[i] = 0;
+    isrModuleData[i] = 0;
+  }
+  isrPanelBitTotal = 0;
+  isrPanelBitCount = 0;
+  isrPanelByteCount = 0;
+  isrModuleBitTotal = 0;
+  isrModuleBitCount = 0;
+  isrModuleByteCount = 0;
+  for (byte lane = 0; lane < dscPriorityClasses; lane++) {
+    panelBufferLength[lane] = 0;
+    panelBufferHead[lane] = 0;
+    panelBufferTail[lane] = 0;
+    panelBufferUsed[lane] = 0;
+  }
+  panelBufferReading = false;
+  isrPrioritySequence = 0;
+  prioritySequence = 0;
+  rawBufferHead = 0;
+  rawBufferTail = 0;
+  rawBufferGap = false;
+  isrRawWord = 0;
+  isrRawShift = 0;
+  isrRawBitTotal = 0;
+  recoveryEdges = 0;
+  recoveryLocked = false;
+  recoveryPeriod = 0;
+  writeKeysPending = false;
+  writeVerify = false;
+  writeRelease = false;
+  writeRepeat = false;
+  writeReady = true;
+
+  keybusConnected = false;
+  previousKeybus = false;
+}
+
+
+// Clears the previous status so the next panel data sets the status changed flags for the complete status
+void dscKeybusInterface::resetStatus() {
+  statusChanged = true;
+  keybusChanged = true;
+  troubleChanged = true;
+  powerChanged = true;
+  for (byte partitionIndex = 0; partitionIndex < dscPartitions; partitionIndex++) {
+    armedChanged[partitionIndex] = true;
+  }
+  openZonesStatusChanged = true;
+  for (byte zoneGroup = 0; zoneGroup < dscZones; zoneGroup++) openZonesChanged[zoneGroup] = 0xFF;
+  displayChanged = true;
+}
+
+
 bool dscKeybusInterface::handlePanel() {
 
-  // Checks if Keybus data is detected and sets a status flag if data is not detected for 3s
+  // Updates link quality and the disconnect time learned from the interval between commands
+  if (millis() - linkQualityTime >= 1000) processLinkQuality();
+
+  // Checks if Keybus data is detected and sets a status flag if data is not detected for keybusTimeout
   noInterrupts();
-  if (millis() - keybusTime > 3000) keybusConnected = false;  // dataTime is set in dscDataInterrupt() when the clock resets
+  if (millis() - keybusTime > keybusTimeout) keybusConnected = false;  // keybusTime is set in dscDataInterrupt() when the clock resets
   else keybusConnected = true;
   interrupts();
   if (previousKeybus != keybusConnected) {
     previousKeybus = keybusConnected;
     keybusChanged = true;
     statusChanged = true;
+    publishStatus();
     if (!keybusConnected) return true;
   }
 
   // Writes keys when multiple keys are sent as a char array
   if (writeKeysPending) writeKeys(writeKeysArray);
 
-  // Skips processing if the panel data buffer is empty
-  if (panelBufferLength == 0) return false;
+  // Saves status changes to storage
+  if (stateStorage && stateDecoded) saveState();
 
-  // Copies data from the buffer to panelData[]
-  static byte panelBufferIndex = 1;
-  byte dataIndex = panelBufferIndex - 1;
-  for (byte i = 0; i < dscReadSize; i++) panelData[i] = panelBuffer[dataIndex][i];
-  panelBitCount = panelBufferBitCount[dataIndex];
-  panelByteCount = panelBufferByteCount[dataIndex];
-  panelBufferIndex++;
+  // Ends a keypad display sequence when the display is blank or steady
+  processDisplayPause();
+  publishStatus();
 
-  // Resets counters when the buffer is cleared
-  noInterrupts();
-  if (panelBufferIndex > panelBufferLength) {
-    panelBufferIndex = 1;
-    panelBufferLength = 0;
+  // Decodes samples stored by dscDataInterrupt() in rawBitMode
+  if (rawBitMode) processRawBits();
+
+  // Skips processing if the panel data buffer is empty
+  if (panelBufferLength[dscPriorityLow] == 0 && panelBufferLength[dscPriorityHigh] == 0) return false;
+
+  // Selects the lane: commands are read in capture order, and commands with status changes are read first if the
+  // sketch is falling behind with more than dscPriorityBacklog low priority commands.  The oldest low priority
+  // command is not evicted while the lane is selected and read.
+  byte lane = dscPriorityLow;
+  if (panelBufferLength[dscPriorityHigh] > 0) {
+    lane = dscPriorityHigh;
+    if (panelBufferLength[dscPriorityLow] > 0 && panelBufferLength[dscPriorityLow] <= dscPriorityBacklog) {
+      unsigned int sequenceIndex = panelBufferTail[dscPriorityLow] + 2;
+      if (sequenceIndex >= dscBufferSize) sequenceIndex -= dscBufferSize;
+      if (panelBuffer[sequenceIndex] == prioritySequence) lane = dscPriorityLow;  // Captured before the next status change
+    }
+  }
+  if (lane == dscPriorityLow) panelBufferReading = true;
+
+  // Copies data from the buffer
+  volatile byte * laneBuffer = lane == dscPriorityHigh ? &panelBuffer[dscBufferSize] : panelBuffer;
+  unsigned int laneSize = lane == dscPriorityHigh ? dscPriorityBufferSize : dscBufferSize;
+  unsigned int bufferIndex = panelBufferTail[lane];
+  byte bitCount = laneBuffer[bufferIndex];
+  if (++bufferIndex >= laneSize) bufferIndex = 0;
+  byte byteCount = laneBuffer[bufferIndex];
+  if (++bufferIndex >= laneSize) bufferIndex = 0;
+  byte sequence = 0;
+  if (dscPriorityLanes) {
+    sequence = laneBuffer[bufferIndex];
+    if (++bufferIndex >= laneSize) bufferIndex = 0;
+  }
+  if (dscLatencyTrace) {
+    latencyFrameTime = 0;
+    for (byte i = 0; i < 4; i++) {
+      latencyFrameTime |= (unsigned long)laneBuffer[bufferIndex] << (i * 8);
+      if (++bufferIndex >= laneSize) bufferIndex = 0;
+    }
+  }
+  byte recordData[dscReadSize];
+  byte dataLength = panelDataLength(bitCount, byteCount);
+  for (byte i = 0; i < dataLength; i++) {
+    recordData[i] = laneBuffer[bufferIndex];
+    if (++bufferIndex >= laneSize) bufferIndex = 0;
   }
+
+  // Releases the buffer space
+  noInterrupts();
+  panelBufferTail[lane] = bufferIndex;
+  panelBufferUsed[lane] -= dataLength + dscRecordHeaderSize;
+  panelBufferLength[lane]--;
+  panelBufferReading = false;
   interrupts();
 
+  // Publishes a run of status commands counted by dscDataInterrupt(), panelData[] is unchanged
+  if (bitCount == 0) {
+    unsigned long firstTime = 0, lastTime = 0;
+    for (byte i = 0; i < 4; i++) {
+      firstTime |= (unsigned long)recordData[2 + i] << (i * 8);
+      lastTime |= (unsigned long)recordData[6 + i] << (i * 8);
+    }
+    publishRepeat(recordData[0], recordData[1], firstTime, lastTime);
+    return false;
+  }
+
+  // Skips low priority commands captured before a status change that was already read, the status is outdated.
+  // Commands with a sketch command handler or a keypad display character are not skipped.
+  if (dscPriorityLanes) {
+    if (lane == dscPriorityHigh) prioritySequence = sequence;
+    else if (sequence != prioritySequence && !(commandEntry(recordData[0]) & dscCommandHandlerMask) && !dscPanelProfile::displayCharacter(recordData[0])) {
+      supersededCommands++;
+      return false;
+    }
+  }
+
+  panelBitCount = bitCount;
+  panelByteCount = byteCount;
+  for (byte i = 0; i < dscReadSize; i++) panelData[i] = i < dataLength ? recordData[i] : 0;
+  trackCommandAge(panelData[0]);
+
+  if (dscLatencyTrace) {
+    latencyDequeueTime = micros();
+    recordLatency(dscLatencyQueue, latencyDequeueTime - latencyFrameTime);
+  }
+
   // Waits at startup for the 0x05 status command or a command with valid CRC data to eliminate spurious data.
   static bool firstClockCycle = true;
   if (firstClockCycle) {
     if (validCRC() || panelData[0] == 0x05) firstClockCycle = false;
     else return false;
   }
+  if (!validCRC()) linkErrorCount++;
 
   // Skips redundant data sent constantly while in installer programming
   static byte previousCmd0A[dscReadSize];
   static byte previousCmdE6_20[dscReadSize];
+  bool redundant = false;
   switch (panelData[0]) {
     case 0x0A:  // Status in programming
-      if (redundantPanelData(previousCmd0A, panelData)) return false;
+      redundant = redundantPanelData(previousCmd0A, panelData);
       break;
 
     case 0xE6:
-      if (panelData[2] == 0x20 && redundantPanelData(previousCmdE6_20, panelData)) return false;  // Status in programming, zone lights 33-64
+      if (panelData[2] == 0x20) redundant = redundantPanelData(previousCmdE6_20, panelData);  // Status in programming, zone lights 33-64
       break;
   }
-  if (dscPartitions > 4) {
+  if (dscPartitions > 4 && !redundant) {
     static byte previousCmdE6_03[dscReadSize];
-    if (panelData[0] == 0xE6 && panelData[2] == 0x03 && redundantPanelData(previousCmdE6_03, panelData, 8)) return false;  // Status in alarm/programming, partitions 5-8
+    if (panelData[0] == 0xE6 && panelData[2] == 0x03) redundant = redundantPanelData(previousCmdE6_03, panelData, 8);  // Status in alarm/programming, partitions 5-8
   }
 
   // Skips redundant data from periodic commands sent at regular intervals, skipping is a configurable
   // option and the default behavior to help see new Keybus data when decoding the protocol
-  if (!processRedundantData) {
+  if (!processRedundantData && !redundant) {
     static byte previousCmd[dscReadSize];
-    if (redundantPanelData(previousCmd, panelData))
-    {
-       return false;
+    bool debouncing = false;  // Processes redundant data while status changes are waiting to be accepted
+    for (byte group = 0; group < dscDebounceGroups; group++) {
+      if (debouncePending[group]) debouncing = true;
     }
+    redundant = redundantPanelData(previousCmd, panelData) && !debouncing;
   }
 
+  // Counts skipped commands as a run of repeats
+  trackRepeat(redundant);
+  if (redundant) return false;
+
   //Process home key
   processHomeKey();
   // Processes valid panel data
-  processPanel_Zones();
-
+  processCommand();
+  publishStatus();
 
   return true;
 }
@@ -183,15 +549,142 @@ bool dscKeybusInterface::handleModule() {
 }
 
 
+byte dscKeybusInterface::bufferedCommands() {
+  return panelBufferLength[dscPriorityLow] + panelBufferLength[dscPriorityHigh];
+}
+
+
+/*
+ *  Status snapshot
+ *
+ *  Double buffered with a version number: the next version is written to the snapshot not referenced by the
+ *  current version, then the version is updated.  A reader copies the snapshot of the version it read and
+ *  retries only if a complete new version was published during the copy, so readers never wait for the
+ *  writer and the writer never waits for readers.
+ */
+void dscKeybusInterface::publishStatus() {
+  if (!statusChanged) return;
+
+  unsigned long version = statusSnapshotVersion + 1;
+  dscStatus &snapshot = statusSnapshots[version & 1];
+  snapshot.keybusConnected = keybusConnected;
+  snapshot.accessCodePrompt = accessCodePrompt;
+  snapshot.trouble = trouble;
+  snapshot.powerTrouble = powerTrouble;
+  snapshot.batteryTrouble = batteryTrouble;
+  for (byte partitionIndex = 0; partitionIndex < dscPartitions; partitionIndex++) {
+    snapshot.ready[partitionIndex] = ready[partitionIndex];
+    snapshot.armed[partitionIndex] = armed[partitionIndex];
+    snapshot.armedAway[partitionIndex] = armedAway[partitionIndex];
+    snapshot.armedStay[partitionIndex] = armedStay[partitionIndex];
+    snapshot.noEntryDelay[partitionIndex] = noEntryDelay[partitionIndex];
+    snapshot.alarm[partitionIndex] = alarm[partitionIndex];
+    snapshot.exitDelay[partitionIndex] = exitDelay[partitionIndex];
+    snapshot.entryDelay[partitionIndex] = entryDelay[partitionIndex];
+    snapshot.fire[partitionIndex] = fire[partitionIndex];
+  }
+  for (byte zoneGroup = 0; zoneGroup < dscZones; zoneGroup++) {
+    snapshot.openZones[zoneGroup] = openZones[zoneGroup];
+    snapshot.alarmZones[zoneGroup] = alarmZones[zoneGroup];
+  }
+  memcpy(snapshot.displayText, displayText, sizeof(snapshot.displayText));
+  snapshot.displayBlink = displayBlink;
+
+  // statusChanged stays set until the sketch clears it, the version only changes if the status differs
+  snapshot.version = statusSnapshotVersion;
+  if (memcmp(&snapshot, &statusSnapshots[statusSnapshotVersion & 1], sizeof(dscStatus)) == 0) return;
+
+  snapshot.version = version;
+  dscMemoryBarrier();
+  statusSnapshotVersion = version;
+}
+
+
+bool dscKeybusInterface::getStatus(dscStatus &copy, unsigned long knownVersion) {
+  while (true) {
+    unsigned long version = statusSnapshotVersion;
+    if (version == knownVersion) return false;
+    dscMemoryBarrier();
+    memcpy(&copy, (const void *)&statusSnapshots[version & 1], sizeof(dscStatus));
+    dscMemoryBarrier();
+    if (statusSnapshotVersion == version) return true;
+  }
+}
+
+
+unsigned long dscKeybusInterface::statusVersion() {
+  return statusSnapshotVersion;
+}
+
+
+/*
+ *  Repeated commands
+ *
+ *  Each skipped command adds to the run for its command byte, and the run is published when the command is
+ *  next processed with changed data.  If all runs are in use, the run with the oldest repeat is published to
+ *  start a run for the new command.  Status commands 0x05 and 0x1B are counted the same way in
+ *  processDataBit() and buffered as a repeat record, a record with a bit count of 0.
+ */
+void dscKeybusInterface::trackRepeat(bool repeated) {
+  byte command = panelData[0];
+  unsigned long currentTime = millis();
+  byte freeRun = dscRepeatRunSize, oldestRun = 0;
+
+  for (byte run = 0; run < dscRepeatRunSize; run++) {
+    dscRepeatRun &repeatRun = repeatRuns[run];
+    if (repeatRun.count == 0) {
+      if (freeRun == dscRepeatRunSize) freeRun = run;
+      continue;
+    }
+
+    if (repeatRun.command == command) {
+      if (repeated) {
+        repeatRun.count++;
+        repeatRun.lastTime = currentTime;
+        if (repeatRun.count < 0xFF) return;
+      }
+      publishRepeat(repeatRun.command, repeatRun.count, repeatRun.firstTime, repeatRun.lastTime);
+      repeatRun.count = 0;
+      return;
+    }
+
+    if (currentTime - repeatRun.lastTime > currentTime - repeatRuns[oldestRun].lastTime || repeatRuns[oldestRun].count == 0) oldestRun = run;
+  }
+  if (!repeated) return;
+
+  if (freeRun == dscRepeatRunSize) {
+    freeRun = oldestRun;
+    publishRepeat(repeatRuns[freeRun].command, repeatRuns[freeRun].count, repeatRuns[freeRun].firstTime, repeatRuns[freeRun].lastTime);
+  }
+  repeatRuns[freeRun].command = command;
+  repeatRuns[freeRun].count = 1;
+  repeatRuns[freeRun].firstTime = currentTime;
+  repeatRuns[freeRun].lastTime = currentTime;
+}
+
+
+void dscKeybusInterface::publishRepeat(byte command, byte count, unsigned long firstTime, unsigned long lastTime) {
+  panelRepeat.command = command;
+  panelRepeat.count = count;
+  panelRepeat.firstTime = firstTime;
+  panelRepeat.lastTime = lastTime;
+  repeatChanged = true;
+}
+
+
 // Sets up writes if multiple keys are sent as a char array
 void dscKeybusInterface::write(const char * receivedKeys) {
   writeKeysArray = receivedKeys;
   if (writeKeysArray[0] != '\0') writeKeysPending = true;
-  stream->println("Entering Write");
   writeKeys(writeKeysArray);
 }
 
 
+bool dscKeybusInterface::writePending() {
+  return writeKeysPending;
+}
+
+
 // Writes multiple keys from a char array
 void dscKeybusInterface::writeKeys(const char * writeKeysArray) {
   static byte writeCounter = 0;
@@ -210,42 +703,22 @@ void dscKeybusInterface::writeKeys(const char * writeKeysArray) {
 
 // Specifies the key value to be written by dscClockInterrupt() and selects the write partition.  This includes a 500ms
 // delay after alarm keys to resolve errors when additional keys are sent immediately after alarm keys.
+//
+// Writes are paced by the Keybus: dscDataInterrupt() reads back the key from the data line as it is written,
+// writes the key again if it does not match (a keypad or module writing at the same time), and sets writeReady
+// after the following command so the panel reads the key as released before the next key.
 void dscKeybusInterface::write(const char receivedKey) {
   static unsigned long previousTime;
 
 
   // Sets the binary to write for virtual keypad keys
   if (writeReady && millis() - previousTime > 500) {
-    bool validKey = true;
-
-    switch (receivedKey) {
-      case '0': writeKey = 0xCF; break;
-      case '1': writeKey = 0xDD; break;
-      case '2': writeKey = 0xBD; break;
-      case '3': writeKey = 0x7D; break;
-      case '4': writeKey = 0xDB; break;
-      case '5': writeKey = 0xBB; break;
-      case '6': writeKey = 0x7B; break;
-      case '7': writeKey = 0xD7; break;
-      case '8': writeKey = 0xB7; break;
-      case '9': writeKey = 0x77; break;
-      case 'r':
-      case 'R': writeKey = 0xAF; break; //READ
-      case 'a':
-      case 'A': writeKey = 0x6F; break; //ADDRESS
-      case '#': writeKey = 0xEF; writeCmd = true; break; //ENTER
-      case 'b':
-      case 'B': writeKey = 0xF7; writeCmd = true; break; //BYPASS
-      case 'h':
-      case 'H': writeKey = 0xFD; writeCmd = true; break; //HOME
-      case 'c':
-      case 'C': writeKey = 0xFB; writeCmd = true; break; //CODE
-      default: {
-        validKey = false;
-        break;
-      }
-
-
+    byte keyCode;
+    bool validKey = dscPanelProfile::keyCode(receivedKey, keyCode);
+    if (validKey) {
+      writeKey = keyCode;
+      writeCmd = dscPanelProfile::commandKey(receivedKey);
+      writeAlarm = dscPanelProfile::alarmKey(receivedKey);
     }
 
     // Sets the writing position in dscClockInterrupt() for the currently set partition
@@ -255,7 +728,12 @@ void dscKeybusInterface::write(const char receivedKey) {
     writeBit = 1;
 
     if (writeAlarm) previousTime = millis();  // Sets a marker to time writes after keypad alarm keys
-    if (validKey) writeReady = false;         // Sets a flag indicating that a write is pending, cleared by dscClockInterrupt()
+    if (validKey) {
+      writeKeyCommand = writeCmd;
+      writeRetryCount = 0;
+      writeStartTime = millis();
+      writeReady = false;  // Sets a flag indicating that a write is pending, cleared by dscDataInterrupt() when the key is read back
+    }
   }
 }
 
@@ -276,8 +754,94 @@ bool dscKeybusInterface::redundantPanelData(byte previousCmd[], volatile byte cu
 }
 
 
+// Calculates link quality for the last second.  The disconnect time is learned from the longest interval
+// between commands in each second, averaged to follow gradual changes in the Keybus timing.
+void dscKeybusInterface::processLinkQuality() {
+  noInterrupts();
+  unsigned int frameCount = isrFrameCount;
+  unsigned int incompleteCount = isrIncompleteCount;
+  unsigned long maxFrameInterval = isrFrameInterval;
+  isrFrameCount = 0;
+  isrIncompleteCount = 0;
+  isrFrameInterval = 0;
+  interrupts();
+
+  unsigned long elapsedTime = millis() - linkQualityTime;
+  linkQualityTime = millis();
+  if (elapsedTime > 0 && elapsedTime < 2000) framesPerSecond = (frameCount * 1000UL) / elapsedTime;
+  else framesPerSecond = 0;
+
+  if (frameCount > 0) {
+    incompletePercent = (incompleteCount * 100UL) / frameCount;
+    errorPercent = (linkErrorCount * 100UL) / frameCount;
+    if (errorPercent > 100) errorPercent = 100;
+  }
+  else {
+    incompletePercent = 0;
+    errorPercent = 0;
+  }
+  linkErrorCount = 0;
+
+  // Skips intervals in a second that started while disconnected, which include the time without Keybus data
+  if (maxFrameInterval > 0 && linkConnected) {
+    if (frameInterval == 0) frameInterval = maxFrameInterval;
+    else frameInterval = ((frameInterval * 3) + maxFrameInterval) / 4;
+  }
+
+  if (keybusTimeoutMultiple == 0 || frameInterval == 0) keybusTimeout = dscKeybusTimeout;
+  else {
+    keybusTimeout = frameInterval * keybusTimeoutMultiple;
+    if (keybusTimeout < dscKeybusMinTimeout) keybusTimeout = dscKeybusMinTimeout;
+    if (keybusTimeout > dscKeybusTimeout) keybusTimeout = dscKeybusTimeout;
+  }
+
+  linkConnected = keybusConnected;
+}
+
+
+unsigned long dscKeybusInterface::commandAge(byte command) {
+  for (byte entry = 0; entry < ageCommandCount; entry++) {
+    if (ageCommands[entry] == command) return millis() - ageTimes[entry];
+  }
+  return 0xFFFFFFFF;
+}
+
+
+// Records the time a command was seen for commandAge(), replacing the least recently seen command if the table is full
+void dscKeybusInterface::trackCommandAge(byte command) {
+  unsigned long currentTime = millis();
+  byte entry = 0;
+  while (entry < ageCommandCount && ageCommands[entry] != command) entry++;
+  if (entry == ageCommandCount) {
+    if (ageCommandCount < dscCommandAgeSize) ageCommandCount++;
+    else {
+      entry = 0;
+      for (byte i = 1; i < dscCommandAgeSize; i++) {
+        if (currentTime - ageTimes[i] > currentTime - ageTimes[entry]) entry = i;
+      }
+    }
+    ageCommands[entry] = command;
+  }
+  ageTimes[entry] = currentTime;
+}
+
+
+// Number of panel data bytes stored in the buffer: complete bytes including the stop bit byte, and the byte with
+// trailing bits read as the clock is reset
+#if defined(__AVR__)
+byte dscKeybusInterface::panelDataLength(byte bitCount, byte byteCount) {
+#elif defined(ESP8266)
+byte ICACHE_RAM_ATTR dscKeybusInterface::panelDataLength(byte bitCount, byte byteCount) {
+#else
+byte dscKeybusInterface::panelDataLength(byte bitCount, byte byteCount) {
+#endif
+  if (byteCount < dscReadSize && bitCount > 0 && (bitCount - 1) % 8 > 0) byteCount++;
+  return byteCount;
+}
+
+
 bool dscKeybusInterface::validCRC() {
-  return panelBitCount >= 24;
+  return dscPanelProfile::validCRC(panelData, panelBitCount);
 }
 
 
@@ -287,8 +851,26 @@ bool dscKeybusInterface::validCRC() {
 void dscKeybusInterface::dscClockInterrupt() {
 #elif defined(ESP8266)
 void ICACHE_RAM_ATTR dscKeybusInterface::dscClockInterrupt() {
+#else
+void dscKeybusInterface::dscClockInterrupt() {
 #endif
 
+  // Ignores edges from ringing on long Keybus cables - the clock changes every 500us, so an edge shortly after
+  // the previous edge is a glitch and re-arming the timer would read the data line at the wrong time
+  clockInterrupts++;
+  unsigned long edgeTime = micros();
+  bool clockHigh = digitalRead(dscClockPin) == HIGH;
+  if (clockGlitchTime) {
+    static unsigned long previousEdgeTime;
+    if (edgeTime - previousEdgeTime < clockGlitchTime) {
+      filteredEdges++;
+      if (dscISRTrace) traceISR(dscTraceGlitch, isrPanelBitTotal, clockHigh);
+      return;
+    }
+    previousEdgeTime = edgeTime;
+    isrClockHigh = clockHigh;
+  }
+
   // Data sent from the panel and keypads/modules has latency after a clock change (observed up to 160us for keypad data).
   // The following sets up a timer for both Arduino/AVR and Arduino/esp8266 that will call dscDataInterrupt() in
   // 250us to read the data line.
@@ -300,30 +882,32 @@ void ICACHE_RAM_ATTR dscKeybusInterface::dscClockInterrupt() {
 
   // esp8266 timer1 calls dscDataInterrupt() directly as set in begin()
   #elif defined(ESP8266)
+  if (clockRecovery && recoveryStarted) {
+    timer1_enable(TIM_DIV16, TIM_EDGE, TIM_SINGLE);  // Restarts the one-shot timer after clock recovery stopped the timer
+    recoveryStarted = false;
+  }
   timer1_write(1250);
   #endif
 
 
-  static unsigned long previousClockHighTime;
-  if (digitalRead(dscClockPin) == HIGH) {
+  if (clockHigh) {
     if (virtualKeypad) digitalWrite(dscWritePin, LOW);  // Restores the data line after a virtual keypad write
-    previousClockHighTime = micros();
+    clockRiseTime = edgeTime;
   }
 
   else {
-    clockHighTime = micros() - previousClockHighTime;  // Tracks the clock high time to find the reset between commands
+    clockHighTime = edgeTime - clockRiseTime;  // Tracks the clock high time to find the reset between commands
 
     // Virtual keypad
     if (virtualKeypad) {
+      byte isrPanelBitTotal = rawBitMode ? isrRawBitTotal : dscKeybusInterface::isrPanelBitTotal;  // Panel bits in the current command
       static unsigned long previousTime;
-      static bool setWriteReady = false;
       static bool writeStart = false;
       static bool isCommand = false;
-      static bool writeRepeat = false;
       static char originalKey;
       // Writes a F/A/P alarm key and repeats the key on the next immediate command from the panel (0x1C verification)
       //if (writeAlarm && !writeReady) {
-      if ((!writeReady && !setWriteReady) || writeRepeat) {
+      if (((!writeReady && !writeVerify && !writeRelease) || writeRepeat) && dscPanelProfile::writeCommand(statusCmd)) {
 
         isCommand = writeCmd;//writeKey == 0xEF || writeKey == 0xF7 || writeKey == 0xFD;
         //isCommand = writeCmd;
@@ -335,45 +919,92 @@ void ICACHE_RAM_ATTR dscKeybusInterface::dscClockInterrupt() {
           }
         }
         // Writes the first bit by shifting the alarm key data right 7 bits and checking bit 0
-        if (isrPanelBitTotal == 1) {
+        if (isrPanelBitTotal == dscPanelProfile::writeStartBit) {
           if (!((writeKey >> 7) & 0x01)) {
             digitalWrite(dscWritePin, HIGH);
           }
           writeStart = true;  // Resolves a timing issue where some writes do not begin at the correct bit
+          if (dscISRTrace) traceISR(dscTraceWriteStart, isrPanelBitTotal, writeKey);
         }
 
         // Writes the remaining alarm key data
-        else if (writeStart && isrPanelBitTotal > 1 && isrPanelBitTotal <= 8) {
-          if (!((writeKey >> (8 - isrPanelBitTotal)) & 0x01)) digitalWrite(dscWritePin, HIGH);
+        else if (writeStart && isrPanelBitTotal > dscPanelProfile::writeStartBit && isrPanelBitTotal <= dscPanelProfile::writeStartBit + 7) {
+          if (!((writeKey >> (dscPanelProfile::writeStartBit + 7 - isrPanelBitTotal)) & 0x01)) digitalWrite(dscWritePin, HIGH);
         }
-        else if(writeStart && isrPanelBitTotal == 24) {
-          if(isCommand || writeKey == 0xFF) digitalWrite(dscWritePin, HIGH);
+        else if(writeStart && isrPanelBitTotal == dscPanelProfile::writeEndBit) {
+          if(isCommand || (byte)writeKey == 0xFF) digitalWrite(dscWritePin, HIGH);
           writeStart = false;
           previousTime = millis();
           if (writeRepeat)
           {
             writeRepeat = false;
-            setWriteReady = true;
+            writeVerify = true;
           }
-          else if(isCommand || writeKey == 0xFF){
+          else if(isCommand || (byte)writeKey == 0xFF){
               writeRepeat = true;
               writeKey = originalKey;
             }
           else
           {
-              setWriteReady = true;
+              writeVerify = true;
           }
+          if (dscISRTrace) traceISR(dscTraceWriteEnd, isrPanelBitTotal, writeVerify | (writeRepeat << 1));
         }
       }
 
-      if(setWriteReady && (millis() - previousTime) > 300){
+      // Releases the write if the Keybus stops before the key is read back
+      if (writeVerify && (millis() - previousTime) > 300) {
+        writeVerify = false;
         writeReady = true;
-        previousTime = millis();
-        setWriteReady = false;
+        if (dscISRTrace) traceISR(dscTraceWriteTimeout, isrPanelBitTotal);
       }
 
     }
   }
+
+  // Clock recovery: measures the clock period over the edges after the reset between commands, then disables the
+  // clock interrupt - dscDataInterrupt() samples with a periodic timer from the timer set by this edge
+  if (clockRecovery) {
+    static unsigned long previousEdgeTime;
+
+    // Restarts the measurement at the reset between commands and after an idle clock
+    if ((!clockHigh && clockHighTime > 1000) || (recoveryEdges > 0 && edgeTime - previousEdgeTime > 1000)) {
+      recoveryEdges = 1;
+      recoveryStartTime = edgeTime;
+    }
+    else if (recoveryEdges > 0 && ++recoveryEdges > dscRecoveryEdges) {
+      recoveryEdges = 0;
+
+      // Averages the measurements of each command, the clock period is fixed and the edge times have interrupt latency
+      unsigned long period = ((edgeTime - recoveryStartTime) << 4) / dscRecoveryEdges;
+      if (recoveryPeriod == 0) recoveryPeriod = period;
+      else if (period > recoveryPeriod - (recoveryPeriod >> 3) && period < recoveryPeriod + (recoveryPeriod >> 3)) {
+        recoveryPeriod = recoveryPeriod - (recoveryPeriod >> 3) + (period >> 3);
+      }
+      recoveryExpectHigh = clockHigh;
+      recoveryLocked = true;
+      setClockInterrupt(false);
+    }
+    previousEdgeTime = edgeTime;
+  }
+}
+
+
+// Enables or disables the clock interrupt without detaching dscClockInterrupt(), used from the interrupts
+#if defined(__AVR__)
+void dscKeybusInterface::setClockInterrupt(bool) {
+#elif defined(ESP8266)
+void ICACHE_RAM_ATTR dscKeybusInterface::setClockInterrupt(bool enabled) {
+#else
+void dscKeybusInterface::setClockInterrupt(bool) {
+#endif
+  #if defined(ESP8266)
+  if (enabled) {
+    GPIEC = (1 << dscClockPin);  // Clears edges while the interrupt was disabled
+    GPC(dscClockPin) |= ((CHANGE & 0x0F) << GPCI);
+  }
+  else GPC(dscClockPin) &= ~(0x0F << GPCI);
+  #endif
 }
 
 
@@ -392,12 +1023,290 @@ ISR(TIMER1_OVF_vect) {
 void dscKeybusInterface::dscDataInterrupt() {
 #elif defined(ESP8266)
 void ICACHE_RAM_ATTR dscKeybusInterface::dscDataInterrupt() {
+#else
+void dscKeybusInterface::dscDataInterrupt() {
+#endif
+
+  unsigned long isrStartTime = 0;
+  if (dscMeasureISR) {
+    #if defined(ESP8266)
+    isrStartTime = ESP.getCycleCount();
+    #else
+    isrStartTime = micros();
+    #endif
+  }
+
+  dataInterrupts++;
+  bool clockHigh = digitalRead(dscClockPin) == HIGH;
+
+  // Clock recovery: the first sample after the clock period is measured starts the periodic timer, the following
+  // samples check that the clock alternates.  A missed level is the reset between commands (or a lost lock), the
+  // timer is stopped and the clock interrupt waits for the next command.
+  #if defined(ESP8266)
+  if (recoveryLocked) {
+    if (!recoveryStarted) {
+      timer1_enable(TIM_DIV16, TIM_EDGE, TIM_LOOP);
+      timer1_write((recoveryPeriod * 5) >> 4);
+      recoveryStarted = true;
+    }
+
+    if (clockHigh != recoveryExpectHigh) {
+      timer1_disable();
+      recoveryLocked = false;
+      clockRiseTime = micros() - 250 - (recoveryPeriod >> 4);  // The clock rose before the previous sample
+      setClockInterrupt(true);
+      return;
+    }
+    recoveryExpectHigh = !clockHigh;
+    isrClockHigh = clockHigh;
+  }
+  #endif
+
+  // Skips the sample if the clock returned to the previous level after a glitch
+  if (clockGlitchTime && clockHigh != isrClockHigh) {
+    filteredEdges++;
+    if (dscISRTrace) traceISR(dscTraceGlitch, isrPanelBitTotal, clockHigh);
+    return;
+  }
+
+  bool dataBit;
+  if (majorityVote) {
+    byte highSamples = (digitalRead(dscReadPin) == HIGH) + (digitalRead(dscReadPin) == HIGH) + (digitalRead(dscReadPin) == HIGH);
+    dataBit = highSamples >= 2;
+    if (highSamples == 1 || highSamples == 2) disputedBits++;
+  }
+  else dataBit = digitalRead(dscReadPin) == HIGH;
+
+  bool frameEnd = !clockHigh && clockHighTime > 1000;  // Clock cycle is complete (high for at least 1ms)
+  if (frameEnd) {
+    unsigned long frameTime = millis();
+    unsigned long frameInterval = frameTime - keybusTime;
+    if (frameInterval < dscKeybusTimeout && frameInterval > isrFrameInterval) isrFrameInterval = frameInterval;
+    keybusTime = frameTime;
+    isrFrameCount++;
+  }
+
+  // Reads back the key written by dscClockInterrupt(), the line is pulled low for 0 bits
+  if (!writeReady) {
+    byte panelBitTotal = rawBitMode ? isrRawBitTotal : isrPanelBitTotal;
+    if (!clockHigh && panelBitTotal >= dscPanelProfile::writeStartBit && panelBitTotal <= dscPanelProfile::writeStartBit + 7) isrWriteEcho = (isrWriteEcho << 1) | dataBit;
+
+    if (frameEnd) {
+      if (dscISRTrace) traceISR(dscTraceFrameEnd, panelBitTotal, isrWriteEcho);
+
+      // Sets writeReady after the command following the key, so the key is released before the next key
+      if (writeRelease) {
+        writeRelease = false;
+        writeReady = true;
+        if (dscISRTrace) traceISR(dscTraceWriteReady, panelBitTotal);
+      }
+
+      else if (writeVerify) {
+        writeVerify = false;
+        if (isrWriteEcho == (byte)writeKey) {
+          writeLatency = millis() - writeStartTime;
+          writeRelease = true;
+          if (dscISRTrace) traceISR(dscTraceEchoMatch, panelBitTotal, isrWriteEcho);
+        }
+
+        // Writes the key again on the next command, command keys repeat only the key after the 0xFF prefix
+        else if (writeRetryCount < dscWriteRetries) {
+          writeRetryCount++;
+          writeRetries++;
+          writeRepeat = writeKeyCommand;
+          if (dscISRTrace) traceISR(dscTraceEchoRetry, panelBitTotal, isrWriteEcho);
+        }
+        else {
+          writeFailures++;
+          writeRelease = true;
+          if (dscISRTrace) traceISR(dscTraceEchoFailure, panelBitTotal, isrWriteEcho);
+        }
+      }
+    }
+  }
+
+  // Stores the sample for handlePanel() to decode
+  if (rawBitMode) {
+    byte sample = 0x08 | dataBit;
+    if (clockHigh) {
+      sample |= 0x02;
+      if (isrRawBitTotal < 0xFF) isrRawBitTotal++;
+
+      // Reads the command byte for key writes, processDataBit() runs later from handlePanel() in rawBitMode
+      if (isrRawBitTotal <= 8) {
+        isrRawCommand = (isrRawCommand << 1) | dataBit;
+        if (isrRawBitTotal == 8) statusCmd = statusCommand(isrRawCommand);
+      }
+    }
+    else if (frameEnd) {
+      sample |= 0x04;
+      isrRawBitTotal = 0;
+    }
+
+    isrRawWord |= (unsigned long)sample << isrRawShift;
+    isrRawShift += 4;
+
+    // Stores complete words, and the partial word at the end of a command so it can be decoded without waiting
+    if (isrRawShift == 32 || frameEnd) {
+      byte nextIndex = rawBufferHead + 1;
+      if (nextIndex >= dscRawBufferSize) nextIndex = 0;
+
+      if (nextIndex == rawBufferTail) {
+        bufferOverflow = true;
+        rawBufferGap = true;
+        if (dscISRTrace) traceISR(dscTraceOverflow, isrRawBitTotal);
+      }
+      else {
+        // Replaces the first word after an overflow with a marker to discard the incomplete command
+        rawBuffer[rawBufferHead] = rawBufferGap ? dscRawGap : isrRawWord;
+        rawBufferGap = false;
+        rawBufferHead = nextIndex;
+      }
+      isrRawWord = 0;
+      isrRawShift = 0;
+    }
+  }
+
+  else processDataBit(clockHigh, dataBit, frameEnd);
+
+  if (dscMeasureISR) {
+    #if defined(ESP8266)
+    unsigned long isrTime = ESP.getCycleCount() - isrStartTime;
+    #else
+    unsigned long isrTime = micros() - isrStartTime;
+    #endif
+    if (isrTime > isrMaxTime) isrMaxTime = isrTime;
+  }
+}
+
+
+// Decodes the samples stored by dscDataInterrupt() in rawBitMode into panel and module data.  Each sample is
+// 4 bits: bit 0: data, bit 1: clock high, bit 2: end of command, bit 3: valid sample
+void dscKeybusInterface::processRawBits() {
+  static bool discardCommand = false;
+
+  byte bufferHead = rawBufferHead;
+  while (rawBufferTail != bufferHead) {
+    unsigned long rawWord = rawBuffer[rawBufferTail];
+    byte nextIndex = rawBufferTail + 1;
+    if (nextIndex >= dscRawBufferSize) nextIndex = 0;
+    rawBufferTail = nextIndex;
+
+    if (rawWord == dscRawGap) {
+      discardCommand = true;
+      continue;
+    }
+
+    for (byte shift = 0; shift < 32; shift += 4) {
+      byte sample = (rawWord >> shift) & 0x0F;
+      if (!(sample & 0x08)) break;
+
+      bool frameEnd = sample & 0x04;
+      if (discardCommand) {
+        if (!frameEnd) continue;
+
+        // Resets the capture data without storing the incomplete command
+        isrPanelBitTotal = 0;
+        discardCommand = false;
+      }
+      processDataBit(sample & 0x02, sample & 0x01, frameEnd);
+    }
+  }
+}
+
+
+// Stores a record in the panel buffer lane for the priority class: bit count, byte count, priority sequence if
+// dscPriorityLanes is enabled, micros() if dscLatencyTrace is enabled, and data.  High priority records are buffered
+// in the low priority lane if the high priority lane is full, and the oldest low priority records are evicted if
+// the low priority lane is full.  Returns false if the buffer is full.
+#if defined(__AVR__)
+bool dscKeybusInterface::bufferPanelData(byte bitCount, byte byteCount, const volatile byte * data, byte priority) {
+#elif defined(ESP8266)
+bool ICACHE_RAM_ATTR dscKeybusInterface::bufferPanelData(byte bitCount, byte byteCount, const volatile byte * data, byte priority) {
+#else
+bool dscKeybusInterface::bufferPanelData(byte bitCount, byte byteCount, const volatile byte * data, byte priority) {
+#endif
+  byte dataLength = panelDataLength(bitCount, byteCount);
+  unsigned int recordSize = dataLength + dscRecordHeaderSize;
+  if (!dscPriorityLanes) priority = dscPriorityLow;
+  else if (priority == dscPriorityHigh && (panelBufferUsed[priority] + recordSize > dscPriorityBufferSize || panelBufferLength[priority] == 0xFF)) {
+    droppedCommands[priority]++;
+    priority = dscPriorityLow;  // Read after the buffered status changes, and skipped if a later status change is read first
+  }
+  volatile byte * laneBuffer = priority == dscPriorityHigh ? &panelBuffer[dscBufferSize] : panelBuffer;
+  unsigned int laneSize = priority == dscPriorityHigh ? dscPriorityBufferSize : dscBufferSize;
+
+  // Evicts the oldest low priority records, except a record being read by handlePanel()
+  if (dscPriorityLanes && priority == dscPriorityLow && !panelBufferReading) {
+    while (panelBufferLength[priority] > 0 && (panelBufferUsed[priority] + recordSize > dscBufferSize || panelBufferLength[priority] == 0xFF)) {
+      unsigned int bufferIndex = panelBufferTail[priority];
+      byte evictBitCount = panelBuffer[bufferIndex];
+      if (++bufferIndex >= dscBufferSize) bufferIndex = 0;
+      unsigned int evictSize = panelDataLength(evictBitCount, panelBuffer[bufferIndex]) + dscRecordHeaderSize;
+      bufferIndex = panelBufferTail[priority] + evictSize;
+      if (bufferIndex >= dscBufferSize) bufferIndex -= dscBufferSize;
+      panelBufferTail[priority] = bufferIndex;
+      panelBufferUsed[priority] -= evictSize;
+      panelBufferLength[priority]--;
+      droppedCommands[priority]++;
+      bufferOverflow = true;
+      if (dscISRTrace) traceISR(dscTraceOverflow, evictBitCount);
+    }
+  }
+
+  if (panelBufferUsed[priority] + recordSize > laneSize || panelBufferLength[priority] == 0xFF) {
+    droppedCommands[priority]++;
+    bufferOverflow = true;
+    if (dscISRTrace) traceISR(dscTraceOverflow, bitCount);
+    return false;
+  }
+
+  // High priority records are numbered, low priority records have the number of the last high priority record
+  if (priority == dscPriorityHigh) isrPrioritySequence++;
+
+  unsigned int bufferIndex = panelBufferHead[priority];
+  laneBuffer[bufferIndex] = bitCount;
+  if (++bufferIndex >= laneSize) bufferIndex = 0;
+  laneBuffer[bufferIndex] = byteCount;
+  if (++bufferIndex >= laneSize) bufferIndex = 0;
+  if (dscPriorityLanes) {
+    laneBuffer[bufferIndex] = isrPrioritySequence;
+    if (++bufferIndex >= laneSize) bufferIndex = 0;
+  }
+  if (dscLatencyTrace) {
+    unsigned long frameTime = micros();  // In rawBitMode, the time the command is decoded in handlePanel()
+    for (byte i = 0; i < 4; i++) {
+      laneBuffer[bufferIndex] = frameTime >> (i * 8);
+      if (++bufferIndex >= laneSize) bufferIndex = 0;
+    }
+  }
+  for (byte i = 0; i < dataLength; i++) {
+    laneBuffer[bufferIndex] = data[i];
+    if (++bufferIndex >= laneSize) bufferIndex = 0;
+  }
+  panelBufferHead[priority] = bufferIndex;
+  panelBufferUsed[priority] += recordSize;
+  unsigned int bufferUsed = panelBufferUsed[dscPriorityLow] + panelBufferUsed[dscPriorityHigh];
+  if (bufferUsed > bufferPeak) bufferPeak = bufferUsed;
+  panelBufferLength[priority]++;
+  return true;
+}
+
+
+// Assembles panel and keypad/module data bits into bytes and stores complete commands in the panel buffer,
+// called by dscDataInterrupt() or by processRawBits() in rawBitMode
+#if defined(__AVR__)
+void dscKeybusInterface::processDataBit(bool clockHigh, bool dataBit, bool frameEnd) {
+#elif defined(ESP8266)
+void ICACHE_RAM_ATTR dscKeybusInterface::processDataBit(bool clockHigh, bool dataBit, bool frameEnd) {
+#else
+void dscKeybusInterface::processDataBit(bool clockHigh, bool dataBit, bool frameEnd) {
 #endif
 
   static bool skipData = false;
 
   // Panel sends data while the clock is high
-  if (digitalRead(dscClockPin) == HIGH) {
+  if (clockHigh) {
 
     // Stops processing Keybus data at the dscReadSize limit
     if (isrPanelByteCount >= dscReadSize) skipData = true;
@@ -406,19 +1315,14 @@ void ICACHE_RAM_ATTR dscKeybusInterface::dscDataInterrupt() {
       if (isrPanelBitCount < 8) {
         // Data is captured in each byte by shifting left by 1 bit and writing to bit 0
         isrPanelData[isrPanelByteCount] <<= 1;
-        if (digitalRead(dscReadPin) == HIGH) {
+        if (dataBit) {
           isrPanelData[isrPanelByteCount] |= 1;
         }
       }
 
       if (isrPanelBitTotal == 8) {
         // Tests for a status command, used in dscClockInterrupt() to ensure keys are only written during a status command
-        switch (isrPanelData[0]) {
-          case 0x05:
-          case 0x0A: statusCmd = 0x05; break;
-          case 0x1B: statusCmd = 0x1B; break;
-          default: statusCmd = 0; break;
-        }
+        if (!rawBitMode) statusCmd = statusCommand(isrPanelData[0]);
 
         // Stores the stop bit by itself in byte 1 - this aligns the Keybus bytes with panelData[] bytes
         isrPanelBitCount = 0;
@@ -445,12 +1349,12 @@ void ICACHE_RAM_ATTR dscKeybusInterface::dscDataInterrupt() {
     static bool moduleDataDetected = false;
 
     // Keypad and module data is not buffered and skipped if the panel data buffer is filling
-    if (processModuleData && isrModuleByteCount < dscReadSize && panelBufferLength <= 1) {
+    if (processModuleData && isrModuleByteCount < dscReadSize && panelBufferLength[dscPriorityLow] + panelBufferLength[dscPriorityHigh] <= 1) {
 
       // Data is captured in each byte by shifting left by 1 bit and writing to bit 0
       if (isrModuleBitCount < 8) {
         isrModuleData[isrModuleByteCount] <<= 1;
-        if (digitalRead(dscReadPin) == HIGH) {
+        if (dataBit) {
           isrModuleData[isrModuleByteCount] |= 1;
         }
         else moduleDataDetected = true;  // Keypads and modules send data by pulling the data line low
@@ -477,33 +1381,62 @@ void ICACHE_RAM_ATTR dscKeybusInterface::dscDataInterrupt() {
       isrModuleBitTotal++;
     }
 
-    // Saves data and resets counters after the clock cycle is complete (high for at least 1ms)
-    if (clockHighTime > 1000) {
-      keybusTime = millis();
+    // Saves data and resets counters after the clock cycle is complete
+    if (frameEnd) {
 
       // Skips incomplete and redundant data from status commands - these are sent constantly on the keybus at a high
       // rate, so they are always skipped.  Checking is required in the ISR to prevent flooding the buffer.
-      if (isrPanelBitTotal < 8) skipData = true;
+      byte repeatIndex = 2;
+      bool repeated = false;
+      if (isrPanelBitTotal < 8) {
+        skipData = true;
+        isrIncompleteCount++;
+      }
       else switch (isrPanelData[0]) {
         static byte previousCmd05[dscReadSize];
         static byte previousCmd1B[dscReadSize];
         case 0x05:  // Status: partitions 1-4
-          if (redundantPanelData(previousCmd05, isrPanelData, isrPanelByteCount)) skipData = true;
+          repeated = redundantPanelData(previousCmd05, isrPanelData, isrPanelByteCount);
+          repeatIndex = 0;
           break;
 
         case 0x1B:  // Status: partitions 5-8
-          if (redundantPanelData(previousCmd1B, isrPanelData, isrPanelByteCount)) skipData = true;
+          repeated = redundantPanelData(previousCmd1B, isrPanelData, isrPanelByteCount);
+          repeatIndex = 1;
           break;
       }
 
-      // Stores new panel data in the panel buffer
+      // Counts skipped status commands as a run of repeats, and buffers the run before the changed command or
+      // when the count is full
+      if (repeatIndex < 2) {
+        static byte repeatCount[2];
+        static unsigned long repeatFirstTime[2], repeatLastTime[2];
+        if (repeated) {
+          skipData = true;
+          unsigned long frameTime = millis();  // In rawBitMode, the time the command is decoded in handlePanel()
+          if (repeatCount[repeatIndex] == 0) repeatFirstTime[repeatIndex] = frameTime;
+          repeatLastTime[repeatIndex] = frameTime;
+          if (repeatCount[repeatIndex] < 0xFF) repeatCount[repeatIndex]++;
+        }
+
+        if (repeatCount[repeatIndex] > 0 && (!repeated || repeatCount[repeatIndex] == 0xFF)) {
+          byte repeatRecord[dscRepeatRecordSize];
+          repeatRecord[0] = isrPanelData[0];
+          repeatRecord[1] = repeatCount[repeatIndex];
+          for (byte i = 0; i < 4; i++) {
+            repeatRecord[2 + i] = repeatFirstTime[repeatIndex] >> (i * 8);
+            repeatRecord[6 + i] = repeatLastTime[repeatIndex] >> (i * 8);
+          }
+          if (bufferPanelData(0, dscRepeatRecordSize, repeatRecord, dscPriorityLow) || !repeated) repeatCount[repeatIndex] = 0;
+        }
+      }
+
+      // Stores new panel data in the panel buffer, commands with status changes in the high priority lane
       currentCmd = isrPanelData[0];
-      if (panelBufferLength == dscBufferSize) bufferOverflow = true;
-      else if (!skipData && panelBufferLength < dscBufferSize) {
-        for (byte i = 0; i < dscReadSize; i++) panelBuffer[panelBufferLength][i] = isrPanelData[i];
-        panelBufferBitCount[panelBufferLength] = isrPanelBitTotal;
-        panelBufferByteCount[panelBufferLength] = isrPanelByteCount;
-        panelBufferLength++;
+      if (!skipData) {
+        static byte priorityStatus[dscPanelProfile::priorityStatusSize];
+        bool statusChange = dscPriorityLanes && dscPanelProfile::statusChange((const byte *)isrPanelData, isrPanelBitTotal, priorityStatus);
+        bufferPanelData(isrPanelBitTotal, isrPanelByteCount, isrPanelData, statusChange ? dscPriorityHigh : dscPriorityLow);
       }
 
       // Resets the panel capture data and counters
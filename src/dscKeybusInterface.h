@@ -3,19 +3,153 @@
 #define dscKeybusInterface_h
 
 #include <Arduino.h>
+#include "dscKeybusStateStorage.h"
+#include "dscKeybusEventLog.h"
+#include "dscKeybusOutbox.h"
+#include "dscKeybusPanelProfile.h"
+#include "dscKeybusScheduler.h"
 
 
 #if defined(__AVR__)
 const byte dscPartitions = 1;   // Maximum number of partitions - requires 19 bytes of memory per partition
 const byte dscZones = 1;        // Maximum number of zone groups, 8 zones per group - requires 6 bytes of memory per zone group
-const byte dscBufferSize = 10;  // Number of commands to buffer if the sketch is busy - requires dscReadSize + 2 bytes of memory per command
+const unsigned int dscBufferSize = 180;  // Bytes of memory to buffer commands if the sketch is busy - each command uses its length + 3 bytes (8 bytes for MC-08 status), + 4 bytes with dscLatencyTrace
+const unsigned int dscPriorityBufferSize = 40;  // Bytes of memory to buffer commands with status changes if dscPriorityLanes is enabled, same size per command as dscBufferSize
+const byte dscCommandHandlerSize = 4;  // Maximum number of sketch command handlers - requires 2 bytes of memory per handler
+const unsigned int dscCommandTableSize = 8;  // Number of command bytes with a sketch handler or status decoding disabled, 256 for a table of every command byte - requires 2 bytes of memory per command
+const byte dscRawBufferSize = 16;  // Number of 32-bit words to buffer in rawBitMode, 8 samples per word - requires 4 bytes of memory per word
+const byte dscTraceRingSize = 32;  // Number of ISR trace records if dscISRTrace is enabled, a power of 2 - requires 8 bytes of memory per record
+const byte dscRepeatRunSize = 2;   // Number of commands with repeats counted at the same time by handlePanel() - requires 10 bytes of memory per command
+const byte dscCommandAgeSize = 4;  // Number of command bytes tracked by commandAge(), the least recently seen is replaced - requires 5 bytes of memory per command
 #elif defined(ESP8266)
 const byte dscPartitions = 1;
 const byte dscZones = 1;
-const byte dscBufferSize = 50;
+const unsigned int dscBufferSize = 900;
+const unsigned int dscPriorityBufferSize = 160;
+const byte dscCommandHandlerSize = 16;
+const unsigned int dscCommandTableSize = 256;
+const byte dscRawBufferSize = 128;
+const byte dscTraceRingSize = 128;
+const byte dscRepeatRunSize = 8;
+const byte dscCommandAgeSize = 16;
+#else  // Host builds for testing
+const byte dscPartitions = 1;
+const byte dscZones = 1;
+const unsigned int dscBufferSize = 900;
+const unsigned int dscPriorityBufferSize = 160;
+const byte dscCommandHandlerSize = 16;
+const unsigned int dscCommandTableSize = 256;
+const byte dscRawBufferSize = 128;
+const byte dscTraceRingSize = 128;
+const byte dscRepeatRunSize = 8;
+const byte dscCommandAgeSize = 16;
 #endif
 
 const byte dscReadSize = 16;   // Maximum size of a Keybus command
+const unsigned long dscKeybusTimeout = 3000;  // Maximum time in milliseconds without Keybus data before the Keybus is disconnected
+const unsigned int dscKeybusMinTimeout = 100;  // Minimum learned disconnect time
+const byte dscWriteRetries = 2;  // Number of times a key is written again if it is not read back from the Keybus
+const byte dscRecoveryEdges = 8;  // Clock edges after the reset between commands used to measure the clock period in clockRecovery mode, an even number
+const bool dscMeasureISR = false;  // Records the longest dscDataInterrupt() time in isrMaxTime - CPU cycles on esp8266, microseconds on AVR
+const unsigned long dscRawGap = 0x0000000E;  // Raw buffer marker for samples dropped on overflow
+const bool dscLatencyTrace = false;  // Records latency histograms from command capture to publishing - adds 4 bytes per buffered command
+const bool dscPriorityLanes = false;  // Buffers commands with status changes in a separate lane read first by handlePanel() - adds 1 byte per buffered command
+
+const bool dscISRTrace = false;  // Records write and frame events from the interrupts for printTrace() - trace points are not built if disabled
+const bool dscZoneAnalytics = false;  // Records open counts and open times per zone for zoneActivity() - requires 14 bytes of memory per zone
+const byte dscActivityZones = dscZoneAnalytics ? dscZones * 8 : 1;
+
+// Latency tracing stages for latencyPercentile(), times in microseconds
+const byte dscLatencyQueue = 0;    // Command captured in dscDataInterrupt() to read from the buffer in handlePanel()
+const byte dscLatencyDecode = 1;   // Command read from the buffer to a status change decoded
+const byte dscLatencyPublish = 2;  // Status change decoded to tracePublished() called by the sketch
+const byte dscLatencyTotal = 3;    // Command captured to tracePublished()
+const byte dscLatencyStages = 4;
+const byte dscLatencyBuckets = dscLatencyTrace ? 24 : 1;  // Histogram buckets of 1, 2-3, 4-7... microseconds, up to 8s - requires 8 bytes of memory per bucket
+
+// Panel buffer priority classes, assigned by dscDataInterrupt() as each command is completed
+const byte dscPriorityHigh = 0;     // Commands with a zone, armed or trouble status change, never evicted
+const byte dscPriorityLow = 1;      // Other commands and runs of repeated status commands, the oldest are evicted for newer commands if the lane is full
+const byte dscPriorityClasses = 2;
+const byte dscPriorityBacklog = 4;  // Low priority commands buffered before handlePanel() reads status changes first
+const unsigned int dscPanelBufferSize = dscBufferSize + (dscPriorityLanes ? dscPriorityBufferSize : 0);
+
+// ISR trace events, the record bit is the panel bit of the current command
+const byte dscTraceGlitch = 0;        // Clock edge filtered, data: clock level
+const byte dscTraceWriteStart = 1;    // First key bit written, data: key
+const byte dscTraceWriteEnd = 2;      // Write end bit, data: bit 0 = verify, bit 1 = repeat
+const byte dscTraceWriteTimeout = 3;  // Key released without a read back
+const byte dscTraceFrameEnd = 4;      // Clock reset after a command, data: key read back
+const byte dscTraceEchoMatch = 5;     // Key read back, data: key read back
+const byte dscTraceEchoRetry = 6;     // Key not read back and written again, data: key read back
+const byte dscTraceEchoFailure = 7;   // Key not read back after dscWriteRetries, data: key read back
+const byte dscTraceWriteReady = 8;    // Ready for the next key
+const byte dscTraceOverflow = 9;      // Command dropped, the buffer is full
+const byte dscTraceRecordSize = dscISRTrace ? dscTraceRingSize : 1;
+
+struct dscTraceRecord {
+  unsigned long time;  // CPU cycles on esp8266, microseconds on AVR
+  byte event, bit, data;
+};
+
+// Run of repeated commands, times are millis() - repeats counted by handlePanel() are timed when read from the buffer
+struct dscRepeatRun {
+  byte command;
+  byte count;  // Repeats after the first command, not including the first command
+  unsigned long firstTime, lastTime;
+};
+const byte dscRepeatRecordSize = 10;  // Buffered size of a run counted by dscDataInterrupt()
+
+// Zone activity since the window was started by begin() or resetZoneActivity(), times in milliseconds
+struct dscZoneActivity {
+  unsigned int openCount;     // Times the zone opened, up to 65535
+  unsigned long openTime;     // Total time open, including the current open period
+  unsigned long longestOpen;  // Longest open period, including the current open period
+  unsigned long lastChange;   // millis() when the zone last opened or closed, kept across windows - 0 if not changed since begin()
+};
+
+// Signal numbers for setDebounce()
+const byte dscSignalTrouble = 0;
+const byte dscSignalPowerTrouble = 1;
+const byte dscSignalArmed = 2;                               // Add the partition number - 1
+const byte dscSignalZone = dscSignalArmed + dscPartitions;   // Add the zone number - 1
+const byte dscSignalCount = dscSignalZone + (dscZones * 8);  // Requires 12 bytes of memory per signal
+
+// Debounce signal groups, 8 signals per group
+const byte dscDebounceStatus = 0;  // Trouble, power trouble
+const byte dscDebounceArmed = 1;   // Armed per partition
+const byte dscDebounceZones = 2;   // Open zones per zone group
+const byte dscDebounceGroups = dscDebounceZones + dscZones;
+
+// Command table entries: bit 7 = decode status, bits 0-6 = sketch command handler number
+const byte dscCommandStatus = 0x80;
+const byte dscCommandHandlerMask = 0x7F;
+const bool dscSparseCommandTable = dscCommandTableSize < 256;  // Command entries are stored with their command byte instead of a table of every command byte
+
+// Sketch command handler, called with the panel data and number of bits read
+typedef void (*dscCommandHandler)(const byte * panelData, byte panelBitCount);
+const byte dscStateSize = 1 + dscPartitions + (dscZones * 2);  // Size of the saved state snapshot
+const byte dscDisplaySize = 8;                  // Maximum number of characters in a keypad display sequence
+const unsigned int dscDisplayPause = 1500;      // Time in milliseconds the display is blank or steady to end a sequence
+const byte dscDisplayFlashRatio = 4;            // A character that returns after a blank of at least 1/4 of the time it was shown is flashing, a shorter blank separates repeated characters
+
+#if defined(__AVR__)
+#define dscMemoryBarrier() asm volatile("" ::: "memory")  // Status is only read from the sketch loop() on AVR
+#else
+#define dscMemoryBarrier() __sync_synchronize()
+#endif
+
+// Status snapshot for getStatus() - requires 2x its size in memory
+struct dscStatus {
+  unsigned long version;  // Incremented each time the status changes
+  bool keybusConnected, accessCodePrompt, trouble, powerTrouble, batteryTrouble;
+  bool ready[dscPartitions], armed[dscPartitions], armedAway[dscPartitions], armedStay[dscPartitions];
+  bool noEntryDelay[dscPartitions], alarm[dscPartitions], exitDelay[dscPartitions], entryDelay[dscPartitions];
+  bool fire[dscPartitions];
+  byte openZones[dscZones], alarmZones[dscZones];
+  char displayText[dscDisplaySize + 1];
+  bool displayBlink;
+};
 
 
 class dscKeybusInterface {
@@ -26,17 +160,78 @@ class dscKeybusInterface {
     dscKeybusInterface(byte setClockPin, byte setReadPin, byte setWritePin = 255);
 
     void begin(Stream &_stream = Serial);             // Initializes the stream output to Serial by default
+    void stop();                                      // Disables the clock and data interrupts, begin() restarts the interface
+    void resetStatus();                               // Sets the status changed flags to republish the current status
     bool handlePanel();                               // Returns true if valid panel data is available
     bool handleModule();                              // Returns true if valid keypad or module data is available
     static volatile bool writeReady;                  // True if the library is ready to write a key
+    static volatile unsigned long writeLatency;       // Milliseconds from write() to the key read back from the Keybus, for the last key
+    static volatile unsigned int writeRetries, writeFailures;  // Keys written again, and keys not read back after dscWriteRetries
     void write(const char receivedKey);               // Writes a single key
-    void write(const char * receivedKeys);            // Writes multiple keys from a char array
+    void write(const char * receivedKeys);            // Writes multiple keys from a char array, which must not change until written
+    bool writePending();                              // True while keys from a char array are being written
     void printPanelBinary(bool printSpaces = true);   // Includes spaces between bytes by default
     void printPanelCommand();                         // Prints the panel command as hex
     void printPanelMessage();                         // Prints the decoded panel message
     void printModuleBinary(bool printSpaces = true);  // Includes spaces between bytes by default
     void printModuleMessage();                        // Prints the decoded keypad or module message
 
+    // Saves the decoded status to storage and restores it at begin() to prevent publishing false status
+    // changes after a reset.  Set in the sketch setup() before begin(), status is saved when changed and
+    // at most once per saveInterval, or the minimum save interval of the storage (esp8266 EEPROM: 1 hour).
+    void setStateStorage(dscStateStorage &storage, unsigned long saveInterval = 60000);
+    bool stateRestored;  // True if begin() restored a saved status, until confirmed or corrected by panel data
+
+    // Records zone, armed and trouble status changes to an event log, set in the sketch setup() after the
+    // event log begin()
+    void setEventLog(dscEventLog &log);
+
+    // Queues zone, armed and trouble status changes to a notification outbox, the sketch calls the outbox run()
+    void setOutbox(dscOutbox &setOutbox);
+
+    // Keybus link quality, updated once per second
+    unsigned int framesPerSecond;                // Commands detected in the last second
+    byte incompletePercent, errorPercent;        // Commands with less than 8 bits and commands failing the CRC check
+    unsigned long frameInterval, keybusTimeout;  // Learned longest normal interval between commands and the disconnect time
+    unsigned long commandAge(byte command);      // Milliseconds since the command was last seen, 0xFFFFFFFF if not seen or no longer tracked
+
+    // Debounces status changes: a change must remain for settleTime before it is accepted, and an accepted
+    // status is held for at least minHold before the next change is accepted (times in milliseconds).  Status
+    // is not debounced by default except for a 3s minimum hold on trouble status.  Set in the sketch setup().
+    void setDebounce(byte signal, unsigned int settleTime, unsigned int minHold);
+    unsigned long suppressedChanges;  // Number of status changes that reverted before they were accepted
+
+    // Sets a sketch function to decode panel commands starting with the command byte, and if the library
+    // status decoding also processes the command.  All commands are decoded for status by default, handler
+    // can be NULL to remove a sketch function.  Returns false if dscCommandHandlerSize or dscCommandTableSize
+    // is exceeded.
+    bool setCommandHandler(byte command, dscCommandHandler handler, bool processStatus = true);
+
+    // Copies a consistent snapshot of the status, safe to call from other tasks and web server callbacks while
+    // handlePanel() is running.  The snapshot is updated by handlePanel() when the status changes, returns false
+    // without copying if the version is still knownVersion.
+    bool getStatus(dscStatus &copy, unsigned long knownVersion = 0xFFFFFFFF);
+    unsigned long statusVersion();
+
+    // Latency tracing if dscLatencyTrace is enabled.  The sketch calls tracePublished() after publishing a
+    // status change to complete the trace of the oldest unpublished change.
+    void tracePublished();
+    unsigned long latencyCount(byte stage);                     // Number of latencies recorded for the stage
+    unsigned long latencyPercentile(byte stage, byte percent);  // Upper bound of the bucket containing the percentile
+    unsigned long latencyMax(byte stage);
+    void printLatency();                                        // Prints count, p50, p99 and max per stage
+    void resetLatency();
+
+    // ISR trace if dscISRTrace is enabled: printTrace() prints the buffered records, recording pauses while printing
+    void printTrace();
+    void resetTrace();
+
+    // Zone activity if dscZoneAnalytics is enabled, updated as zones open and close
+    bool zoneActivity(byte zone, dscZoneActivity &activity);  // Zone 1-64, returns false if the zone is not tracked
+    unsigned long zoneActivityWindow();                       // Milliseconds since the window started
+    void printZoneActivity();                                 // Prints the zones opened or open in the window
+    void resetZoneActivity();                                 // Starts a new window, open zones are counted from the reset
+
     // Set to a partition number for virtual keypad
     static byte writePartition;
 
@@ -45,19 +240,25 @@ class dscKeybusInterface {
     bool processRedundantData;      // Controls if repeated periodic commands are processed and displayed (default: false)
     static bool processModuleData;  // Controls if keypad and module data is processed and displayed (default: false)
     bool displayTrailingBits;       // Controls if bits read as the clock is reset are displayed, appears to be spurious data (default: false)
+    byte keybusTimeoutMultiple;     // Sets keybusConnected false after this multiple of the learned command interval, 0 uses dscKeybusTimeout (default: 4)
+    static bool rawBitMode;         // Stores only the sampled bits in the interrupt and decodes commands in handlePanel(), reduces time spent in interrupts (default: false)
+    static unsigned int clockGlitchTime;  // Ignores clock edges within this time in microseconds of the previous edge, set to 100 for ringing on long cables (default: 0, disabled)
+    static bool majorityVote;       // Reads the data line 3 times per bit and uses the majority value (default: false)
+    static bool clockRecovery;      // Samples the data line with a periodic timer locked to the clock period instead of an interrupt per clock edge, esp8266 without virtual keypad only (default: false)
 
 /*
     // Panel time
     bool timeAvailable;             // True after the panel sends the first timestamped message
     byte hour, minute, day, month;
     int year;
+*/
 
-    // These contain the current LED state and status message for each partition based on command 0x05 for
-    // partitions 1-4 and command 0x1B for partitions 5-8.  See printPanelLights() and printPanelMessages()
-    // in dscKeybusPrintData.cpp to see how this data translates to the LED status and status message.
+    #if defined(dscPowerSeries)
+    // These contain the current LED state and status message for each partition based on command 0x05 and
+    // 0x27, see the lights bits in dscPowerSeriesProfile
     byte status[dscPartitions];
     byte lights[dscPartitions];
-*/
+    #endif
 
     // Status tracking
     bool statusChanged;                   // True after any status change
@@ -79,6 +280,12 @@ class dscKeybusInterface {
     bool alarmZonesStatusChanged;
     byte alarmZones[dscZones], alarmZonesChanged[dscZones];  // Zone alarm status is stored in an array using 1 bit per zone, up to 64 zones
 
+    // Keypad display - the keypad shows a single 7-segment character at a time, multiple character readouts
+    // (zone numbers, fault codes, programming addresses) are shown in sequence and assembled into displayText
+    char displayText[dscDisplaySize + 1];  // Current readout, empty if the display is off
+    bool displayBlink, displayChanged;     // displayBlink is true if the readout is flashing
+    unsigned long displayTime;             // millis() when displayText or displayBlink last changed
+
     // Panel and keypad data is stored in an array: command [0], stop bit by itself [1], followed by the remaining
     // data.  panelData[] and moduleData[] can be accessed directly within the sketch.
     //
@@ -89,18 +296,68 @@ class dscKeybusInterface {
     static byte panelData[dscReadSize];
     static volatile byte moduleData[dscReadSize];
 
-    // True if dscBufferSize needs to be increased
+    // True if dscBufferSize (or dscRawBufferSize in rawBitMode) needs to be increased
     static volatile bool bufferOverflow;
+    static volatile unsigned int bufferPeak;  // Most bytes used in the panel buffer, can be reset by the sketch
+    byte bufferedCommands();                  // Number of commands waiting in the panel buffer
+
+    // Priority lanes if dscPriorityLanes is enabled: commands with status changes are buffered in a separate lane
+    // of dscPriorityBufferSize.  handlePanel() reads commands in capture order until more than dscPriorityBacklog
+    // low priority commands are buffered, then reads the status changes first and skips older low priority commands
+    // as outdated unless they have a sketch command handler or keypad display character.  If the high priority lane is full, commands are buffered in the low priority lane, and if the
+    // low priority lane is full, the oldest commands are evicted.
+    static volatile unsigned long droppedCommands[dscPriorityClasses];  // High priority commands not buffered in their lane, low priority commands not buffered or evicted
+    unsigned long supersededCommands;                                   // Low priority commands skipped as outdated
+
+    // Repeated commands skipped as redundant are counted in runs: repeatChanged is set when a run ends or reaches
+    // 255 repeats, with the command, number of repeats and the time of the first and last repeat in panelRepeat.
+    // Status commands 0x05 and 0x1B are counted in dscDataInterrupt() and use 10 bytes of the buffer per run.
+    dscRepeatRun panelRepeat;
+    bool repeatChanged;
+    void printPanelRepeat();
+
+    // Clock edges ignored by the clock glitch filter, and bits where the majority vote samples differed
+    static volatile unsigned long filteredEdges, disputedBits;
+
+    // Number of dscClockInterrupt() and dscDataInterrupt() calls
+    static volatile unsigned long clockInterrupts, dataInterrupts;
+
+    // Longest dscDataInterrupt() time if dscMeasureISR is enabled
+    static volatile unsigned long isrMaxTime;
 
     // Timer interrupt function to capture data - declared as public for use by AVR Timer2
     static void dscDataInterrupt();
 
   private:
+    void processCommand();
+    byte commandEntry(byte command);
+    void publishStatus();
     void processPanel_Zones();
+    void recordZoneActivity(byte zone, bool open, unsigned long currentTime);
+    byte debounce(byte group, byte rawStates, byte states);
+    void processLinkQuality();
+    void trackCommandAge(byte command);
+    void traceStatusChange();
+    void recordLatency(byte stage, unsigned long latency);
+    void printTraceEvent(byte event);
+    void trackRepeat(bool repeated);
+    void publishRepeat(byte command, byte count, unsigned long firstTime, unsigned long lastTime);
     void processHomeKey();
+    void processDisplay();
+    void processDisplayPause();
+    void setDisplay(bool blink);
     bool validCRC();
+    void restoreState();
+    void logEvent(byte type, byte data);
+    void saveState();
+    void encodeState(byte * stateData);
     void writeKeys(const char * writeKeysArray);
     static void dscClockInterrupt();
+    static void processDataBit(bool clockHigh, bool dataBit, bool frameEnd);
+    static bool bufferPanelData(byte bitCount, byte byteCount, const volatile byte * data, byte priority);
+    static void setClockInterrupt(bool enabled);
+    static void processRawBits();
+    static byte panelDataLength(byte bitCount, byte byteCount);
     static bool redundantPanelData(byte previousCmd[], volatile byte currentCmd[], byte checkedBytes = dscReadSize);
 
     Stream* stream;
@@ -118,6 +375,41 @@ class dscKeybusInterface {
     bool previousFire[dscPartitions];
     byte previousOpenZones[dscZones], previousAlarmZones[dscZones];
     bool previousHomeKey;
+    dscStateStorage* stateStorage;
+    unsigned long stateSaveInterval, previousStateSave, stateSequence;
+    unsigned int stateSlot, stateSlotCount;
+    byte savedState[dscStateSize];
+    bool stateDecoded;
+    dscEventLog* eventLog;
+    dscOutbox* outbox;
+    byte commandTable[dscCommandTableSize];  // Command table entry for each command byte, or for the commands in tableCommands[]
+    byte tableCommands[dscSparseCommandTable ? dscCommandTableSize : 1];
+    byte tableCommandCount;
+    dscCommandHandler commandHandlers[dscCommandHandlerSize];
+    unsigned int debounceSettle[dscSignalCount], debounceHold[dscSignalCount];
+    unsigned long debounceStart[dscSignalCount], debounceChange[dscSignalCount];
+    byte debouncePending[dscDebounceGroups];  // Signals with a change waiting for settleTime or minHold
+    unsigned long linkQualityTime;
+    unsigned int linkErrorCount;
+    bool linkConnected;
+    byte ageCommands[dscCommandAgeSize], ageCommandCount;  // Command bytes tracked by commandAge()
+    unsigned long ageTimes[dscCommandAgeSize];              // millis() when each tracked command was last seen
+    byte previousDisplay;
+    char displaySequence[dscDisplaySize];
+    byte displaySequenceLength;
+    bool displayBlank, displayPaused, displayFlashing;
+    unsigned long displaySegmentsTime, displayCharacterTime;
+    unsigned int latencyHistogram[dscLatencyStages][dscLatencyBuckets];
+    unsigned long latencyCounts[dscLatencyStages], latencyMaxTimes[dscLatencyStages];
+    unsigned long latencyFrameTime, latencyDequeueTime;        // Current command
+    unsigned long latencyChangeFrameTime, latencyChangeTime;   // Oldest unpublished status change
+    bool latencyChangePending;
+    dscRepeatRun repeatRuns[dscRepeatRunSize];  // Runs counted by handlePanel(), count 0 if unused
+    byte prioritySequence;                      // Sequence number of the last high priority command read
+    dscStatus statusSnapshots[2];              // The snapshot being written is never the one readers copy
+    volatile unsigned long statusSnapshotVersion;
+    dscZoneActivity zoneActivities[dscActivityZones];  // Open time excludes the current open period
+    unsigned long activityWindowStart;
 
     static byte dscClockPin;
     static byte dscReadPin;
@@ -127,15 +419,61 @@ class dscKeybusInterface {
     static char writeKey;
     static byte panelBitCount, panelByteCount;
     static volatile bool writeAlarm, writeAsterisk, wroteAsterisk, writeCmd;
+    static volatile bool writeVerify, writeRelease, writeRepeat, writeKeyCommand;
+    static volatile byte isrWriteEcho, writeRetryCount;
+    static volatile unsigned long writeStartTime;
     static volatile bool moduleDataCaptured;
     static volatile unsigned long clockHighTime, keybusTime;
-    static volatile byte panelBufferLength;
-    static volatile byte panelBuffer[dscBufferSize][dscReadSize];
-    static volatile byte panelBufferBitCount[dscBufferSize], panelBufferByteCount[dscBufferSize];
+    static volatile dscTraceRecord traceRing[dscTraceRecordSize];
+    static volatile unsigned long traceCount;  // Records written, the next record is at traceCount % dscTraceRingSize
+    static volatile bool traceHold;
+
+    // Writes a trace record from the interrupts, call only if dscISRTrace is enabled
+    static inline void traceISR(byte event, byte bit, byte data = 0) __attribute__((always_inline)) {
+      if (traceHold) return;
+      volatile dscTraceRecord &record = traceRing[traceCount & (dscTraceRecordSize - 1)];
+      #if defined(ESP8266)
+      record.time = ESP.getCycleCount();
+      #else
+      record.time = micros();
+      #endif
+      record.event = event;
+      record.bit = bit;
+      record.data = data;
+      traceCount++;
+    }
+
+    // Status command for key writes from the first byte of a command
+    static inline byte statusCommand(byte command) __attribute__((always_inline)) {
+      switch (command) {
+        case 0x05:
+        case 0x0A: return 0x05;
+        case 0x1B: return 0x1B;
+        default: return 0;
+      }
+    }
+
+    static volatile bool isrClockHigh;  // Clock level at the last edge accepted by the glitch filter
+    static volatile unsigned long clockRiseTime;  // micros() at the last rising clock edge
+    static volatile byte recoveryEdges;           // Clock edges since the reset between commands while measuring the clock period
+    static volatile unsigned long recoveryStartTime, recoveryPeriod;  // recoveryPeriod is the average half clock period in 1/16 microseconds
+    static volatile bool recoveryLocked, recoveryStarted, recoveryExpectHigh;
+    static volatile unsigned long isrFrameInterval;
+    static volatile unsigned int isrFrameCount, isrIncompleteCount;
+    static volatile byte panelBufferLength[dscPriorityClasses];  // Number of buffered commands per lane
+    static volatile byte panelBuffer[dscPanelBufferSize];        // Ring of commands per lane, low priority then high priority lane: bit count, byte count, priority sequence, data
+    static volatile unsigned int panelBufferHead[dscPriorityClasses], panelBufferTail[dscPriorityClasses], panelBufferUsed[dscPriorityClasses];
+    static volatile bool panelBufferReading;                     // Set while handlePanel() copies the oldest command, which is then not evicted
+    static volatile byte isrPrioritySequence;                    // High priority commands buffered
     static volatile byte moduleBitCount, moduleByteCount;
     static volatile byte currentCmd, statusCmd;
     static volatile byte isrPanelData[dscReadSize], isrPanelBitTotal, isrPanelBitCount, isrPanelByteCount;
     static volatile byte isrModuleData[dscReadSize], isrModuleBitTotal, isrModuleBitCount, isrModuleByteCount;
+    static volatile unsigned long rawBuffer[dscRawBufferSize], isrRawWord;
+    static volatile byte rawBufferHead, rawBufferTail, isrRawShift, isrRawBitTotal, isrRawCommand;
+    static volatile bool rawBufferGap;
 };
 
+#include "dscKeybusJson.h"
+
 #endif  // dscKeybusInterface_h
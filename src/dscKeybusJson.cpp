@@ -0,0 +1,167 @@
+
+#include "dscKeybusJson.h"
+
+/*
+ *  JSON writer
+ *
+ *  write() first compares the snapshots to find the changed field groups, so nothing is written if no
+ *  selected field changed, then prints each field directly to the output.  Within a group only the changed
+ *  fields are written: partitions are written as an object with the changed fields, zone arrays are written
+ *  in full if any zone in the array changed.
+ */
+
+dscJsonWriter::dscJsonWriter(Print &setOutput, byte setFields) {
+  output = &setOutput;
+  fields = setFields;
+}
+
+
+void dscJsonWriter::setFields(byte setFields) {
+  fields = setFields;
+}
+
+
+byte dscJsonWriter::changedFields(const dscStatus &status, const dscStatus &previous) {
+  byte changed = 0;
+  if (status.keybusConnected != previous.keybusConnected) changed |= dscJsonLink;
+
+  if (status.trouble != previous.trouble || status.powerTrouble != previous.powerTrouble
+      || status.batteryTrouble != previous.batteryTrouble) changed |= dscJsonTrouble;
+
+  if (status.accessCodePrompt != previous.accessCodePrompt
+      || memcmp(status.ready, previous.ready, sizeof(status.ready)) != 0
+      || memcmp(status.armed, previous.armed, sizeof(status.armed)) != 0
+      || memcmp(status.armedAway, previous.armedAway, sizeof(status.armedAway)) != 0
+      || memcmp(status.armedStay, previous.armedStay, sizeof(status.armedStay)) != 0
+      || memcmp(status.noEntryDelay, previous.noEntryDelay, sizeof(status.noEntryDelay)) != 0
+      || memcmp(status.alarm, previous.alarm, sizeof(status.alarm)) != 0
+      || memcmp(status.exitDelay, previous.exitDelay, sizeof(status.exitDelay)) != 0
+      || memcmp(status.entryDelay, previous.entryDelay, sizeof(status.entryDelay)) != 0
+      || memcmp(status.fire, previous.fire, sizeof(status.fire)) != 0) changed |= dscJsonPartitions;
+
+  if (memcmp(status.openZones, previous.openZones, sizeof(status.openZones)) != 0
+      || memcmp(status.alarmZones, previous.alarmZones, sizeof(status.alarmZones)) != 0) changed |= dscJsonZones;
+
+  if (strcmp(status.displayText, previous.displayText) != 0 || status.displayBlink != previous.displayBlink) changed |= dscJsonDisplay;
+
+  return changed;
+}
+
+
+// Writes {"version":N,...}
+size_t dscJsonWriter::write(const dscStatus &status, const dscStatus * previous) {
+  byte writeFields = fields;
+  if (previous) writeFields &= changedFields(status, *previous);
+  if (!writeFields) return 0;
+
+  length = output->print(F("{\"version\":"));
+  length += output->print(status.version);
+  firstField = false;
+
+  if (writeFields & dscJsonLink) {
+    writeBool(F("keybusConnected"), status.keybusConnected, previous ? &previous->keybusConnected : NULL);
+  }
+
+  if (writeFields & dscJsonTrouble) {
+    writeBool(F("trouble"), status.trouble, previous ? &previous->trouble : NULL);
+    writeBool(F("powerTrouble"), status.powerTrouble, previous ? &previous->powerTrouble : NULL);
+    writeBool(F("batteryTrouble"), status.batteryTrouble, previous ? &previous->batteryTrouble : NULL);
+  }
+
+  if (writeFields & dscJsonPartitions) {
+    writeBool(F("accessCodePrompt"), status.accessCodePrompt, previous ? &previous->accessCodePrompt : NULL);
+
+    for (byte partition = 0; partition < dscPartitions; partition++) {
+      if (previous && status.ready[partition] == previous->ready[partition] && status.armed[partition] == previous->armed[partition]
+          && status.armedAway[partition] == previous->armedAway[partition] && status.armedStay[partition] == previous->armedStay[partition]
+          && status.noEntryDelay[partition] == previous->noEntryDelay[partition] && status.alarm[partition] == previous->alarm[partition]
+          && status.exitDelay[partition] == previous->exitDelay[partition] && status.entryDelay[partition] == previous->entryDelay[partition]
+          && status.fire[partition] == previous->fire[partition]) continue;
+
+      writeKey(F("partition"), partition + 1);
+      length += output->print('{');
+      firstField = true;
+      writeBool(F("ready"), status.ready[partition], previous ? &previous->ready[partition] : NULL);
+      writeBool(F("armed"), status.armed[partition], previous ? &previous->armed[partition] : NULL);
+      writeBool(F("armedAway"), status.armedAway[partition], previous ? &previous->armedAway[partition] : NULL);
+      writeBool(F("armedStay"), status.armedStay[partition], previous ? &previous->armedStay[partition] : NULL);
+      writeBool(F("noEntryDelay"), status.noEntryDelay[partition], previous ? &previous->noEntryDelay[partition] : NULL);
+      writeBool(F("alarm"), status.alarm[partition], previous ? &previous->alarm[partition] : NULL);
+      writeBool(F("exitDelay"), status.exitDelay[partition], previous ? &previous->exitDelay[partition] : NULL);
+      writeBool(F("entryDelay"), status.entryDelay[partition], previous ? &previous->entryDelay[partition] : NULL);
+      writeBool(F("fire"), status.fire[partition], previous ? &previous->fire[partition] : NULL);
+      length += output->print('}');
+      firstField = false;
+    }
+  }
+
+  if (writeFields & dscJsonZones) {
+    writeZones(F("openZones"), status.openZones, previous ? previous->openZones : NULL);
+    writeZones(F("alarmZones"), status.alarmZones, previous ? previous->alarmZones : NULL);
+  }
+
+  if (writeFields & dscJsonDisplay) {
+    writeText(F("display"), status.displayText, previous ? previous->displayText : NULL);
+    writeBool(F("displayBlink"), status.displayBlink, previous ? &previous->displayBlink : NULL);
+  }
+
+  length += output->print('}');
+  return length;
+}
+
+
+// Writes ,"key": or "key": for the first field of an object, with the number appended if set
+void dscJsonWriter::writeKey(const __FlashStringHelper * key, byte number) {
+  if (!firstField) length += output->print(',');
+  firstField = false;
+  length += output->print('"');
+  length += output->print(key);
+  if (number) length += output->print(number);
+  length += output->print(F("\":"));
+}
+
+
+void dscJsonWriter::writeBool(const __FlashStringHelper * key, bool value, const bool * previousValue) {
+  if (previousValue && value == *previousValue) return;
+  writeKey(key);
+  if (value) length += output->print(F("true"));
+  else length += output->print(F("false"));
+}
+
+
+void dscJsonWriter::writeZones(const __FlashStringHelper * key, const byte * zones, const byte * previousZones) {
+  if (previousZones && memcmp(zones, previousZones, dscZones) == 0) return;
+  writeKey(key);
+  length += output->print('[');
+  bool firstZone = true;
+  for (byte zoneGroup = 0; zoneGroup < dscZones; zoneGroup++) {
+    for (byte zoneBit = 0; zoneBit < 8; zoneBit++) {
+      if (!bitRead(zones[zoneGroup], zoneBit)) continue;
+      if (!firstZone) length += output->print(',');
+      firstZone = false;
+      length += output->print(zoneBit + 1 + (zoneGroup * 8));
+    }
+  }
+  length += output->print(']');
+}
+
+
+void dscJsonWriter::writeText(const __FlashStringHelper * key, const char * text, const char * previousText) {
+  if (previousText && strcmp(text, previousText) == 0) return;
+  writeKey(key);
+  length += output->print('"');
+  for (; *text; text++) {
+    char character = *text;
+    if (character == '"' || character == '\\') {
+      length += output->print('\\');
+      length += output->print(character);
+    }
+    else if ((byte)character < 0x20) {
+      length += output->print(F("\\u00"));
+      if ((byte)character < 0x10) length += output->print('0');
+      length += output->print((byte)character, HEX);
+    }
+    else length += output->print(character);
+  }
+  length += output->print('"');
+}
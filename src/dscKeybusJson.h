@@ -0,0 +1,81 @@
+
+#ifndef dscKeybusJson_h
+#define dscKeybusJson_h
+
+#include <Arduino.h>
+#include "dscKeybusInterface.h"
+
+// Field groups for dscJsonWriter
+const byte dscJsonLink = 0x01;        // keybusConnected
+const byte dscJsonTrouble = 0x02;     // trouble, powerTrouble, batteryTrouble
+const byte dscJsonPartitions = 0x04;  // accessCodePrompt and the partition status as "partition1":{...}
+const byte dscJsonZones = 0x08;       // openZones and alarmZones as arrays of zone numbers
+const byte dscJsonDisplay = 0x10;     // display and displayBlink
+const byte dscJsonAllFields = 0x1F;
+
+
+// Prints to a fixed buffer and stops at the end of the buffer, the buffer requires size + 1 bytes for the
+// terminating null
+class dscBufferWriter : public Print {
+
+  public:
+    dscBufferWriter(char * setBuffer, unsigned int setSize) {
+      buffer = setBuffer;
+      size = setSize;
+      length = 0;
+      full = false;
+      buffer[0] = '\0';
+    }
+
+    size_t write(uint8_t character) {
+      if (length >= size) {
+        full = true;
+        return 0;
+      }
+      buffer[length++] = character;
+      buffer[length] = '\0';
+      return 1;
+    }
+
+    size_t write(const uint8_t * data, size_t dataSize) {
+      if (dataSize > size - length) {
+        dataSize = size - length;
+        full = true;
+      }
+      memcpy(buffer + length, data, dataSize);
+      length += dataSize;
+      buffer[length] = '\0';
+      return dataSize;
+    }
+
+    char * buffer;
+    unsigned int size, length;
+    bool full;
+};
+
+
+// Writes a status snapshot from getStatus() as one JSON object directly to a Print output: a Stream, a
+// client or a dscBufferWriter.  Only the selected field groups are written, and with a previous snapshot only
+// the fields that changed from it.  Nothing is allocated and nothing is buffered.
+class dscJsonWriter {
+
+  public:
+    dscJsonWriter(Print &setOutput, byte setFields = dscJsonAllFields);
+
+    void setFields(byte setFields);
+    size_t write(const dscStatus &status, const dscStatus * previous = NULL);  // Returns bytes written, 0 if no selected fields changed
+    static byte changedFields(const dscStatus &status, const dscStatus &previous);  // Returns the field groups that differ
+
+  private:
+    void writeKey(const __FlashStringHelper * key, byte number = 0);
+    void writeBool(const __FlashStringHelper * key, bool value, const bool * previousValue);
+    void writeZones(const __FlashStringHelper * key, const byte * zones, const byte * previousZones);
+    void writeText(const __FlashStringHelper * key, const char * text, const char * previousText);
+
+    Print* output;
+    byte fields;
+    bool firstField;
+    size_t length;
+};
+
+#endif  // dscKeybusJson_h
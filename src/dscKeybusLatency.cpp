@@ -0,0 +1,111 @@
+
+#include "dscKeybusInterface.h"
+
+/*
+ *  Latency tracing
+ *
+ *  If dscLatencyTrace is enabled, each buffered command is stamped with micros() when captured and the time is
+ *  carried through the panel buffer to handlePanel().  A status change decoded from the command starts a trace
+ *  that is completed by tracePublished(), further changes before tracePublished() are part of the same trace.
+ *
+ *  Latencies are counted in fixed histograms with power of two buckets: bucket 0 is 0-1us, bucket n is
+ *  2^n - 2^(n+1)-1 us.  If a bucket count reaches its limit, the stage counts are halved to keep the
+ *  distribution.
+ */
+
+void dscKeybusInterface::recordLatency(byte stage, unsigned long latency) {
+  byte bucket = 0;
+  for (unsigned long bucketLimit = latency >> 1; bucketLimit > 0 && bucket < dscLatencyBuckets - 1; bucketLimit >>= 1) bucket++;
+
+  if (latencyHistogram[stage][bucket] == 0xFFFF) {
+    for (byte i = 0; i < dscLatencyBuckets; i++) latencyHistogram[stage][i] >>= 1;
+  }
+  latencyHistogram[stage][bucket]++;
+  latencyCounts[stage]++;
+  if (latency > latencyMaxTimes[stage]) latencyMaxTimes[stage] = latency;
+}
+
+
+void dscKeybusInterface::traceStatusChange() {
+  if (latencyChangePending) return;
+  latencyChangeFrameTime = latencyFrameTime;
+  latencyChangeTime = micros();
+  latencyChangePending = true;
+  recordLatency(dscLatencyDecode, latencyChangeTime - latencyDequeueTime);
+}
+
+
+void dscKeybusInterface::tracePublished() {
+  if (!dscLatencyTrace || !latencyChangePending) return;
+  unsigned long publishTime = micros();
+  recordLatency(dscLatencyPublish, publishTime - latencyChangeTime);
+  recordLatency(dscLatencyTotal, publishTime - latencyChangeFrameTime);
+  latencyChangePending = false;
+}
+
+
+unsigned long dscKeybusInterface::latencyCount(byte stage) {
+  if (!dscLatencyTrace || stage >= dscLatencyStages) return 0;
+  return latencyCounts[stage];
+}
+
+
+unsigned long dscKeybusInterface::latencyPercentile(byte stage, byte percent) {
+  if (!dscLatencyTrace || stage >= dscLatencyStages) return 0;
+
+  unsigned long bucketTotal = 0;
+  for (byte bucket = 0; bucket < dscLatencyBuckets; bucket++) bucketTotal += latencyHistogram[stage][bucket];
+  if (bucketTotal == 0) return 0;
+
+  unsigned long target = (bucketTotal * percent + 99) / 100;
+  if (target == 0) target = 1;
+  unsigned long bucketCount = 0;
+  for (byte bucket = 0; bucket < dscLatencyBuckets; bucket++) {
+    bucketCount += latencyHistogram[stage][bucket];
+    if (bucketCount >= target) {
+      unsigned long bucketLimit = (2UL << bucket) - 1;
+      if (bucket == dscLatencyBuckets - 1 || bucketLimit > latencyMaxTimes[stage]) return latencyMaxTimes[stage];
+      return bucketLimit;
+    }
+  }
+  return latencyMaxTimes[stage];
+}
+
+
+unsigned long dscKeybusInterface::latencyMax(byte stage) {
+  if (!dscLatencyTrace || stage >= dscLatencyStages) return 0;
+  return latencyMaxTimes[stage];
+}
+
+
+void dscKeybusInterface::printLatency() {
+  if (!dscLatencyTrace) return;
+  for (byte stage = 0; stage < dscLatencyStages; stage++) {
+    switch (stage) {
+      case dscLatencyQueue: stream->print(F("Queue  ")); break;
+      case dscLatencyDecode: stream->print(F("Decode ")); break;
+      case dscLatencyPublish: stream->print(F("Publish")); break;
+      case dscLatencyTotal: stream->print(F("Total  ")); break;
+    }
+    stream->print(F(" count: "));
+    stream->print(latencyCounts[stage]);
+    stream->print(F(" p50: "));
+    stream->print(latencyPercentile(stage, 50));
+    stream->print(F("us p99: "));
+    stream->print(latencyPercentile(stage, 99));
+    stream->print(F("us max: "));
+    stream->print(latencyMaxTimes[stage]);
+    stream->println(F("us"));
+  }
+}
+
+
+void dscKeybusInterface::resetLatency() {
+  if (!dscLatencyTrace) return;
+  for (byte stage = 0; stage < dscLatencyStages; stage++) {
+    for (byte bucket = 0; bucket < dscLatencyBuckets; bucket++) latencyHistogram[stage][bucket] = 0;
+    latencyCounts[stage] = 0;
+    latencyMaxTimes[stage] = 0;
+  }
+  latencyChangePending = false;
+}
@@ -0,0 +1,258 @@
+
+#include "dscKeybusInterface.h"
+
+/*
+ *  Notification outbox
+ *
+ *  Events are queued in memory, and once the memory queue is full, new events are written to the spill log
+ *  until the spill log is empty again so events are always sent in order.  Delivered spill log events are
+ *  recorded by appending a dscEventDelivered record with the number of events delivered, at setSpill() the
+ *  spill log is replayed to find the events that were not delivered before a reset.  The spill log does not
+ *  write restart records, which would overwrite the oldest undelivered event of a full log.
+ *
+ *  While a step sender is sending, the message stays in the message buffer and the events in it stay first in
+ *  the queue, new events are queued after them.
+ */
+
+dscOutbox::dscOutbox() {
+  sender = NULL;
+  stepSender = NULL;
+  spill = NULL;
+  coalesceTime = 2000;
+  maxDelay = 10000;
+  eventsHead = 0;
+  eventsCount = 0;
+  spillPosition = 0;
+  spillCount = 0;
+  retryPending = false;
+  sendPending = false;
+  sendingCount = 0;
+  sendTimeout = 0;
+  sentMessages = 0;
+  sentEvents = 0;
+  failedSends = 0;
+  timedOutSends = 0;
+  droppedEvents = 0;
+  queuePeak = 0;
+}
+
+
+void dscOutbox::setSender(bool (*setSender)(const char * message)) {
+  sender = setSender;
+}
+
+
+void dscOutbox::setStepSender(byte (*setSender)(const char * message, bool start), unsigned long setSendTimeout) {
+  stepSender = setSender;
+  sendTimeout = setSendTimeout;
+}
+
+
+void dscOutbox::setCoalesceTime(unsigned long setCoalesceTime, unsigned long setMaxDelay) {
+  coalesceTime = setCoalesceTime;
+  maxDelay = setMaxDelay;
+}
+
+
+// Replays the spill log to find the number of undelivered events, then finds the oldest undelivered event
+bool dscOutbox::setSpill(dscEventLog &log) {
+  spill = &log;
+  spill->setRestartRecord(false);
+  spillCount = 0;
+
+  unsigned int logCount = spill->count();
+  dscEvent event;
+  for (unsigned int position = 0; position < logCount; position++) {
+    if (!spill->readEvent(position, event)) continue;
+    if (event.type != dscEventDelivered) spillCount++;
+    else if (event.data < spillCount) spillCount -= event.data;
+    else spillCount = 0;
+  }
+
+  spillPosition = logCount;
+  for (unsigned int undelivered = spillCount; undelivered > 0 && spillPosition > 0; ) {
+    spillPosition--;
+    if (spill->readEvent(spillPosition, event) && event.type != dscEventDelivered) undelivered--;
+  }
+
+  if (spillCount > queuePeak) queuePeak = spillCount;
+  return spillCount > 0;
+}
+
+
+unsigned int dscOutbox::queuedEvents() {
+  return eventsCount + spillCount;
+}
+
+
+bool dscOutbox::add(byte type, byte data) {
+  unsigned long currentTime = millis();
+  if (queuedEvents() == 0) firstEventTime = currentTime;
+  lastEventTime = currentTime;
+
+  // Keeps events in order by writing to the spill log until it is empty
+  if (spill && (spillCount > 0 || eventsCount >= dscOutboxSize)) spillEvent(type, data);
+
+  else if (eventsCount >= dscOutboxSize) {
+    droppedEvents++;
+    return false;
+  }
+
+  else {
+    byte index = eventsHead + eventsCount;
+    if (index >= dscOutboxSize) index -= dscOutboxSize;
+    events[index].timestamp = currentTime / 1000;
+    events[index].type = type;
+    events[index].data = data;
+    eventsCount++;
+  }
+
+  if (queuedEvents() > queuePeak) queuePeak = queuedEvents();
+  return true;
+}
+
+
+void dscOutbox::spillEvent(byte type, byte data) {
+  unsigned int logCount = spill->count();
+  if (spillCount == 0) spillPosition = logCount;
+  if (!spill->log(type, data)) {
+    droppedEvents++;
+    return;
+  }
+
+  // The oldest record was overwritten if the spill log is full
+  if (spill->count() == logCount) {
+    if (spillPosition > 0) spillPosition--;
+    else if (spillCount > 0) {
+      spillCount--;
+      droppedEvents++;
+      if (sendPending && sendingCount > eventsCount) sendingCount--;  // The dropped event was in the message being sent
+    }
+  }
+  spillCount++;
+}
+
+
+// Removes sent events from the memory queue first, then from the spill log
+void dscOutbox::removeEvents(unsigned int count) {
+  while (count > 0 && eventsCount > 0) {
+    if (++eventsHead >= dscOutboxSize) eventsHead = 0;
+    eventsCount--;
+    count--;
+  }
+
+  dscEvent event;
+  while (count > 0 && spillCount > 0) {
+    byte delivered = 0;
+    while (count > 0 && spillCount > 0 && delivered < 0xFF) {
+      if (spill->readEvent(spillPosition, event) && event.type != dscEventDelivered) {
+        delivered++;
+        spillCount--;
+        count--;
+      }
+      spillPosition++;
+    }
+
+    // Skips past delivered records to the next undelivered event
+    while (spillCount > 0 && spill->readEvent(spillPosition, event) && event.type == dscEventDelivered) spillPosition++;
+
+    unsigned int logCount = spill->count();
+    if (spill->log(dscEventDelivered, delivered) && spill->count() == logCount && spillPosition > 0) spillPosition--;
+  }
+}
+
+
+bool dscOutbox::readEvent(unsigned int index, dscEvent &event) {
+  if (index < eventsCount) {
+    byte eventIndex = eventsHead + index;
+    if (eventIndex >= dscOutboxSize) eventIndex -= dscOutboxSize;
+    event = events[eventIndex];
+    return true;
+  }
+  return false;
+}
+
+
+// Sends once events stop arriving for coalesceTime, maxDelay after the first event, or when the memory queue
+// is full.  After a failed send, the message is built again and sent after the retry delay.
+void dscOutbox::run() {
+  if (sendPending) {
+    byte result = stepSender(message, false);
+    if (result == dscSendPending) {
+      if (millis() - sendStartTime < sendTimeout) return;
+      timedOutSends++;
+      result = dscSendFailed;
+    }
+    finishSend(result);
+    return;
+  }
+
+  unsigned int queued = queuedEvents();
+  if ((!sender && !stepSender) || queued == 0) return;
+
+  unsigned long currentTime = millis();
+  if (retryPending) {
+    if (currentTime - retryTime < retryDelay) return;
+  }
+  else if (currentTime - lastEventTime < coalesceTime && currentTime - firstEventTime < maxDelay && eventsCount < dscOutboxSize) return;
+
+  // Builds a message with as many events as fit, one line per event
+  dscBufferWriter writer(message, dscOutboxMessageSize);
+  unsigned int batchCount = 0;
+  unsigned int position = spillPosition;
+  dscEvent event;
+  while (batchCount < queued) {
+    if (batchCount < eventsCount) readEvent(batchCount, event);
+    else {
+      while (spill->readEvent(position, event) && event.type == dscEventDelivered) position++;
+      if (!spill->readEvent(position, event)) break;
+      position++;
+    }
+
+    unsigned int previousLength = writer.length;
+    if (batchCount > 0) writer.print(F("\n"));
+    dscEventLog::printEventMessage(event, writer);
+    if (writer.full && batchCount > 0) {
+      message[previousLength] = '\0';
+      break;
+    }
+    batchCount++;
+    if (writer.full) break;
+  }
+  if (batchCount == 0) return;
+
+  sendingCount = batchCount;
+  if (!stepSender) {
+    finishSend(sender(message) ? dscSendDone : dscSendFailed);
+    return;
+  }
+
+  // The step sender continues from the next run()
+  sendPending = true;
+  sendStartTime = currentTime;
+  byte result = stepSender(message, true);
+  if (result != dscSendPending) finishSend(result);
+}
+
+
+void dscOutbox::finishSend(byte result) {
+  sendPending = false;
+  unsigned long currentTime = millis();
+  if (result == dscSendDone) {
+    removeEvents(sendingCount);
+    sentMessages++;
+    sentEvents += sendingCount;
+    retryPending = false;
+
+    // Sends the remaining events without waiting again
+    firstEventTime = currentTime - maxDelay;
+  }
+  else {
+    failedSends++;
+    if (!retryPending) retryDelay = dscOutboxRetryTime;
+    else if (retryDelay < dscOutboxMaxRetryTime / 2) retryDelay *= 2;
+    else retryDelay = dscOutboxMaxRetryTime;
+    retryPending = true;
+    retryTime = currentTime;
+  }
+}
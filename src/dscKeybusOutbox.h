@@ -0,0 +1,67 @@
+
+#ifndef dscKeybusOutbox_h
+#define dscKeybusOutbox_h
+
+#include <Arduino.h>
+#include "dscKeybusEventLog.h"
+
+#if defined(__AVR__)
+const byte dscOutboxSize = 8;            // Number of events queued in memory - requires 6 bytes of memory per event
+const byte dscOutboxMessageSize = 64;    // Maximum length of a message
+#else
+const byte dscOutboxSize = 32;
+const byte dscOutboxMessageSize = 255;
+#endif
+
+const unsigned long dscOutboxRetryTime = 1000;       // Time in milliseconds before the first retry, doubled for each retry
+const unsigned long dscOutboxMaxRetryTime = 300000;  // Longest time between retries
+
+const byte dscSendFailed = 0;   // Step sender results
+const byte dscSendDone = 1;
+const byte dscSendPending = 2;  // Call again from the next run() with the same message
+
+
+// Queues status events for notifications and sends them from run(): events that arrive within coalesceTime of
+// each other are combined into one message, one line per event, and failed messages are retried with an
+// increasing delay.  When the queue is full, events spill to an optional event log so events are kept while
+// the network is down and across a reset.  A step sender sends a message in short steps, one step per run(),
+// so a slow server does not block the Keybus and run() can be a scheduler task with a short budget.
+class dscOutbox {
+
+  public:
+    dscOutbox();
+
+    void setSender(bool (*setSender)(const char * message));  // Sketch function to send a message, returns true if sent
+    void setStepSender(byte (*setSender)(const char * message, bool start), unsigned long setSendTimeout);  // Sketch function for one step of sending a message, returns dscSendPending until sent or failed, the send fails after sendTimeout milliseconds
+    void setCoalesceTime(unsigned long setCoalesceTime, unsigned long setMaxDelay);  // Times in milliseconds (default: 2000, 10000)
+    bool setSpill(dscEventLog &log);  // Sets an event log used only by the outbox, call after the event log begin()
+    bool add(byte type, byte data);   // Queues an event, returns false if the event is dropped
+    void run();                       // Sends queued events, call from loop() or as a scheduler task
+    unsigned int queuedEvents();
+
+    unsigned long sentMessages, sentEvents, failedSends, timedOutSends, droppedEvents;
+    unsigned int queuePeak;  // Most events queued in memory and the spill log
+
+  private:
+    bool readEvent(unsigned int index, dscEvent &event);
+    void removeEvents(unsigned int count);
+    void spillEvent(byte type, byte data);
+    void finishSend(byte result);
+
+    bool (*sender)(const char * message);
+    byte (*stepSender)(const char * message, bool start);
+    unsigned long coalesceTime, maxDelay;
+    dscEvent events[dscOutboxSize];
+    byte eventsHead, eventsCount;
+    dscEventLog* spill;
+    unsigned int spillPosition, spillCount;  // Position in the spill log of the oldest unsent event
+    unsigned long firstEventTime, lastEventTime;
+    unsigned long retryTime, retryDelay;
+    bool retryPending;
+    bool sendPending;
+    unsigned int sendingCount;  // Events in the message being sent
+    unsigned long sendStartTime, sendTimeout;
+    char message[dscOutboxMessageSize + 1];
+};
+
+#endif  // dscKeybusOutbox_h
@@ -0,0 +1,250 @@
+
+#ifndef dscKeybusPanelProfile_h
+#define dscKeybusPanelProfile_h
+
+#include <Arduino.h>
+
+/*
+ *  Panel profiles
+ *
+ *  A panel profile supplies the panel-specific Keybus encoding: key codes, where keys are written, the CRC,
+ *  and the status bits of panel commands.  Profiles are structs of static inline functions and constants,
+ *  dscPanelProfile is selected at compile time and only its code is built.
+ *
+ *  Sigma MC-08 is the default, DSC PowerSeries is selected by defining dscPowerSeries in the build flags
+ *  (PlatformIO: build_flags = -D dscPowerSeries).  Both the library and sketch must be built with the same
+ *  profile.
+ */
+
+// Status decoded from a panel command, returned by decodeFlags()
+const byte dscDecodeTrouble = 0x01;
+const byte dscDecodePowerTrouble = 0x02;
+const byte dscDecodeArmed = 0x04;
+const byte dscDecodeZones = 0x08;  // Open zones 1-8
+const byte dscDecodeLights = 0x10; // Partition lights and status bytes, PowerSeries only
+
+
+// Sigma MC-08: each panel command starts with the 7-segment display pattern, followed by the zone status in
+// byte 2 and the system status in byte 3.  Keys are written in panel bits 1-8 of any command.
+struct dscSigmaMC08Profile {
+
+  static const byte writeStartBit = 1;  // Panel bit of the first key bit
+  static const byte writeEndBit = 24;   // Panel bit where command keys are flagged and the write is complete
+  static const bool segmentDisplay = true;
+
+  static inline bool keyCode(char key, byte &code) {
+    switch (key) {
+      case '0': code = 0xCF; return true;
+      case '1': code = 0xDD; return true;
+      case '2': code = 0xBD; return true;
+      case '3': code = 0x7D; return true;
+      case '4': code = 0xDB; return true;
+      case '5': code = 0xBB; return true;
+      case '6': code = 0x7B; return true;
+      case '7': code = 0xD7; return true;
+      case '8': code = 0xB7; return true;
+      case '9': code = 0x77; return true;
+      case 'r':
+      case 'R': code = 0xAF; return true;  // Read
+      case 'a':
+      case 'A': code = 0x6F; return true;  // Address
+      case '#': code = 0xEF; return true;  // Enter
+      case 'b':
+      case 'B': code = 0xF7; return true;  // Bypass
+      case 'h':
+      case 'H': code = 0xFD; return true;  // Home
+      case 'c':
+      case 'C': code = 0xFB; return true;  // Code
+      default: return false;
+    }
+  }
+
+  // Command keys are written after a 0xFF command, with panel bit 24 set in both commands
+  static inline bool commandKey(char key) {
+    switch (key) {
+      case '#': case 'b': case 'B': case 'h': case 'H': case 'c': case 'C': return true;
+      default: return false;
+    }
+  }
+
+  static inline bool alarmKey(char) {
+    return false;
+  }
+
+  // Home is held from the Home key until another key, selects armed stay when the panel arms
+  static inline bool homeKey(byte moduleKey, bool homeKeyHeld) {
+    return moduleKey == 0xFD || (homeKeyHeld && (moduleKey == 0xFF || moduleKey == 0xEF));
+  }
+
+  static inline bool writeCommand(byte) {
+    return true;
+  }
+
+  // Segments: bit 0 = a (top) ... bit 6 = g (middle)
+  static inline char displayCharacter(byte segments) {
+    switch (segments) {
+      case 0x3F: return '0';
+      case 0x06: return '1';
+      case 0x5B: return '2';
+      case 0x4F: return '3';
+      case 0x66: return '4';
+      case 0x6D: return '5';
+      case 0x7D: return '6';
+      case 0x07: return '7';
+      case 0x7F: return '8';
+      case 0x6F: return '9';
+      case 0x77: return 'A';
+      case 0x71: return 'F';
+      case 0x73: return 'P';
+      default: return 0;
+    }
+  }
+
+  static inline bool validCRC(const byte *, byte panelBitCount) {
+    return panelBitCount >= 24;
+  }
+
+  static inline byte decodeFlags(const byte * panelData, byte panelBitCount) {
+    if (!validCRC(panelData, panelBitCount)) return 0;
+    return dscDecodeTrouble | dscDecodePowerTrouble | dscDecodeArmed | dscDecodeZones;
+  }
+
+  static inline bool trouble(const byte * panelData) { return bitRead(panelData[3], 3); }
+  static inline bool powerTrouble(const byte * panelData) { return bitRead(panelData[3], 2); }
+  static inline bool armed(const byte * panelData, byte) { return !bitRead(panelData[3], 0); }
+  static inline byte openZones(const byte * panelData) { return panelData[2] >> 1; }
+
+  // Panel buffer priority: every command has the zone and system status, a command is high priority if the status
+  // differs from the previous command.  Called by dscDataInterrupt(), previousStatus holds priorityStatusSize bytes.
+  static const byte priorityStatusSize = 2;
+  static inline bool statusChange(const byte * panelData, byte panelBitCount, byte * previousStatus) {
+    if (!validCRC(panelData, panelBitCount)) return false;
+    bool changed = panelData[2] != previousStatus[0] || panelData[3] != previousStatus[1];
+    previousStatus[0] = panelData[2];
+    previousStatus[1] = panelData[3];
+    return changed;
+  }
+};
+
+
+// DSC PowerSeries: partition 1 lights and status are in bytes 2-3 of command 0x05 and command 0x27 also
+// includes open zones 1-8 in byte 6.  Keys are written in panel bits 9-16 of command 0x05 for partition 1.
+struct dscPowerSeriesProfile {
+
+  static const byte writeStartBit = 9;
+  static const byte writeEndBit = 17;  // The bit after the key, bit 16 is the last key bit
+  static const bool segmentDisplay = false;
+
+  static inline bool keyCode(char key, byte &code) {
+    switch (key) {
+      case '0': code = 0x00; return true;
+      case '1': code = 0x05; return true;
+      case '2': code = 0x0A; return true;
+      case '3': code = 0x0F; return true;
+      case '4': code = 0x11; return true;
+      case '5': code = 0x16; return true;
+      case '6': code = 0x1B; return true;
+      case '7': code = 0x1C; return true;
+      case '8': code = 0x22; return true;
+      case '9': code = 0x27; return true;
+      case '*': code = 0x28; return true;
+      case '#': code = 0x2D; return true;
+      case 'f':
+      case 'F': code = 0xBB; return true;  // Fire alarm
+      case 'a':
+      case 'A': code = 0xDD; return true;  // Auxiliary alarm
+      case 'p':
+      case 'P': code = 0xEE; return true;  // Panic alarm
+      case 's':
+      case 'S': code = 0xAF; return true;  // Arm stay
+      case 'w':
+      case 'W': code = 0xB1; return true;  // Arm away
+      case 'n':
+      case 'N': code = 0xB6; return true;  // Arm with no entry delay
+      default: return false;
+    }
+  }
+
+  static inline bool commandKey(char) {
+    return false;
+  }
+
+  static inline bool alarmKey(char key) {
+    switch (key) {
+      case 'f': case 'F': case 'a': case 'A': case 'p': case 'P': return true;
+      default: return false;
+    }
+  }
+
+  static inline bool homeKey(byte, bool) {
+    return false;
+  }
+
+  // statusCmd is set as the command byte is read
+  static inline bool writeCommand(byte statusCmd) {
+    return statusCmd == 0x05;
+  }
+
+  static inline char displayCharacter(byte) {
+    return 0;
+  }
+
+  // The checksum is the sum of the bytes excluding the stop bit byte, command 0x05 does not include a checksum
+  static inline bool validCRC(const byte * panelData, byte panelBitCount) {
+    if (panelData[0] == 0x05) return panelBitCount >= 25;
+    if (panelBitCount < 25) return false;
+
+    byte byteCount = (panelBitCount - 1) / 8;
+    byte dataSum = 0;
+    for (byte panelByte = 0; panelByte < byteCount; panelByte++) {
+      if (panelByte != 1) dataSum += panelData[panelByte];
+    }
+    return dataSum == panelData[byteCount];
+  }
+
+  static inline byte decodeFlags(const byte * panelData, byte panelBitCount) {
+    if (!validCRC(panelData, panelBitCount)) return 0;
+    switch (panelData[0]) {
+      case 0x05: return dscDecodeTrouble | dscDecodeArmed | dscDecodeLights;
+      case 0x27: return dscDecodeTrouble | dscDecodeArmed | dscDecodeLights | dscDecodeZones;
+      default: return 0;
+    }
+  }
+
+  // Lights: bit 0 = ready, bit 1 = armed, bit 2 = memory, bit 3 = bypass, bit 4 = trouble, bit 5 = program,
+  // bit 6 = fire, bit 7 = backlight
+  static inline bool trouble(const byte * panelData) { return bitRead(panelData[2], 4); }
+  static inline bool powerTrouble(const byte *) { return false; }
+  static inline bool armed(const byte * panelData, byte) { return bitRead(panelData[2], 1); }
+  static inline byte openZones(const byte * panelData) { return panelData[6]; }
+
+  // Panel buffer priority: commands 0x05 and 0x27 are high priority if the lights, status or open zones differ
+  // from the previous command with the same command byte.  previousStatus holds priorityStatusSize bytes: lights
+  // and status of 0x05, then lights, status and zones of 0x27.
+  static const byte priorityStatusSize = 5;
+  static inline bool statusChange(const byte * panelData, byte panelBitCount, byte * previousStatus) {
+    if (!validCRC(panelData, panelBitCount)) return false;
+    byte statusBytes[3] = {panelData[2], panelData[3], panelData[6]};
+    byte statusCount;
+    switch (panelData[0]) {
+      case 0x05: statusCount = 2; break;
+      case 0x27: statusCount = 3; previousStatus += 2; break;
+      default: return false;
+    }
+    bool changed = false;
+    for (byte i = 0; i < statusCount; i++) {
+      if (statusBytes[i] != previousStatus[i]) changed = true;
+      previousStatus[i] = statusBytes[i];
+    }
+    return changed;
+  }
+};
+
+
+#if defined(dscPowerSeries)
+typedef dscPowerSeriesProfile dscPanelProfile;
+#else
+typedef dscSigmaMC08Profile dscPanelProfile;
+#endif
+
+#endif  // dscKeybusPanelProfile_h
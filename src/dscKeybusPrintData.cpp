@@ -6,71 +6,63 @@
  */
 
 void dscKeybusInterface::printPanelMessage() {
-  switch (panelData[0]) {
-      case 0x3F: stream->print(F("0")); break;
-      case 0x06: stream->print(F("1")); break;
-      case 0x5B: stream->print(F("2")); break;
-      case 0x4F: stream->print(F("3")); break;
-      case 0x66: stream->print(F("4")); break;
-      case 0x6D: stream->print(F("5")); break;
-      case 0x7D: stream->print(F("6")); break;
-      case 0x07: stream->print(F("7")); break;
-      case 0x7F: stream->print(F("8")); break;
-      case 0x6F: stream->print(F("9")); break;
-      case 0x77: stream->print(F("A")); break;
-      case 0x71: stream->print(F("F")); break;
-      case 0x73: stream->print(F("P")); break;
-    default: {
-      if (!validCRC()) {
-        stream->print(F("[No CRC or CRC Error]"));
-        return;
-      }
-      else stream->print(F("[CRC OK !]"));
-      return;
-    }
+  char character = dscPanelProfile::displayCharacter(panelData[0]);
+  if (character) {
+    stream->print(character);
+    return;
   }
+
+  if (!validCRC()) stream->print(F("[No CRC or CRC Error]"));
+  else stream->print(F("[CRC OK !]"));
 }
 
 void dscKeybusInterface::printModuleMessage() {
   stream->print(F("[Keypad] "));
 
-    if (hideKeypadDigits
-    && (moduleData[0] == 0xCF || moduleData[0] == 0xDD || moduleData[0] == 0xBD || moduleData[0] == 0x7D
-      || moduleData[0] == 0xDB || moduleData[0] == 0xBB || moduleData[0] == 0x7B || moduleData[0] == 0xD7
-      || moduleData[0] == 0xB7 || moduleData[0] == 0x77 )) {
-    stream->print(F("[Digit]"));
-    return;
+  // Finds the key with the panel profile key codes
+  const char keys[] = "0123456789*#RABHCFPSWN";
+  char key = 0;
+  for (byte i = 0; keys[i] != '\0'; i++) {
+    byte keyCode;
+    if (dscPanelProfile::keyCode(keys[i], keyCode) && keyCode == moduleData[0]) {
+      key = keys[i];
+      break;
+    }
   }
 
-  
-  switch (moduleData[0]) {
-    case 0xCF: stream->print(F("K0")); break;
-    case 0xDD: stream->print(F("K1")); break;
-    case 0xBD: stream->print(F("K2")); break;
-    case 0x7D: stream->print(F("K3")); break;
-    case 0xDB: stream->print(F("K4")); break;
-    case 0xBB: stream->print(F("K5")); break;
-    case 0x7B: stream->print(F("K6")); break;
-    case 0xD7: stream->print(F("K7")); break;
-    case 0xB7: stream->print(F("K8")); break;
-    case 0x77: stream->print(F("K9")); break;
-
-    case 0xFF: stream->print(F("CMD")); break;
-    case 0xEF: stream->print(F("ENTER")); break;
-
-    case 0xF7: stream->print(F("BYPASS")); break;
-    case 0xFD: stream->print(F("HOME")); break;
-    case 0xAF: stream->print(F("READ")); break;
-    case 0x6F: stream->print(F("ADDRESS")); break;
-    case 0xFB: stream->print(F("CODE")); break;
-
+  if (key >= '0' && key <= '9') {
+    if (hideKeypadDigits) stream->print(F("[Digit]"));
+    else {
+      stream->print(F("K"));
+      stream->print(key);
+    }
+    return;
+  }
 
+  switch (key) {
+    case '*': stream->print(F("*")); break;
+    case '#': stream->print(F("ENTER")); break;
+    case 'R': stream->print(F("READ")); break;
+    case 'A':
+      if (dscPanelProfile::alarmKey(key)) stream->print(F("AUX"));
+      else stream->print(F("ADDRESS"));
+      break;
+    case 'B': stream->print(F("BYPASS")); break;
+    case 'H': stream->print(F("HOME")); break;
+    case 'C': stream->print(F("CODE")); break;
+    case 'F': stream->print(F("FIRE")); break;
+    case 'P': stream->print(F("PANIC")); break;
+    case 'S': stream->print(F("STAY")); break;
+    case 'W': stream->print(F("AWAY")); break;
+    case 'N': stream->print(F("NO ENTRY DELAY")); break;
     default:
-      stream->print(F("Unrecognized cmd: 0x"));
-      stream->print(moduleData[0], HEX);
+      if (moduleData[0] == 0xFF) stream->print(F("CMD"));
+      else {
+        stream->print(F("Unrecognized cmd: 0x"));
+        stream->print(moduleData[0], HEX);
+      }
       break;
   }
-
 }
 
 
@@ -143,3 +135,20 @@ void dscKeybusInterface::printPanelCommand() {
   if (panelData[3] < 16) stream->print("0");
   stream->print(panelData[3], HEX);
 }
+
+
+/*
+ * Print repeated commands
+ */
+void dscKeybusInterface::printPanelRepeat() {
+  stream->print(F("[0x"));
+  if (panelRepeat.command < 16) stream->print("0");
+  stream->print(panelRepeat.command, HEX);
+  stream->print(F("] Repeated "));
+  stream->print(panelRepeat.count);
+  stream->print(F(" times from "));
+  stream->print(panelRepeat.firstTime);
+  stream->print(F("ms to "));
+  stream->print(panelRepeat.lastTime);
+  stream->print(F("ms"));
+}
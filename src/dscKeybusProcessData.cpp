@@ -2,37 +2,137 @@
 
 #include "dscKeybusInterface.h"
 
+/*
+ *  Command handlers
+ *
+ *  Each command byte has an entry in commandTable[] selecting the library status decoding and a sketch
+ *  handler, dispatching a command is a single table lookup.  With dscSparseCommandTable (AVR), only entries
+ *  that differ from the default are stored with their command byte in tableCommands[], and other commands
+ *  decode status.
+ */
+
+bool dscKeybusInterface::setCommandHandler(byte command, dscCommandHandler handler, bool processStatus) {
+  byte handlerNumber = 0;
+  if (handler) {
+
+    // Reuses the handler number if the handler is already set for another command
+    for (byte i = 0; i < dscCommandHandlerSize; i++) {
+      if (commandHandlers[i] == handler || commandHandlers[i] == NULL) {
+        commandHandlers[i] = handler;
+        handlerNumber = i + 1;
+        break;
+      }
+    }
+    if (handlerNumber == 0) return false;
+  }
+
+  byte entry = handlerNumber;
+  if (processStatus) entry |= dscCommandStatus;
+
+  if (!dscSparseCommandTable) {
+    commandTable[command] = entry;
+    return true;
+  }
+
+  byte tableIndex = 0;
+  while (tableIndex < tableCommandCount && tableCommands[tableIndex] != command) tableIndex++;
+
+  // Removes the default entry, the last entry is moved to its place
+  if (entry == dscCommandStatus) {
+    if (tableIndex < tableCommandCount) {
+      tableCommandCount--;
+      tableCommands[tableIndex] = tableCommands[tableCommandCount];
+      commandTable[tableIndex] = commandTable[tableCommandCount];
+    }
+    return true;
+  }
+
+  if (tableIndex == tableCommandCount) {
+    if (tableCommandCount == dscCommandTableSize) return false;
+    tableCommands[tableIndex] = command;
+    tableCommandCount++;
+  }
+  commandTable[tableIndex] = entry;
+  return true;
+}
+
+
+byte dscKeybusInterface::commandEntry(byte command) {
+  if (!dscSparseCommandTable) return commandTable[command];
+
+  for (byte tableIndex = 0; tableIndex < tableCommandCount; tableIndex++) {
+    if (tableCommands[tableIndex] == command) return commandTable[tableIndex];
+  }
+  return dscCommandStatus;
+}
+
+
+void dscKeybusInterface::processCommand() {
+  byte entry = commandEntry(panelData[0]);
+  if (entry == 0) return;
+
+  if (entry & dscCommandStatus) {
+
+    // Traces status changes decoded from this command, statusChanged may still be set from a previous command
+    bool previousStatusChanged = statusChanged;
+    if (dscLatencyTrace) statusChanged = false;
+
+    processPanel_Zones();
+    processDisplay();
+
+    if (dscLatencyTrace) {
+      if (statusChanged) traceStatusChange();
+      statusChanged |= previousStatusChanged;
+    }
+  }
+
+  byte handlerNumber = entry & dscCommandHandlerMask;
+  if (handlerNumber) commandHandlers[handlerNumber - 1](panelData, panelBitCount);
+}
+
+
 void dscKeybusInterface::processHomeKey() {
-  previousHomeKey = moduleData[0] == 0xFD || (previousHomeKey  && (moduleData[0] == 0xFF || moduleData[0] == 0xEF));
+  previousHomeKey = dscPanelProfile::homeKey(moduleData[0], previousHomeKey);
 }
 void dscKeybusInterface::processPanel_Zones() {
-  static unsigned long previousTroubleChange;
-  if (!validCRC()) return;
-  
+  byte decodeFlags = dscPanelProfile::decodeFlags(panelData, panelBitCount);
+  if (decodeFlags == 0) return;
+
+  #if defined(dscPowerSeries)
+  if (decodeFlags & dscDecodeLights) {
+    lights[0] = panelData[2];
+    status[0] = panelData[3];
+  }
+  #endif
 
   // Trouble status
-  if (bitRead(panelData[3],3)) trouble = true;
-  else trouble = false;
-  if (trouble != previousTrouble && millis() - previousTroubleChange > 3000) {
+  byte rawStatus = previousTrouble | (previousPowerTrouble << 1);
+  if (decodeFlags & dscDecodeTrouble) bitWrite(rawStatus, 0, dscPanelProfile::trouble(panelData));
+  if (decodeFlags & dscDecodePowerTrouble) bitWrite(rawStatus, 1, dscPanelProfile::powerTrouble(panelData));
+  byte statusStates = debounce(dscDebounceStatus, rawStatus, previousTrouble | (previousPowerTrouble << 1));
+  trouble = bitRead(statusStates, 0);
+  if (trouble != previousTrouble) {
     previousTrouble = trouble;
     troubleChanged = true;
     statusChanged = true;
-    previousTroubleChange = millis();
+    logEvent(trouble ? dscEventTrouble : dscEventTroubleRestored, 0);
   }
 
   //Power Trouble
-  if (bitRead(panelData[3],2)) powerTrouble = true;
-  else powerTrouble = false;
+  powerTrouble = bitRead(statusStates, 1);
 
   if(powerTrouble != previousPowerTrouble){
     previousPowerTrouble = powerTrouble;
     powerChanged = true;
     statusChanged = true;
+    logEvent(powerTrouble ? dscEventPowerTrouble : dscEventPowerRestored, 0);
   }
 
   byte partitionIndex = 0;
 
-  bool armedFlag = !bitRead(panelData[3], 0);
+  bool rawArmed = previousArmed[partitionIndex];
+  if (decodeFlags & dscDecodeArmed) rawArmed = dscPanelProfile::armed(panelData, partitionIndex);
+  bool armedFlag = bitRead(debounce(dscDebounceArmed, rawArmed << partitionIndex, previousArmed[partitionIndex] << partitionIndex), partitionIndex);
   
   armedStay[partitionIndex] = previousHomeKey && armedFlag;
   armedAway[partitionIndex] = !previousHomeKey && armedFlag; // haven't find a way to distinguish
@@ -43,27 +143,191 @@ void dscKeybusInterface::processPanel_Zones() {
     armedChanged[partitionIndex] = true;
     statusChanged = true;
     previousHomeKey = false;
+    logEvent(armedFlag ? dscEventArmed : dscEventDisarmed, partitionIndex + 1);
   }
  
   // Open zones 1-8 status is stored in openZones[0] and openZonesChanged[0]: Bit 0 = Zone 1 ... Bit 7 = Zone 8
-  byte zoneData = panelData[2] >> 1; 
+  byte rawZones = previousOpenZones[0];
+  if (decodeFlags & dscDecodeZones) rawZones = dscPanelProfile::openZones(panelData);
+  byte zoneData = debounce(dscDebounceZones, rawZones, previousOpenZones[0]);
   openZones[0] = zoneData;
   byte zonesChanged = openZones[0] ^ previousOpenZones[0];
   if (zonesChanged != 0) {
     previousOpenZones[0] = openZones[0];
     openZonesStatusChanged = true;
     statusChanged = true;
+    unsigned long currentTime = millis();
 
     for (byte zoneBit = 0; zoneBit < 8; zoneBit++) {
       if (bitRead(zonesChanged, zoneBit)) {
         bitWrite(openZonesChanged[0], zoneBit, 1);
         if (bitRead(zoneData, zoneBit)) bitWrite(openZones[0], zoneBit, 1);
         else bitWrite(openZones[0], zoneBit, 0);
+        logEvent(bitRead(zoneData, zoneBit) ? dscEventZoneOpen : dscEventZoneClosed, zoneBit + 1);
+        if (dscZoneAnalytics) recordZoneActivity(zoneBit, bitRead(zoneData, zoneBit), currentTime);
       }
     }
   }
+
+  // Status restored at begin() is now confirmed or corrected by the panel data
+  stateRestored = false;
+  stateDecoded = true;
 }
 
 
 
 
+
+
+/*
+ *  Debounce
+ *
+ *  Signals are debounced in groups of up to 8 signals.  Only signals that differ from the accepted status or
+ *  have a pending change are checked, unchanged groups return immediately.  Pending changes are checked on
+ *  each panel command.
+ */
+
+void dscKeybusInterface::setDebounce(byte signal, unsigned int settleTime, unsigned int minHold) {
+  if (signal >= dscSignalCount) return;
+  debounceSettle[signal] = settleTime;
+  debounceHold[signal] = minHold;
+}
+
+
+// Returns the accepted status of a signal group from the current and previously accepted status
+byte dscKeybusInterface::debounce(byte group, byte rawStates, byte states) {
+  byte pending = debouncePending[group];
+  byte changed = rawStates ^ states;
+  byte checked = changed | pending;
+  if (checked == 0) return states;
+
+  byte firstSignal;
+  if (group == dscDebounceStatus) firstSignal = dscSignalTrouble;
+  else if (group == dscDebounceArmed) firstSignal = dscSignalArmed;
+  else firstSignal = dscSignalZone + ((group - dscDebounceZones) * 8);
+
+  unsigned long currentTime = millis();
+  for (byte bit = 0; checked != 0; bit++, checked >>= 1) {
+    if (!(checked & 0x01)) continue;
+    byte mask = 1 << bit;
+    byte signal = firstSignal + bit;
+
+    // Reverted before the change was accepted
+    if (!(changed & mask)) {
+      pending &= ~mask;
+      suppressedChanges++;
+      continue;
+    }
+
+    if (!(pending & mask)) {
+      pending |= mask;
+      debounceStart[signal] = currentTime;
+    }
+
+    if (currentTime - debounceStart[signal] >= debounceSettle[signal] && currentTime - debounceChange[signal] >= debounceHold[signal]) {
+      states ^= mask;
+      pending &= ~mask;
+      debounceChange[signal] = currentTime;
+    }
+  }
+
+  debouncePending[group] = pending;
+  return states;
+}
+
+
+/*
+ *  Keypad display
+ *
+ *  Each panel command byte 0 is the 7-segment pattern shown on the keypad.  Readouts longer than one character
+ *  are shown one character at a time, usually separated by a blank display.  Characters are collected into
+ *  displaySequence as the segments change, and the sequence is published to displayText when the display has
+ *  been blank or steady for dscDisplayPause.  A single character that returns after a blank is flashing and is
+ *  published immediately with displayBlink set, unless the blank was shorter than 1/dscDisplayFlashRatio of
+ *  the time the character was shown - a readout of a repeated character such as "11" has a short blank between
+ *  the characters, while a flashing character is blank for about as long as it is shown.
+ *
+ *  Only changes to the segments are processed, with a fixed amount of work per command.
+ */
+
+void dscKeybusInterface::processDisplay() {
+  if (!dscPanelProfile::segmentDisplay || !validCRC()) return;
+
+  byte segments = panelData[0];
+  if (segments == previousDisplay) return;
+
+  char character = dscPanelProfile::displayCharacter(segments);
+  if (!character && segments != 0) return;  // Skips unrecognized patterns
+
+  unsigned long currentTime = millis();
+  unsigned long segmentsTime = currentTime - displaySegmentsTime;  // Time the previous segments were shown
+  previousDisplay = segments;
+  displaySegmentsTime = currentTime;
+  displayPaused = false;
+
+  if (segments == 0) {
+    displayBlank = true;
+    displayCharacterTime = segmentsTime;
+    return;
+  }
+
+  // Flashing character
+  if (displayBlank && displaySequenceLength == 1 && displaySequence[0] == character && segmentsTime * dscDisplayFlashRatio >= displayCharacterTime) {
+    displayBlank = false;
+    displayFlashing = true;
+    setDisplay(true);
+    return;
+  }
+
+  // Starts a new sequence after a flashing character
+  if (displayFlashing) {
+    displayFlashing = false;
+    displaySequenceLength = 0;
+  }
+
+  // Publishes the sequence if it is longer than dscDisplaySize and starts a new sequence
+  if (displaySequenceLength >= dscDisplaySize) {
+    setDisplay(false);
+    displaySequenceLength = 0;
+  }
+
+  displayBlank = false;
+  displaySequence[displaySequenceLength] = character;
+  displaySequenceLength++;
+}
+
+
+// Publishes the sequence after the display has been blank or steady for dscDisplayPause, and clears the
+// display text if the display remains blank for another dscDisplayPause
+void dscKeybusInterface::processDisplayPause() {
+  if (displayPaused || millis() - displaySegmentsTime < dscDisplayPause) return;
+
+  if (displaySequenceLength > 0) {
+    setDisplay(false);
+    displaySequenceLength = 0;
+    displayFlashing = false;
+    if (displayBlank) {
+      displaySegmentsTime = millis();
+      return;
+    }
+  }
+  else if (displayBlank) setDisplay(false);
+
+  displayPaused = true;
+}
+
+
+void dscKeybusInterface::setDisplay(bool blink) {
+  bool textChanged = displayText[displaySequenceLength] != '\0';
+  for (byte i = 0; i < displaySequenceLength && !textChanged; i++) {
+    if (displayText[i] != displaySequence[i]) textChanged = true;
+  }
+  if (!textChanged && blink == displayBlink) return;
+
+  for (byte i = 0; i < displaySequenceLength; i++) displayText[i] = displaySequence[i];
+  displayText[displaySequenceLength] = '\0';
+  displayBlink = blink;
+  displayTime = millis();
+  displayChanged = true;
+  statusChanged = true;
+}
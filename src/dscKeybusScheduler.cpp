@@ -0,0 +1,137 @@
+
+#include "dscKeybusInterface.h"
+
+/*
+ *  Scheduler
+ *
+ *  Each run() drains the panel buffer, then checks the tasks in turn starting after the last task that ran so
+ *  each task gets a chance to run.  The first due task always runs, further due tasks run only if their budget
+ *  fits in the remaining iteration budget.  A task that was delayed past an interval is rescheduled from the
+ *  current time instead of running repeatedly to catch up.
+ */
+
+dscScheduler::dscScheduler(dscKeybusInterface &setInterface) {
+  keybus = &setInterface;
+  keybusTask = NULL;
+  taskCount = 0;
+  nextTask = 0;
+  iterationBudget = 50;
+}
+
+
+void dscScheduler::setKeybusTask(dscTask task) {
+  keybusTask = task;
+}
+
+
+byte dscScheduler::addTask(dscTask task, unsigned long interval, unsigned long budget) {
+  if (taskCount >= dscSchedulerSize) return 255;
+
+  tasks[taskCount] = task;
+  taskInterval[taskCount] = interval;
+  taskBudget[taskCount] = budget;
+  taskDue[taskCount] = millis();
+  taskCount++;
+  resetStats();
+  return taskCount - 1;
+}
+
+
+void dscScheduler::setIterationBudget(unsigned long budget) {
+  iterationBudget = budget;
+}
+
+
+// Processes buffered commands until the buffer is empty, handlePanel() also returns false for skipped commands
+void dscScheduler::serviceKeybus() {
+  do {
+    if (keybus->handlePanel() && keybusTask) keybusTask();
+  } while (keybus->bufferedCommands() > 0);
+}
+
+
+void dscScheduler::run() {
+  serviceKeybus();
+
+  unsigned long iterationStart = millis();
+  bool taskRun = false;
+  for (byte checkedTasks = 0; checkedTasks < taskCount; checkedTasks++) {
+    byte task = nextTask;
+    if (++nextTask >= taskCount) nextTask = 0;
+
+    unsigned long currentTime = millis();
+    long lateness = currentTime - taskDue[task];
+    if (lateness < 0) continue;
+    if (taskRun && currentTime - iterationStart + taskBudget[task] > iterationBudget) continue;
+
+    // Tracks the panel buffer peak during the task separately from the overall peak
+    noInterrupts();
+    unsigned int bufferPeak = keybus->bufferPeak;
+    keybus->bufferPeak = 0;
+    interrupts();
+
+    tasks[task]();
+
+    unsigned long taskTime = millis() - currentTime;
+    noInterrupts();
+    unsigned int taskBufferPeak = keybus->bufferPeak;
+    if (bufferPeak > keybus->bufferPeak) keybus->bufferPeak = bufferPeak;
+    interrupts();
+
+    dscTaskStats &taskStats = stats[task];
+    taskStats.runs++;
+    if (taskTime > taskBudget[task]) taskStats.overruns++;
+    if (taskTime > taskStats.maxTime) taskStats.maxTime = taskTime;
+    if ((unsigned long)lateness > taskStats.maxLateness) taskStats.maxLateness = lateness;
+    if (taskBufferPeak > taskStats.bufferPeak) taskStats.bufferPeak = taskBufferPeak;
+
+    taskDue[task] += taskInterval[task];
+    if ((long)(millis() - taskDue[task]) >= 0) taskDue[task] = millis() + taskInterval[task];
+
+    serviceKeybus();
+    taskRun = true;
+  }
+}
+
+
+bool dscScheduler::taskStats(byte task, dscTaskStats &taskStats) {
+  if (task >= taskCount) return false;
+  taskStats = stats[task];
+  return true;
+}
+
+
+void dscScheduler::resetStats() {
+  for (byte task = 0; task < dscSchedulerSize; task++) {
+    stats[task].runs = 0;
+    stats[task].overruns = 0;
+    stats[task].maxTime = 0;
+    stats[task].maxLateness = 0;
+    stats[task].bufferPeak = 0;
+  }
+  keybus->bufferPeak = 0;
+}
+
+
+void dscScheduler::printStats(Stream &output) {
+  for (byte task = 0; task < taskCount; task++) {
+    output.print(F("Task "));
+    output.print(task);
+    output.print(F(": runs: "));
+    output.print(stats[task].runs);
+    output.print(F(" overruns: "));
+    output.print(stats[task].overruns);
+    output.print(F(" max: "));
+    output.print(stats[task].maxTime);
+    output.print(F("ms late: "));
+    output.print(stats[task].maxLateness);
+    output.print(F("ms buffer: "));
+    output.print(stats[task].bufferPeak);
+    output.println(F(" bytes"));
+  }
+  output.print(F("Panel buffer peak: "));
+  output.print(keybus->bufferPeak);
+  output.print(F("/"));
+  output.print(dscBufferSize);
+  output.println(F(" bytes"));
+}
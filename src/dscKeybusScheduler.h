@@ -0,0 +1,54 @@
+
+#ifndef dscKeybusScheduler_h
+#define dscKeybusScheduler_h
+
+#include <Arduino.h>
+
+class dscKeybusInterface;
+
+#if defined(__AVR__)
+const byte dscSchedulerSize = 4;  // Maximum number of scheduled tasks - requires 32 bytes of memory per task
+#else
+const byte dscSchedulerSize = 8;
+#endif
+
+typedef void (*dscTask)();
+
+struct dscTaskStats {
+  unsigned long runs;
+  unsigned long overruns;     // Runs longer than the task budget
+  unsigned long maxTime;      // Longest run in milliseconds
+  unsigned long maxLateness;  // Longest delay in milliseconds from the time the task was due to the start of the run
+  unsigned int bufferPeak;    // Most panel buffer bytes used while the task was running
+};
+
+
+// Runs sketch tasks cooperatively with the Keybus: the panel buffer is drained before each task and after each
+// task, and tasks are only started while their time budget fits in the iteration budget of each run().  Tasks
+// run to completion, long tasks (network requests) can call serviceKeybus() between steps to keep the panel
+// buffer from overflowing.
+class dscScheduler {
+
+  public:
+    dscScheduler(dscKeybusInterface &setInterface);
+
+    void setKeybusTask(dscTask task);               // Called for each handlePanel() with panel data or status changes
+    byte addTask(dscTask task, unsigned long interval, unsigned long budget);  // Times in milliseconds, returns the task number or 255 if dscSchedulerSize is exceeded
+    void setIterationBudget(unsigned long budget);  // Time in milliseconds for tasks in each run() (default: 50)
+    void run();                                     // Call from loop()
+    void serviceKeybus();                           // Drains the panel buffer
+    bool taskStats(byte task, dscTaskStats &stats);
+    void resetStats();
+    void printStats(Stream &output);
+
+  private:
+    dscKeybusInterface* keybus;
+    dscTask keybusTask;
+    dscTask tasks[dscSchedulerSize];
+    unsigned long taskInterval[dscSchedulerSize], taskBudget[dscSchedulerSize], taskDue[dscSchedulerSize];
+    dscTaskStats stats[dscSchedulerSize];
+    byte taskCount, nextTask;
+    unsigned long iterationBudget;
+};
+
+#endif  // dscKeybusScheduler_h
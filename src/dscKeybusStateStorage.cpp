@@ -0,0 +1,307 @@
+
+#include "dscKeybusInterface.h"
+
+#if defined(__AVR__) || defined(ESP8266)
+#include <EEPROM.h>
+#endif
+
+/*
+ *  Saved state
+ *
+ *  The storage area is split into fixed-size slots and each save is written to the slot after the previous
+ *  save, spreading writes across the storage area.  At begin(), the valid slot with the highest sequence number
+ *  is restored.
+ *
+ *  Slot format:
+ *    Byte 0: 0xD5 marker
+ *    Byte 1-4: Sequence number
+ *    Byte 5: Trouble status - bit 0: trouble, bit 1: power trouble
+ *    Byte 6 - 6+dscPartitions: Armed status per partition - bit 0: armed, bit 1: armed stay, bit 2: armed away
+ *    Next dscZones bytes: openZones[]
+ *    Next dscZones bytes: alarmZones[]
+ *    Last byte: CRC-8
+ */
+
+const byte dscStateMarker = 0xD5;
+const byte dscStateSlotSize = dscStateSize + 6;
+
+
+static byte stateCRC(const byte * data, byte length) {
+  byte crc = 0;
+  for (byte i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (byte bit = 0; bit < 8; bit++) {
+      if (crc & 0x80) crc = (crc << 1) ^ 0x07;
+      else crc <<= 1;
+    }
+  }
+  return crc;
+}
+
+
+// The save interval is raised to the minimum of the storage if necessary
+void dscKeybusInterface::setStateStorage(dscStateStorage &storage, unsigned long saveInterval) {
+  stateStorage = &storage;
+  stateSaveInterval = saveInterval;
+  if (stateSaveInterval < storage.minimumSaveInterval()) stateSaveInterval = storage.minimumSaveInterval();
+}
+
+
+void dscKeybusInterface::encodeState(byte * stateData) {
+  stateData[0] = trouble | (powerTrouble << 1);
+
+  for (byte partitionIndex = 0; partitionIndex < dscPartitions; partitionIndex++) {
+    stateData[1 + partitionIndex] = armed[partitionIndex] | (armedStay[partitionIndex] << 1) | (armedAway[partitionIndex] << 2);
+  }
+
+  for (byte zoneGroup = 0; zoneGroup < dscZones; zoneGroup++) {
+    stateData[1 + dscPartitions + zoneGroup] = openZones[zoneGroup];
+    stateData[1 + dscPartitions + dscZones + zoneGroup] = alarmZones[zoneGroup];
+  }
+}
+
+
+// Restores the most recently saved status as the current and previous status, so the first panel data only
+// flags status changes that occurred while the interface was offline
+void dscKeybusInterface::restoreState() {
+  if (!stateStorage->begin()) {
+    stateStorage = NULL;
+    return;
+  }
+
+  stateSlotCount = stateStorage->size() / dscStateSlotSize;
+  if (stateSlotCount == 0) {
+    stateStorage = NULL;
+    return;
+  }
+
+  bool stateFound = false;
+  byte slotData[dscStateSlotSize];
+  for (unsigned int slot = 0; slot < stateSlotCount; slot++) {
+    if (!stateStorage->read(slot * dscStateSlotSize, slotData, dscStateSlotSize)) continue;
+    if (slotData[0] != dscStateMarker || stateCRC(slotData, dscStateSlotSize - 1) != slotData[dscStateSlotSize - 1]) continue;
+
+    unsigned long sequence = (unsigned long)slotData[1] | ((unsigned long)slotData[2] << 8) | ((unsigned long)slotData[3] << 16) | ((unsigned long)slotData[4] << 24);
+    if (!stateFound || (int32_t)(sequence - stateSequence) > 0) {  // Sequence numbers are 32-bit on all platforms
+      stateFound = true;
+      stateSequence = sequence;
+      stateSlot = slot;
+      for (byte i = 0; i < dscStateSize; i++) savedState[i] = slotData[5 + i];
+    }
+  }
+
+  // Starts saving at the first slot if no saved status is available
+  if (!stateFound) {
+    stateSlot = stateSlotCount - 1;
+    return;
+  }
+
+  trouble = previousTrouble = bitRead(savedState[0], 0);
+  powerTrouble = previousPowerTrouble = bitRead(savedState[0], 1);
+
+  for (byte partitionIndex = 0; partitionIndex < dscPartitions; partitionIndex++) {
+    armed[partitionIndex] = previousArmed[partitionIndex] = bitRead(savedState[1 + partitionIndex], 0);
+    armedStay[partitionIndex] = bitRead(savedState[1 + partitionIndex], 1);
+    armedAway[partitionIndex] = bitRead(savedState[1 + partitionIndex], 2);
+  }
+
+  for (byte zoneGroup = 0; zoneGroup < dscZones; zoneGroup++) {
+    openZones[zoneGroup] = previousOpenZones[zoneGroup] = savedState[1 + dscPartitions + zoneGroup];
+    alarmZones[zoneGroup] = previousAlarmZones[zoneGroup] = savedState[1 + dscPartitions + dscZones + zoneGroup];
+  }
+
+  stateRestored = true;
+}
+
+
+// Saves the status to the next slot if it has changed since the last save, limited to once per stateSaveInterval
+void dscKeybusInterface::saveState() {
+  if (previousStateSave != 0 && millis() - previousStateSave < stateSaveInterval) return;
+
+  byte stateData[dscStateSize];
+  encodeState(stateData);
+  bool stateChanged = false;
+  for (byte i = 0; i < dscStateSize; i++) {
+    if (stateData[i] != savedState[i]) {
+      stateChanged = true;
+      break;
+    }
+  }
+  if (!stateChanged) return;
+
+  previousStateSave = millis();
+  stateSequence++;
+  stateSlot++;
+  if (stateSlot >= stateSlotCount) stateSlot = 0;
+
+  byte slotData[dscStateSlotSize];
+  slotData[0] = dscStateMarker;
+  slotData[1] = stateSequence;
+  slotData[2] = stateSequence >> 8;
+  slotData[3] = stateSequence >> 16;
+  slotData[4] = stateSequence >> 24;
+  for (byte i = 0; i < dscStateSize; i++) slotData[5 + i] = stateData[i];
+  slotData[dscStateSlotSize - 1] = stateCRC(slotData, dscStateSlotSize - 1);
+
+  if (stateStorage->write(stateSlot * dscStateSlotSize, slotData, dscStateSlotSize)) {
+    for (byte i = 0; i < dscStateSize; i++) savedState[i] = stateData[i];
+  }
+}
+
+
+/*
+ *  EEPROM storage
+ */
+
+#if defined(__AVR__) || defined(ESP8266)
+dscEEPROMStateStorage::dscEEPROMStateStorage(unsigned int setStartAddress, unsigned int setLength) {
+  startAddress = setStartAddress;
+  length = setLength;
+}
+
+
+bool dscEEPROMStateStorage::begin() {
+  #if defined(ESP8266)
+  EEPROM.begin(startAddress + length);
+  #endif
+  return true;
+}
+
+
+#if defined(ESP8266)
+unsigned long dscEEPROMStateStorage::minimumSaveInterval() {
+  return dscEEPROMSaveInterval;
+}
+#endif
+
+
+unsigned int dscEEPROMStateStorage::size() {
+  return length;
+}
+
+
+bool dscEEPROMStateStorage::read(unsigned int address, byte * data, unsigned int dataLength) {
+  if (address + dataLength > length) return false;
+  for (unsigned int i = 0; i < dataLength; i++) data[i] = EEPROM.read(startAddress + address + i);
+  return true;
+}
+
+
+// The esp8266 EEPROM emulation erases and rewrites its flash sector on each commit(), minimumSaveInterval()
+// limits the number of commits
+bool dscEEPROMStateStorage::write(unsigned int address, const byte * data, unsigned int dataLength) {
+  if (address + dataLength > length) return false;
+
+  #if defined(__AVR__)
+  for (unsigned int i = 0; i < dataLength; i++) EEPROM.update(startAddress + address + i, data[i]);
+  return true;
+
+  #elif defined(ESP8266)
+  for (unsigned int i = 0; i < dataLength; i++) EEPROM.write(startAddress + address + i, data[i]);
+  return EEPROM.commit();
+  #endif
+}
+#endif
+
+
+/*
+ *  Flash filesystem storage
+ */
+
+#if defined(ESP8266)
+dscFSStateStorage::dscFSStateStorage(fs::FS &setFilesystem, const char * setPath, unsigned int setLength) {
+  filesystem = &setFilesystem;
+  path = setPath;
+  length = setLength;
+}
+
+
+bool dscFSStateStorage::begin() {
+  if (file) return true;
+  if (filesystem->exists(path)) {
+    file = filesystem->open(path, "r+");
+    if (file && file.size() >= length) return true;
+    if (file) file.close();
+  }
+
+  // Creates the file as erased storage
+  file = filesystem->open(path, "w+");
+  if (!file) return false;
+  for (unsigned int i = 0; i < length; i++) file.write((uint8_t)0xFF);
+  file.flush();
+  return true;
+}
+
+
+unsigned int dscFSStateStorage::size() {
+  return length;
+}
+
+
+bool dscFSStateStorage::read(unsigned int address, byte * data, unsigned int dataLength) {
+  if (!file || address + dataLength > length) return false;
+  if (!file.seek(address, fs::SeekSet)) return false;
+  return file.read(data, dataLength) == dataLength;
+}
+
+
+bool dscFSStateStorage::write(unsigned int address, const byte * data, unsigned int dataLength) {
+  if (!file || address + dataLength > length) return false;
+  if (!file.seek(address, fs::SeekSet)) return false;
+  if (file.write(data, dataLength) != dataLength) return false;
+  file.flush();
+  return true;
+}
+#endif
+
+
+/*
+ *  File storage
+ */
+
+#if !defined(ARDUINO)
+dscFileStateStorage::dscFileStateStorage(const char * setPath, unsigned int setLength) {
+  path = setPath;
+  length = setLength;
+  file = NULL;
+}
+
+
+dscFileStateStorage::~dscFileStateStorage() {
+  if (file) fclose(file);
+}
+
+
+bool dscFileStateStorage::begin() {
+  if (file) return true;
+  file = fopen(path, "r+b");
+  if (file) return true;
+
+  // Creates the file as erased storage
+  file = fopen(path, "w+b");
+  if (!file) return false;
+  for (unsigned int i = 0; i < length; i++) fputc(0xFF, file);
+  fflush(file);
+  return true;
+}
+
+
+unsigned int dscFileStateStorage::size() {
+  return length;
+}
+
+
+bool dscFileStateStorage::read(unsigned int address, byte * data, unsigned int dataLength) {
+  if (!file || address + dataLength > length) return false;
+  if (fseek(file, address, SEEK_SET) != 0) return false;
+  return fread(data, 1, dataLength, file) == dataLength;
+}
+
+
+bool dscFileStateStorage::write(unsigned int address, const byte * data, unsigned int dataLength) {
+  if (!file || address + dataLength > length) return false;
+  if (fseek(file, address, SEEK_SET) != 0) return false;
+  if (fwrite(data, 1, dataLength, file) != dataLength) return false;
+  return fflush(file) == 0;
+}
+#endif
@@ -0,0 +1,98 @@
+
+#ifndef dscKeybusStateStorage_h
+#define dscKeybusStateStorage_h
+
+#include <Arduino.h>
+
+#if defined(ESP8266)
+#include <FS.h>
+#endif
+
+#if !defined(ARDUINO)
+#include <stdio.h>
+#endif
+
+
+// Storage backend for the saved state snapshot and event log.  Addresses are relative to the start of the storage area and
+// erased storage is expected to read as 0xFF.
+class dscStateStorage {
+
+  public:
+    virtual bool begin() { return true; }
+    virtual unsigned long minimumSaveInterval() { return 0; }  // Minimum time in milliseconds between state saves to limit wear
+    virtual unsigned int size() = 0;
+    virtual bool read(unsigned int address, byte * data, unsigned int length) = 0;
+    virtual bool write(unsigned int address, const byte * data, unsigned int length) = 0;
+};
+
+
+#if defined(ESP8266)
+const unsigned long dscEEPROMSaveInterval = 3600000;  // Minimum time in milliseconds between state saves to the esp8266 EEPROM emulation
+#endif
+
+#if defined(__AVR__) || defined(ESP8266)
+// Saves to EEPROM (AVR) or the EEPROM emulation flash sector (esp8266) starting at startAddress.  On esp8266,
+// begin() calls EEPROM.begin() with startAddress + length, sketches using EEPROM elsewhere must use the same size.
+//
+// The esp8266 EEPROM emulation erases and rewrites its whole flash sector on each commit, so the slots do not
+// spread the wear - state saves are limited to once per dscEEPROMSaveInterval.  dscFSStateStorage is preferred
+// on esp8266.
+class dscEEPROMStateStorage : public dscStateStorage {
+
+  public:
+    dscEEPROMStateStorage(unsigned int setStartAddress, unsigned int setLength);
+    bool begin();
+    #if defined(ESP8266)
+    unsigned long minimumSaveInterval();
+    #endif
+    unsigned int size();
+    bool read(unsigned int address, byte * data, unsigned int length);
+    bool write(unsigned int address, const byte * data, unsigned int length);
+
+  private:
+    unsigned int startAddress, length;
+};
+#endif
+
+
+#if defined(ESP8266)
+// Saves to a file on a flash filesystem (LittleFS or SPIFFS), which spreads writes across the flash.  The
+// filesystem must be mounted before begin().
+class dscFSStateStorage : public dscStateStorage {
+
+  public:
+    dscFSStateStorage(fs::FS &setFilesystem, const char * setPath, unsigned int setLength);
+    bool begin();
+    unsigned int size();
+    bool read(unsigned int address, byte * data, unsigned int length);
+    bool write(unsigned int address, const byte * data, unsigned int length);
+
+  private:
+    fs::FS* filesystem;
+    const char * path;
+    unsigned int length;
+    fs::File file;
+};
+#endif
+
+
+#if !defined(ARDUINO)
+// Saves to a file for testing on a host system, the file is created and filled as erased storage if necessary
+class dscFileStateStorage : public dscStateStorage {
+
+  public:
+    dscFileStateStorage(const char * setPath, unsigned int setLength);
+    ~dscFileStateStorage();
+    bool begin();
+    unsigned int size();
+    bool read(unsigned int address, byte * data, unsigned int length);
+    bool write(unsigned int address, const byte * data, unsigned int length);
+
+  private:
+    const char * path;
+    unsigned int length;
+    FILE * file;
+};
+#endif
+
+#endif  // dscKeybusStateStorage_h
@@ -0,0 +1,69 @@
+
+#include "dscKeybusInterface.h"
+
+/*
+ *  ISR trace
+ *
+ *  If dscISRTrace is enabled, trace points in dscClockInterrupt(), dscDataInterrupt() and processDataBit()
+ *  write fixed-size records to traceRing[], overwriting the oldest records.  The interrupts are the only
+ *  writer and never wait: printTrace() stops recording with traceHold while the records are printed, so the
+ *  printed records end at the time printTrace() is called.
+ */
+
+void dscKeybusInterface::printTrace() {
+  if (!dscISRTrace) return;
+
+  traceHold = true;
+  noInterrupts();
+  unsigned long count = traceCount;
+  interrupts();
+
+  unsigned long firstRecord = count > dscTraceRecordSize ? count - dscTraceRecordSize : 0;
+  stream->print(F("Trace: "));
+  stream->print(count - firstRecord);
+  stream->print(F(" records, "));
+  stream->print(firstRecord);
+  stream->println(F(" overwritten"));
+
+  unsigned long firstTime = traceRing[firstRecord & (dscTraceRecordSize - 1)].time;
+  for (unsigned long recordNumber = firstRecord; recordNumber < count; recordNumber++) {
+    volatile dscTraceRecord &record = traceRing[recordNumber & (dscTraceRecordSize - 1)];
+
+    // Time since the first record, CPU cycles on esp8266 and microseconds on AVR
+    stream->print(record.time - firstTime);
+    stream->print(F(" "));
+    printTraceEvent(record.event);
+    stream->print(F(" bit: "));
+    stream->print(record.bit);
+    stream->print(F(" data: "));
+    if (record.data < 0x10) stream->print(F("0"));
+    stream->println(record.data, HEX);
+  }
+
+  traceHold = false;
+}
+
+
+void dscKeybusInterface::printTraceEvent(byte event) {
+  switch (event) {
+    case dscTraceGlitch: stream->print(F("Clock glitch")); break;
+    case dscTraceWriteStart: stream->print(F("Write start")); break;
+    case dscTraceWriteEnd: stream->print(F("Write end")); break;
+    case dscTraceWriteTimeout: stream->print(F("Write timeout")); break;
+    case dscTraceFrameEnd: stream->print(F("Frame end")); break;
+    case dscTraceEchoMatch: stream->print(F("Read back")); break;
+    case dscTraceEchoRetry: stream->print(F("Write retry")); break;
+    case dscTraceEchoFailure: stream->print(F("Write failed")); break;
+    case dscTraceWriteReady: stream->print(F("Write ready")); break;
+    case dscTraceOverflow: stream->print(F("Buffer overflow")); break;
+    default: stream->print(F("Unknown event")); break;
+  }
+}
+
+
+void dscKeybusInterface::resetTrace() {
+  if (!dscISRTrace) return;
+  noInterrupts();
+  traceCount = 0;
+  interrupts();
+}
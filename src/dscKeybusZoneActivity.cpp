@@ -0,0 +1,87 @@
+
+#include "dscKeybusInterface.h"
+
+/*
+ *  Zone activity
+ *
+ *  If dscZoneAnalytics is enabled, processPanel_Zones() calls recordZoneActivity() for each zone that opens or
+ *  closes: an open increments the count, a close adds the open period to the open time.  Each transition
+ *  updates one record with no loops, and the current open period of open zones is added when the activity is
+ *  read.  Open periods that started before the window are counted from the start of the window.
+ */
+
+// Adds the open period ending at currentTime, the open time stops at the maximum instead of wrapping
+static void addOpenPeriod(dscZoneActivity &activity, unsigned long currentTime, unsigned long windowStart) {
+  unsigned long openPeriod = currentTime - activity.lastChange;
+  unsigned long windowTime = currentTime - windowStart;
+  if (activity.lastChange == 0 || openPeriod > windowTime) openPeriod = windowTime;
+
+  if (activity.openTime + openPeriod < activity.openTime) activity.openTime = 0xFFFFFFFF;
+  else activity.openTime += openPeriod;
+  if (openPeriod > activity.longestOpen) activity.longestOpen = openPeriod;
+}
+
+
+void dscKeybusInterface::recordZoneActivity(byte zone, bool open, unsigned long currentTime) {
+  dscZoneActivity &activity = zoneActivities[zone];
+  if (!open) addOpenPeriod(activity, currentTime, activityWindowStart);
+  else if (activity.openCount < 0xFFFF) activity.openCount++;
+  activity.lastChange = currentTime;
+}
+
+
+bool dscKeybusInterface::zoneActivity(byte zone, dscZoneActivity &activity) {
+  if (!dscZoneAnalytics || zone == 0 || zone > dscActivityZones) return false;
+  byte zoneIndex = zone - 1;
+  activity = zoneActivities[zoneIndex];
+
+  // Adds the current open period
+  if (bitRead(openZones[zoneIndex / 8], zoneIndex % 8)) addOpenPeriod(activity, millis(), activityWindowStart);
+  return true;
+}
+
+
+unsigned long dscKeybusInterface::zoneActivityWindow() {
+  return millis() - activityWindowStart;
+}
+
+
+void dscKeybusInterface::printZoneActivity() {
+  if (!dscZoneAnalytics) return;
+  stream->print(F("Zone activity in the last "));
+  stream->print(zoneActivityWindow() / 1000);
+  stream->println(F("s:"));
+
+  dscZoneActivity activity;
+  for (byte zone = 1; zone <= dscActivityZones; zone++) {
+    zoneActivity(zone, activity);
+    if (activity.openCount == 0 && activity.openTime == 0) continue;
+
+    stream->print(F("Zone "));
+    stream->print(zone);
+    stream->print(F(": opened "));
+    stream->print(activity.openCount);
+    stream->print(F(" times, open "));
+    stream->print(activity.openTime);
+    stream->print(F("ms, longest "));
+    stream->print(activity.longestOpen);
+    stream->print(F("ms"));
+    if (activity.lastChange) {
+      stream->print(F(", last change "));
+      stream->print((millis() - activity.lastChange) / 1000);
+      stream->print(F("s ago"));
+    }
+    stream->println();
+  }
+}
+
+
+void dscKeybusInterface::resetZoneActivity() {
+  if (!dscZoneAnalytics) return;
+  for (byte zone = 0; zone < dscActivityZones; zone++) {
+    zoneActivities[zone].openCount = 0;
+    zoneActivities[zone].openTime = 0;
+    zoneActivities[zone].longestOpen = 0;
+  }
+  activityWindowStart = millis();
+}